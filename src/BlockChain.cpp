@@ -150,6 +150,11 @@ BlockHeader BlockChain::getLastStateBlock() const {
     return hashes[lastStateBlock];
 }
 
+std::vector<BlockHeader> BlockChain::getAllBlocks() const {
+    std::shared_lock<std::shared_mutex> lock(mut);
+    return std::vector<BlockHeader>(std::next(hashes.begin()), hashes.end());
+}
+
 void BlockChain::clear() {
     hashes.clear();
     blocks.clear();
@@ -43,6 +43,11 @@ public:
     
     BlockHeader getLastStateBlock() const;
     
+    /**
+     *c Блоки основной цепочки без genesis, по возрастанию номера
+     */
+    std::vector<BlockHeader> getAllBlocks() const;
+    
     void clear();
     
 private:
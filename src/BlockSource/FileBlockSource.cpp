@@ -1,5 +1,8 @@
 #include "FileBlockSource.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "BlockchainRead.h"
 #include "LevelDb.h"
 
@@ -7,24 +10,42 @@
 #include "check.h"
 #include "convertStrings.h"
 #include "stopProgram.h"
+#include "parallel_for.h"
 
 #include "blockchain_structs/SignBlock.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
 #include "blockchain_structs/BlocksMetadata.h"
 
+#include "utils/Metrics.h"
+
 #include "RejectedBlockSource/FileRejectedBlockSource/FileRejectedBlockSource.h"
 
 using namespace common;
 
 namespace torrent_node_lib {
 
+const static milliseconds IMPORT_STAT_PERIOD = 10s;
+
+static size_t getCountParseThreads() {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
 FileBlockSource::FileBlockSource(FileRejectedBlockSource &rejectedBlockSource, LevelDb &leveldb, const std::string &folderPath, bool isValidate)
     : rejectedBlockSource(rejectedBlockSource)
     , leveldb(leveldb)
     , folderPath(folderPath)
+    , countParseThreads(getCountParseThreads())
+    , beginImportStatTime(::now())
+    , importedBlocksMetric(getMetrics().counter("torrent_file_import_blocks_total", "Blocks imported from block files"))
+    , importedTxsMetric(getMetrics().counter("torrent_file_import_txs_total", "Transactions imported from block files"))
     , isValidate(isValidate)
 {}
 
+FileBlockSource::~FileBlockSource() {
+    readedBlocks.stop();
+    readThread.join();
+}
+
 void FileBlockSource::initialize() {
     allFiles = leveldb.getAllFiles();
 }
@@ -33,36 +54,134 @@ size_t FileBlockSource::doProcess(size_t countBlocks) {
     return 0;
 }
 
+void FileBlockSource::readBlocksWorker() {
+    ReadedBlock lastBlock;
+    lastBlock.isLast = true;
+    try {
+        while (true) {
+            checkStopSignal();
+
+            if (fileName.empty()) {
+                const FileInfo fi = getNextFile(allFiles, folderPath);
+                fileName = fi.filePos.fileNameRelative;
+                if (fileName.empty()) {
+                    break;
+                }
+                openFile(file, getFullPath(fileName, folderPath));
+                currPos = fi.filePos.pos;
+                LOGINFO << "Open next file " << fileName << " " << currPos;
+            }
+
+            ReadedBlock block;
+            const size_t nextCurrPos = readNextBlockDump(file, currPos, block.dump);
+            if (currPos == nextCurrPos) {
+                closeFile(file);
+                fileName.clear();
+                continue;
+            }
+            block.fileName = fileName;
+            block.pos = currPos;
+            block.nextPos = nextCurrPos;
+
+            currPos = nextCurrPos;
+            allFiles[CroppedFileName(fileName)].filePos.pos = currPos;
+            allFiles[CroppedFileName(fileName)].filePos.fileNameRelative = fileName;
+
+            readedBlocks.push(std::move(block));
+        }
+    } catch (...) {
+        lastBlock.exception = std::current_exception();
+    }
+    readedBlocks.push(std::move(lastBlock));
+}
+
+bool FileBlockSource::readNextBlocks() {
+    if (!isReadThreadStarted) {
+        readThread = Thread(&FileBlockSource::readBlocksWorker, this);
+        isReadThreadStarted = true;
+    }
+
+    //c Берем столько блоков, чтобы занять все потоки разбора, но не ждем больше, чем уже прочитано
+    while (parsedBlocks.size() < countParseThreads * 2) {
+        ReadedBlock block;
+        if (!readedBlocks.pop(block)) {
+            checkStopSignal();
+            throwErr("Read blocks queue stopped");
+        }
+        if (block.isLast) {
+            readThread.join();
+            isReadThreadStarted = false;
+            readException = block.exception;
+            break;
+        }
+        parsedBlocks.emplace_back(std::move(block));
+    }
+
+    if (parsedBlocks.empty()) {
+        if (readException != nullptr) {
+            std::rethrow_exception(std::exchange(readException, nullptr));
+        }
+        return false;
+    }
+
+    parallelFor(std::min(countParseThreads, parsedBlocks.size()), parsedBlocks.begin(), parsedBlocks.end(), [this](ReadedBlock &block) {
+        if (block.blockInfo.has_value()) {
+            return;
+        }
+        try {
+            parseBlock(block);
+        } catch (...) {
+            //c Блок будет разобран повторно при выдаче, чтобы ошибка вылетела в правильном порядке
+        }
+    });
+    return true;
+}
+
+void FileBlockSource::parseBlock(ReadedBlock &block) const {
+    std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> blockInfo =
+        parseNextBlockInfo(block.dump.data(), block.dump.data() + block.dump.size(), block.pos, isValidate, false, 0, 0);
+    std::visit([&block](auto &b) {
+        using T = std::decay_t<decltype(b)>;
+        if constexpr (!std::is_same_v<T, std::monostate>) {
+            b.applyFileNameRelative(block.fileName);
+        }
+    }, blockInfo);
+    block.blockInfo = std::move(blockInfo);
+}
+
+void FileBlockSource::addImportStat(size_t countTxs) {
+    countImportedBlocks++;
+    countImportedTxs += countTxs;
+    importedBlocksMetric.inc();
+    importedTxsMetric.inc(countTxs);
+
+    const time_point now = ::now();
+    const size_t elapsedMs = std::chrono::duration_cast<milliseconds>(now - beginImportStatTime).count();
+    if (elapsedMs >= static_cast<size_t>(IMPORT_STAT_PERIOD.count())) {
+        LOGINFO << "Import from files: " << countImportedBlocks * 1000 / elapsedMs << " blocks/s, " << countImportedTxs * 1000 / elapsedMs << " txs/s";
+        countImportedBlocks = 0;
+        countImportedTxs = 0;
+        beginImportStatTime = now;
+    }
+}
+
 bool FileBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlockInfo> &bi, std::string &binaryDump) {
     while (true) {
         checkStopSignal();
 
-        if (fileName.empty()) {
-            const FileInfo fi = getNextFile(allFiles, folderPath);
-            fileName = fi.filePos.fileNameRelative;
-            if (fileName.empty()) {
+        if (parsedBlocks.empty()) {
+            if (!readNextBlocks()) {
                 return false;
             }
-            openFile(file, getFullPath(fileName, folderPath));
-            currPos = fi.filePos.pos;
-            LOGINFO << "Open next file " << fileName << " " << currPos;
-        }
-        const size_t nextCurrPos = readNextBlockDump(file, currPos, binaryDump);
-        if (currPos == nextCurrPos) {
-            closeFile(file);
-            fileName.clear();
-            continue;
         }
 
-        std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> blockInfo =
-            parseNextBlockInfo(binaryDump.data(), binaryDump.data() + binaryDump.size(), currPos, isValidate, false, 0, 0);
-        std::visit([this](auto &b) {
-            using T = std::decay_t<decltype(b)>;
-            if constexpr (!std::is_same_v<T, std::monostate>) {
-                b.applyFileNameRelative(fileName);
-            }
-        }, blockInfo);
+        if (!parsedBlocks.front().blockInfo.has_value()) {
+            parseBlock(parsedBlocks.front());
+        }
+        ReadedBlock block = std::move(parsedBlocks.front());
+        parsedBlocks.pop_front();
 
+        const std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> &blockInfo = block.blockInfo.value();
         const bool isRejectedBlock = std::visit([&bi](const auto &b) {
             using T = std::decay_t<decltype(b)>;
             if constexpr (std::is_same_v<T, RejectedTxsMinimumBlockHeader>) {
@@ -73,11 +192,13 @@ bool FileBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlockI
             }
         }, blockInfo);
 
-        currPos = nextCurrPos;
-        allFiles[CroppedFileName(fileName)].filePos.pos = currPos;
-        allFiles[CroppedFileName(fileName)].filePos.fileNameRelative = fileName;
-
         if (!isRejectedBlock) {
+            addImportStat(std::holds_alternative<BlockInfo>(blockInfo) ? std::get<BlockInfo>(blockInfo).txs.size() : 0);
+            binaryDump = std::move(block.dump);
+
+            std::lock_guard<std::mutex> lock(confirmMut);
+            notConfirmedBlocks.emplace_back(countReturnedBlocks, FileInfo(block.fileName, block.nextPos));
+            countReturnedBlocks++;
             return true;
         } else {
             const RejectedTxsMinimumBlockHeader &bi = std::get<RejectedTxsMinimumBlockHeader>(blockInfo);
@@ -85,7 +206,13 @@ bool FileBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlockI
             fi.filePos.fileNameRelative = bi.filePos.fileNameRelative;
             fi.filePos.pos = bi.endBlockPos();
 
-            confirmBlockImpl(fi);
+            std::unique_lock<std::mutex> lock(confirmMut);
+            if (notConfirmedBlocks.empty()) {
+                confirmBlockImpl(fi);
+            } else {
+                notConfirmedRejectedBlocks.emplace_back(countReturnedBlocks, fi);
+            }
+            lock.unlock();
 
             rejectedBlockSource.addBlock(bi);
 
@@ -95,10 +222,27 @@ bool FileBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlockI
 }
 
 void FileBlockSource::confirmBlock(const FileInfo &filepos) {
+    std::lock_guard<std::mutex> lock(confirmMut);
     confirmBlockImpl(filepos);
+    
+    const auto found = std::find_if(notConfirmedBlocks.begin(), notConfirmedBlocks.end(), [&filepos](const auto &element) {
+        return element.second.filePos.fileNameRelative == filepos.filePos.fileNameRelative && element.second.filePos.pos == filepos.filePos.pos;
+    });
+    if (found == notConfirmedBlocks.end()) {
+        return;
+    }
+    //c Блоки перед подтвержденным уже не будут подтверждены
+    const size_t confirmedBlocks = found->first + 1;
+    notConfirmedBlocks.erase(notConfirmedBlocks.begin(), std::next(found));
+    
+    while (!notConfirmedRejectedBlocks.empty() && notConfirmedRejectedBlocks.front().first <= confirmedBlocks) {
+        confirmBlockImpl(notConfirmedRejectedBlocks.front().second);
+        notConfirmedRejectedBlocks.pop_front();
+    }
 }
 
 void FileBlockSource::confirmBlockImpl(const FileInfo &filepos) {
+    //c Позиция пишется сразу: при рестарте импорт продолжается с нее, а уже примененный блок повторно не добавится
     Batch batch;
     batch.addFileMetadata(CroppedFileName(filepos.filePos.fileNameRelative), filepos);
 
@@ -11,6 +11,14 @@
 #include <string>
 #include <fstream>
 #include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <exception>
+#include <optional>
+
+#include "BlockedQueue.h"
+#include "Thread.h"
+#include "duration.h"
 
 #include "utils/IfStream.h"
 #include "blockchain_structs/SignBlock.h"
@@ -23,6 +31,8 @@ class LevelDb;
 
 class FileRejectedBlockSource;
 
+class MetricCounter;
+
 class FileBlockSource final: public BlockSource, common::no_copyable, common::no_moveable {
 public:
     
@@ -40,10 +50,33 @@ public:
     
     void getExistingBlock(const BlockHeader &bh, BlockInfo &bi, std::string &blockDump) const override;
     
-    ~FileBlockSource() override = default;
+    ~FileBlockSource() override;
+
+private:
+
+    constexpr static size_t COUNT_READ_AHEAD_BLOCKS = 64;
+
+    struct ReadedBlock {
+        std::string fileName;
+        size_t pos = 0;
+        size_t nextPos = 0;
+        std::string dump;
+        std::optional<std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader>> blockInfo;
+
+        bool isLast = false;
+        std::exception_ptr exception;
+    };
 
 private:
 
+    void readBlocksWorker();
+
+    bool readNextBlocks();
+
+    void parseBlock(ReadedBlock &block) const;
+
+    void addImportStat(size_t countTxs);
+
     void confirmBlockImpl(const FileInfo &filepos);
 
 private:
@@ -56,9 +89,32 @@ private:
        
     std::unordered_map<CroppedFileName, FileInfo> allFiles;
     
+    //c Чтение файлов идет в отдельном потоке на несколько блоков вперед, разбор блоков пачками в несколько потоков
     size_t currPos = 0;
     IfStream file;
     std::string fileName;
+
+    common::BlockedQueue<ReadedBlock, COUNT_READ_AHEAD_BLOCKS> readedBlocks;
+    common::Thread readThread;
+    bool isReadThreadStarted = false;
+    std::exception_ptr readException;
+
+    std::deque<ReadedBlock> parsedBlocks;
+
+    const size_t countParseThreads;
+
+    size_t countImportedBlocks = 0;
+    size_t countImportedTxs = 0;
+    time_point beginImportStatTime;
+    MetricCounter &importedBlocksMetric;
+    MetricCounter &importedTxsMetric;
+
+    //c process и confirmBlock могут вызываться из разных потоков.
+    //c Позиция rejected блока сохраняется только после подтверждения всех прочитанных до него блоков
+    std::mutex confirmMut;
+    size_t countReturnedBlocks = 0;
+    std::deque<std::pair<size_t, FileInfo>> notConfirmedBlocks;
+    std::deque<std::pair<size_t, FileInfo>> notConfirmedRejectedBlocks;
     
     const bool isValidate;
     
@@ -55,7 +55,7 @@ GetNewBlocksFromServer::LastBlockResponse GetNewBlocksFromServer::getLastBlock()
         }
     };
     
-    p2p.broadcast("", makeGetCountBlocksMessage(), "", function);
+    p2p.broadcastHedged("", makeGetCountBlocksMessage(), "", function);
     
     LastBlockResponse response;
     if (lastBlock.has_value()) {
@@ -172,7 +172,8 @@ MinimumBlockHeader GetNewBlocksFromServer::getBlockHeader(size_t blockNum, size_
     
     advancedLoadsBlocksHeaders.clear();
         
-    const size_t countBlocks = std::min(maxBlockNum - blockNum + 1, maxAdvancedLoadBlocks);
+    CHECK(maxBlockNum >= blockNum, "Incorrect max block num");
+    const size_t countBlocks = maxBlockNum - blockNum + 1;
     const size_t countParts = (countBlocks + countBlocksInBatch - 1) / countBlocksInBatch;
     CHECK(countBlocks != 0 && countParts != 0, "Incorrect count blocks");
     
@@ -332,9 +333,15 @@ void GetNewBlocksFromServer::loadBlockDumpsToCache(const std::vector<std::string
 }
 
 std::string GetNewBlocksFromServer::getBlockDump(const std::string& blockHash, size_t blockSize, bool isPrecisionSize, bool loadAll, const std::vector<std::string> &hintsServers, bool isSign) const {
+    const auto takeDump = [this](std::unordered_map<std::string, std::string>::iterator iter) {
+        std::string dump = std::move(iter->second);
+        advancedLoadsBlocksDumps.erase(iter);
+        return dump;
+    };
+    
     const auto foundDump = advancedLoadsBlocksDumps.find(blockHash);
     if (foundDump != advancedLoadsBlocksDumps.end()) {
-        return foundDump->second;
+        return takeDump(foundDump);
     }
     
     const auto foundHeader = std::find_if(advancedLoadsBlocksHeaders.begin(), advancedLoadsBlocksHeaders.end(), [&blockHash](const auto &pair) {
@@ -360,14 +367,15 @@ std::string GetNewBlocksFromServer::getBlockDump(const std::string& blockHash, s
     
     loadBlockDumpsToCache(blocksHashs, hintsServers, isSign);
     
-    if (advancedLoadsBlocksDumps.find(blockHash) == advancedLoadsBlocksDumps.end()) {
+    const auto foundLoadedDump = advancedLoadsBlocksDumps.find(blockHash);
+    if (foundLoadedDump == advancedLoadsBlocksDumps.end()) {
         if (loadAll) {
             return getBlockDumpWithoutAdvancedLoad(blockHash, hintsServers, isSign);
         } else {
             return getBlockDumpWithoutAdvancedLoad(blockHash, blockSize, isPrecisionSize, hintsServers, isSign);
         }
     } else {
-        return advancedLoadsBlocksDumps[blockHash];
+        return takeDump(foundLoadedDump);
     }
 }
 
@@ -50,9 +50,8 @@ public:
     
 public:
     
-    GetNewBlocksFromServer(size_t maxAdvancedLoadBlocks, size_t countBlocksInBatch, P2P &p2p, bool isCompress)
-        : maxAdvancedLoadBlocks(maxAdvancedLoadBlocks)
-        , countBlocksInBatch(countBlocksInBatch)
+    GetNewBlocksFromServer(size_t countBlocksInBatch, P2P &p2p, bool isCompress)
+        : countBlocksInBatch(countBlocksInBatch)
         , p2p(p2p)
         , isCompress(isCompress)
     {}
@@ -63,10 +62,16 @@ public:
     
     std::vector<std::string> addPreLoadBlocks(size_t fromBlock, const std::string &blockHeadersStr, const std::string &additionalBlockHashsesStr, const std::string &blockDumpsStr);
     
+    /**
+     *c Если заголовка нет в кэше, загружает заголовки блоков с blockNum по maxBlockNum
+     */
     MinimumBlockHeader getBlockHeader(size_t blockNum, size_t maxBlockNum, const std::vector<std::string> &servers);
     
     MinimumBlockHeader getBlockHeaderWithoutAdvanceLoad(size_t blockNum, const std::string &server) const;
     
+    /**
+     *c Отданный дамп удаляется из кэша предзагрузки
+     */
     std::string getBlockDump(const std::string &blockHash, size_t blockSize, bool isPrecisionSize, bool loadAll, const std::vector<std::string> &hintsServers, bool isSign) const;
     
     std::string getBlockDumpWithoutAdvancedLoad(const std::string &blockHash, size_t blockSize, bool isPrecisionSize, const std::vector<std::string> &hintsServers, bool isSign) const;
@@ -81,8 +86,6 @@ private:
     
 private:
     
-    const size_t maxAdvancedLoadBlocks;
-    
     const size_t countBlocksInBatch;
     
     P2P &p2p;
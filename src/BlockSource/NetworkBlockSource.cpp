@@ -19,8 +19,6 @@ using namespace common;
 
 namespace torrent_node_lib {
 
-const static size_t COUNT_ADVANCED_BLOCKS = 8;
-    
 NetworkBlockSource::AdvancedBlock::Key NetworkBlockSource::AdvancedBlock::key() const {
     return Key(header.hash, header.number, pos);
 }
@@ -29,9 +27,10 @@ bool NetworkBlockSource::AdvancedBlock::Key::operator<(const Key &second) const
     return std::make_tuple(this->number, this->pos, this->hash) < std::make_tuple(second.number, second.pos, second.hash);
 }
 
-NetworkBlockSource::NetworkBlockSource(const BlocksTimeline &timeline, const std::string &folderPath, size_t maxAdvancedLoadBlocks, size_t countBlocksInBatch, bool isCompress, P2P &p2p, bool saveAllTx, bool isValidate, bool isVerifySign, bool isPreLoad) 
+NetworkBlockSource::NetworkBlockSource(const BlocksTimeline &timeline, const std::string &folderPath, size_t initAdvancedLoadBlocks, size_t advancedLoadBudgetBytes, size_t countBlocksInBatch, bool isCompress, P2P &p2p, bool saveAllTx, bool isValidate, bool isVerifySign, bool isPreLoad) 
     : timeline(timeline)
-    , getterBlocks(maxAdvancedLoadBlocks, countBlocksInBatch, p2p, isCompress)
+    , getterBlocks(countBlocksInBatch, p2p, isCompress)
+    , prefetchWindow(initAdvancedLoadBlocks, advancedLoadBudgetBytes)
     , folderPath(folderPath)
     , saveAllTx(saveAllTx)
     , isValidate(isValidate)
@@ -50,6 +49,7 @@ size_t NetworkBlockSource::doProcess(size_t countBlocks) {
     getterBlocks.clearAdvanced();
     currentProcessedBlock = advancedBlocks.end();
     afterBlocksAdditings.clear();
+    roundReadyTime.reset();
     
     if (!isPreLoad) {
         const GetNewBlocksFromServer::LastBlockResponse lastBlock = getterBlocks.getLastBlock();
@@ -193,24 +193,35 @@ bool NetworkBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlo
     if (afterBlocksAdditings.isClear()) {
         CHECK(lastBlockInBlockchain >= nextBlockToRead, "New blocks absent");
         
+        if (roundReadyTime.has_value()) {
+            prefetchWindow.addProcessed(roundCountBlocks, std::chrono::duration_cast<milliseconds>(::now() - roundReadyTime.value()));
+        }
+        
         advancedBlocks.clear();
         
-        const size_t countAdvanced = std::min(COUNT_ADVANCED_BLOCKS, lastBlockInBlockchain - nextBlockToRead + 1);
+        const size_t countAdvanced = std::min(prefetchWindow.getWindow(), lastBlockInBlockchain - nextBlockToRead + 1);
+        const size_t lastAdvancedBlock = nextBlockToRead + countAdvanced - 1;
         
         CHECK(!servers.empty(), "Servers empty");
+        Timer tt;
+        size_t downloadedBytes = 0;
         for (size_t i = 0; i < countAdvanced; i++) {
             const size_t currBlock = nextBlockToRead + i;
             AdvancedBlock advanced;
             advanced.pos = AdvancedBlock::BlockPos::Block;
             try {
-                advanced.header = getterBlocks.getBlockHeader(currBlock, lastBlockInBlockchain, servers);
+                advanced.header = getterBlocks.getBlockHeader(currBlock, lastAdvancedBlock, servers);
                 advanced.dump = getterBlocks.getBlockDump(advanced.header.hash, advanced.header.blockSize, true, false, servers, isVerifySign);
+                downloadedBytes += advanced.dump.size();
             } catch (...) {
                 advanced.exception = std::current_exception();
             }
             CHECK(currBlock == advanced.header.number, "Incorrect data");
             advancedBlocks.emplace(advanced.key(), advanced);
         }
+        tt.stop();
+        prefetchWindow.addDownloaded(countAdvanced, downloadedBytes, tt.count());
+        roundCountBlocks = countAdvanced;
         
         for (const auto &[key, advanced]: advancedBlocks) {
             for (const std::string &blockHash: advanced.header.prevExtraBlocks) {
@@ -223,6 +234,7 @@ bool NetworkBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlo
     } else {
         CHECK(advancedBlocks.empty(), "Incorrect advanced blocks");
         
+        roundCountBlocks = 0;
         for (const std::string &hash: afterBlocksAdditings.hashes) {
             additingBlocks.emplace_back(AdditingBlock::Type::AfterBlock, afterBlocksAdditings.blockNumber, hash, afterBlocksAdditings.file);
         }
@@ -234,6 +246,12 @@ bool NetworkBlockSource::process(std::variant<std::monostate, BlockInfo, SignBlo
     
     parseBlockInfo();
     
+    if (roundCountBlocks != 0) {
+        roundReadyTime = ::now();
+    } else {
+        roundReadyTime.reset();
+    }
+    
     if (currentProcessedBlock != advancedBlocks.end()) {
         processAdvanced(bi, binaryDump, currentProcessedBlock);
         return true;
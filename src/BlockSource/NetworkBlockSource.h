@@ -8,6 +8,7 @@
 #include "blockchain_structs/BlockInfo.h"
 
 #include "GetNewBlocksFromServers.h"
+#include "PrefetchWindow.h"
 #include "blockchain_structs/SignBlock.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
 
@@ -15,6 +16,9 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <optional>
+
+#include "duration.h"
 
 namespace torrent_node_lib {
     
@@ -25,7 +29,7 @@ class BlocksTimeline;
 class NetworkBlockSource final: public BlockSource, common::no_copyable, common::no_moveable {
 public:
     
-    NetworkBlockSource(const BlocksTimeline &timeline, const std::string &folderPath, size_t maxAdvancedLoadBlocks, size_t countBlocksInBatch, bool isCompress, P2P &p2p, bool saveAllTx, bool isValidate, bool isVerifySign, bool isPreLoad);
+    NetworkBlockSource(const BlocksTimeline &timeline, const std::string &folderPath, size_t initAdvancedLoadBlocks, size_t advancedLoadBudgetBytes, size_t countBlocksInBatch, bool isCompress, P2P &p2p, bool saveAllTx, bool isValidate, bool isVerifySign, bool isPreLoad);
     
     void initialize() override;
     
@@ -118,6 +122,12 @@ private:
     
     GetNewBlocksFromServer getterBlocks;
     
+    PrefetchWindow prefetchWindow;
+    
+    //c Когда стали доступны блоки последнего раунда предзагрузки. Для замера скорости их обработки
+    std::optional<time_point> roundReadyTime;
+    size_t roundCountBlocks = 0;
+    
     const std::string folderPath;
     
     size_t nextBlockToRead = 0;
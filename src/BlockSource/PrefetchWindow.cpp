@@ -0,0 +1,106 @@
+#include "PrefetchWindow.h"
+
+#include <algorithm>
+
+#include "check.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+const static size_t MIN_WINDOW = 1;
+
+const static size_t MAX_WINDOW = 4096;
+
+const static double AVERAGE_ALPHA = 0.3;
+
+//c Рост окна, ускоривший скачивание блока меньше чем на эту долю, считается бесполезным
+const static double SIGNIFICANT_CHANGE = 0.1;
+
+//c Если скачивание занимает меньше этой доли от обработки, большее окно только тратит память
+const static double DOWNLOAD_SHARE_ENOUGH = 0.1;
+
+//c Через столько раундов без изменений окно снова пробует вырасти
+const static size_t PROBE_ROUNDS = 16;
+
+static void addAverage(double &average, double value) {
+    if (average == 0) {
+        average = value;
+    } else {
+        average += AVERAGE_ALPHA * (value - average);
+    }
+}
+
+PrefetchWindow::PrefetchWindow(size_t initialBlocks, size_t budgetBytes)
+    : window(std::clamp(initialBlocks, MIN_WINDOW, MAX_WINDOW))
+    , budgetBytes(budgetBytes)
+{
+    CHECK(budgetBytes != 0, "Incorrect prefetch budget");
+}
+
+size_t PrefetchWindow::getWindow() const {
+    return window;
+}
+
+void PrefetchWindow::applyBudget() {
+    if (blockSize != 0) {
+        const size_t maxByBudget = static_cast<size_t>(budgetBytes / blockSize);
+        window = std::min(window, std::max(maxByBudget, MIN_WINDOW));
+    }
+}
+
+void PrefetchWindow::addDownloaded(size_t countBlocks, size_t bytes, const milliseconds &time) {
+    if (countBlocks == 0) {
+        return;
+    }
+    addAverage(blockSize, static_cast<double>(bytes) / countBlocks);
+    
+    //c У вершины цепочки раунд меньше окна и ничего не говорит о его размере
+    if (countBlocks < window) {
+        applyBudget();
+        return;
+    }
+    
+    const double msPerBlock = std::max<double>(time.count(), 1.) / countBlocks;
+    const auto grow = [this]{
+        windowBeforeGrow = window;
+        window = std::min(window * 2, MAX_WINDOW);
+        isGrown = true;
+        countStableRounds = 0;
+    };
+    const auto shrink = [this]{
+        window = std::max(window * 3 / 4, MIN_WINDOW);
+        isGrown = false;
+        countStableRounds = 0;
+    };
+    //c С предыдущим раундом сравниваем только после роста окна: так видно, помог ли рост. Не помог - откатываем
+    if (processMsPerBlock != 0 && msPerBlock < processMsPerBlock * DOWNLOAD_SHARE_ENOUGH) {
+        shrink();
+    } else if (!prevDownloadMsPerBlock.has_value()) {
+        grow();
+    } else if (isGrown) {
+        if (msPerBlock < prevDownloadMsPerBlock.value() * (1. - SIGNIFICANT_CHANGE)) {
+            grow();
+        } else {
+            window = windowBeforeGrow;
+            isGrown = false;
+        }
+    } else {
+        countStableRounds++;
+        if (countStableRounds >= PROBE_ROUNDS) {
+            grow();
+        }
+    }
+    prevDownloadMsPerBlock = msPerBlock;
+    
+    applyBudget();
+}
+
+void PrefetchWindow::addProcessed(size_t countBlocks, const milliseconds &time) {
+    if (countBlocks == 0) {
+        return;
+    }
+    addAverage(processMsPerBlock, std::max<double>(time.count(), 1.) / countBlocks);
+}
+
+} // namespace torrent_node_lib
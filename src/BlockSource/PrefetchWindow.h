@@ -0,0 +1,56 @@
+#ifndef PREFETCH_WINDOW_H_
+#define PREFETCH_WINDOW_H_
+
+#include <optional>
+
+#include "duration.h"
+
+namespace torrent_node_lib {
+
+/**
+ *c Размер окна предварительной загрузки блоков. Окно растет, пока это уменьшает время скачивания одного блока
+ *c и скачивание остается узким местом по сравнению с обработкой. Сверху ограничено бюджетом памяти
+ */
+class PrefetchWindow {
+public:
+    
+    PrefetchWindow(size_t initialBlocks, size_t budgetBytes);
+    
+    size_t getWindow() const;
+    
+    /**
+     *c Раунд скачал countBlocks блоков общим размером bytes за time
+     */
+    void addDownloaded(size_t countBlocks, size_t bytes, const milliseconds &time);
+    
+    /**
+     *c Скачанные за раунд countBlocks блоков обработаны за time
+     */
+    void addProcessed(size_t countBlocks, const milliseconds &time);
+    
+private:
+    
+    void applyBudget();
+    
+private:
+    
+    size_t window;
+    
+    const size_t budgetBytes;
+    
+    double blockSize = 0;
+    
+    double processMsPerBlock = 0;
+    
+    std::optional<double> prevDownloadMsPerBlock;
+    
+    bool isGrown = false;
+    size_t windowBeforeGrow = 0;
+    
+    size_t countStableRounds = 0;
+    
+};
+
+} // namespace torrent_node_lib
+
+#endif // PREFETCH_WINDOW_H_
@@ -5,6 +5,9 @@
 #include <iostream>
 
 #include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/encodedstream.h>
 
 #include "jsonUtils.h"
 
@@ -13,7 +16,11 @@
 #include "convertStrings.h"
 
 #include "Modules.h"
+#include "Cache/Cache.h"
+#include "utils/Metrics.h"
+#include "utils/ThreadPool.h"
 #include "blockchain_structs/BlockInfo.h"
+#include "blockchain_structs/BlocksMetadata.h"
 
 #include "BlockchainUtils.h"
 #include "blockchain_structs/TransactionInfo.h"
@@ -36,6 +43,22 @@ const static size_t SIGN_BLOCK_HEADER_SIZE = 3*sizeof(uint64_t)+32;
 const static uint64_t SIGN_BLOCK_TYPE = 0x1100111167452301;
 const static uint64_t REJECTED_TXS_BLOCK_TYPE = 0x3300111167452301;
 
+//c Один пул на все разбираемые блоки, в том числе из потоков, которые сами разбирают блоки параллельно
+static std::unique_ptr<ThreadPool> validatePool = std::make_unique<ThreadPool>(1);
+
+//c Транзакция с тем же хэшем содержит те же данные и подпись, поэтому повторная проверка не нужна.
+//c Хранятся только успешно проверенные подписи
+static std::unique_ptr<Cache<bool>> verifiedSignsCache;
+
+void setCountThreadsValidateSigns(size_t countThreads) {
+    CHECK(countThreads != 0, "Incorrect count threads");
+    validatePool = std::make_unique<ThreadPool>(countThreads);
+}
+
+void setVerifiedSignsCacheSize(size_t maxSizeBytes) {
+    verifiedSignsCache = std::make_unique<Cache<bool>>(maxSizeBytes, "signs");
+}
+
 void openFile(IfStream &file, const std::string &fileName) {
     CHECK(!fileName.empty(), "Empty file name");
     file.open(fileName);
@@ -58,24 +81,6 @@ static size_t fileSize(IfStream &ifile) {
     return ifile.fileSize();
 }
 
-static size_t fileSize(std::ofstream &ifile) {
-    ifile.clear();
-    ifile.seekp(0, std::ios_base::end);
-    CHECK(ifile.good(), "Incorrect get size file");
-    return ifile.tellp();
-}
-
-size_t saveBlockToFileBinary(const std::string& fileName, const std::string& data) {
-    std::ofstream file(fileName, std::ios::binary | std::ios::app);
-    const size_t oldSize = fileSize(file);
-    const uint64_t blockSize = data.size();
-    const std::string blockSizeStr(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
-    file << blockSizeStr;
-    file << data;
-    CHECK(fileSize(file) == oldSize + blockSizeStr.size() + data.size(), "Incorrect write block operation");
-    return oldSize;
-}
-
 template<typename T>
 static uint64_t readInt(const char *&cur_pos, const char *end_pos) {
     CHECK(cur_pos + sizeof(T) <= end_pos, "Out of the array");
@@ -160,6 +165,165 @@ struct PrevTransactionSignHelper {
     std::vector<unsigned char> prevTxData;
 };
 
+struct SignCheckTask {
+    std::vector<char> sign;
+    std::vector<unsigned char> pubkey;
+    const char *begin;
+    const char *end;
+    std::string txHash;
+    //c Номер в пачке хэшей, если хэш транзакции еще не посчитан
+    std::optional<size_t> hashIndex;
+    
+    SignCheckTask(const std::vector<char> &sign, const std::vector<unsigned char> &pubkey, const char *begin, const char *end, const std::string &txHash, const std::optional<size_t> &hashIndex)
+        : sign(sign)
+        , pubkey(pubkey)
+        , begin(begin)
+        , end(end)
+        , txHash(txHash)
+        , hashIndex(hashIndex)
+    {}
+};
+
+using HashTasks = std::vector<std::pair<const unsigned char*, size_t>>;
+
+//c Проверяет подписи параллельно. Ошибка выдается по первой в порядке блока невалидной транзакции
+static void checkSigns(const std::vector<SignCheckTask> &tasks) {
+    std::vector<char> isValid(tasks.size(), 0);
+    
+    static MetricCounter &cacheHits = getMetrics().counter("torrent_verified_signs_cache_hits_total", "Tx signatures found in verified signs cache");
+    static MetricCounter &cacheMisses = getMetrics().counter("torrent_verified_signs_cache_misses_total", "Tx signatures checked by secp256k1");
+    
+    Cache<bool> *cache = verifiedSignsCache.get();
+    const auto checkSign = [&tasks, &isValid, cache](size_t index) {
+        const SignCheckTask &task = tasks[index];
+        std::optional<HashedString> cacheKey;
+        if (cache != nullptr && cache->isEnabled()) {
+            cacheKey = HashedString(task.txHash + std::string(task.pubkey.begin(), task.pubkey.end()));
+            if (cache->getValue(cacheKey.value()).has_value()) {
+                cacheHits.inc();
+                isValid[index] = 1;
+                return;
+            }
+            cacheMisses.inc();
+        }
+        try {
+            isValid[index] = crypto_check_sign_data(task.sign, task.pubkey, (const unsigned char*)task.begin, std::distance(task.begin, task.end));
+        } catch (...) {
+            isValid[index] = 0;
+        }
+        if (isValid[index] && cacheKey.has_value()) {
+            cache->addValue(cacheKey.value(), true);
+        }
+    };
+    validatePool->parallelFor(tasks.size(), checkSign);
+    
+    const auto found = std::find(isValid.begin(), isValid.end(), 0);
+    if (found != isValid.end()) {
+        const SignCheckTask &task = tasks[std::distance(isValid.begin(), found)];
+        throwErr("Not validate tx " + toHex(task.txHash.begin(), task.txHash.end()));
+    }
+}
+
+/**
+ *c Sax обработчик, который достает из json транзакции только method и params.value, не строя документ.
+ *c При повторах ключей берется первый, как в rapidjson::Document
+ */
+class TxDataScanner: public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, TxDataScanner> {
+public:
+    
+    std::optional<std::string> method;
+    std::optional<std::string> paramsValue;
+    
+public:
+    
+    bool Default() {
+        currField = Field::Other;
+        return true;
+    }
+    
+    bool String(const char *str, rapidjson::SizeType length, bool copy) {
+        if (currField == Field::Method) {
+            method = std::string(str, length);
+        } else if (currField == Field::ParamsValue) {
+            paramsValue = std::string(str, length);
+        }
+        currField = Field::Other;
+        return true;
+    }
+    
+    bool Key(const char *str, rapidjson::SizeType length, bool copy) {
+        const std::string_view key(str, length);
+        currField = Field::Other;
+        if (depth == 1 && !isMethodFound && key == "method") {
+            currField = Field::Method;
+            isMethodFound = true;
+        } else if (depth == 1 && !isParamsFound && key == "params") {
+            currField = Field::Params;
+            isParamsFound = true;
+        } else if (depth == 2 && isInParams && !isParamsValueFound && key == "value") {
+            currField = Field::ParamsValue;
+            isParamsValueFound = true;
+        }
+        return true;
+    }
+    
+    bool StartObject() {
+        if (currField == Field::Params) {
+            isInParams = true;
+        }
+        currField = Field::Other;
+        depth++;
+        return true;
+    }
+    
+    bool EndObject(rapidjson::SizeType memberCount) {
+        depth--;
+        if (depth == 1) {
+            isInParams = false;
+        }
+        return true;
+    }
+    
+    bool StartArray() {
+        currField = Field::Other;
+        depth++;
+        return true;
+    }
+    
+    bool EndArray(rapidjson::SizeType elementCount) {
+        depth--;
+        return true;
+    }
+    
+private:
+    
+    enum class Field {
+        Other, Method, Params, ParamsValue
+    };
+    
+    Field currField = Field::Other;
+    size_t depth = 0;
+    bool isInParams = false;
+    bool isMethodFound = false;
+    bool isParamsFound = false;
+    bool isParamsValueFound = false;
+};
+
+static std::optional<TxDataScanner> scanTxData(const std::vector<unsigned char> &data) {
+    rapidjson::MemoryStream ms((const char*)data.data(), data.size());
+    rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> is(ms);
+    rapidjson::Reader reader;
+    TxDataScanner scanner;
+    if (!reader.Parse(is, scanner)) {
+        return std::nullopt;
+    }
+    return scanner;
+}
+
+static bool isTokenMethod(const std::string &method) {
+    return method == "token-create" || method == "token-transfer" || method == "burn-tokens";
+}
+
 static bool isSignBlockTx(const TransactionInfo &txInfo, const PrevTransactionSignHelper &helper) {
     if (!helper.isPrevSign) {
         return false;
@@ -219,7 +383,7 @@ static std::tuple<bool, SizeTransactinType, const char*> readRedjectedTransactio
     return std::make_tuple(true, tx_size, cur_pos);
 }
 
-static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionInfo(const char *cur_pos, const char *end_pos, TransactionInfo &txInfo, bool isParseTx, bool isSaveAllTx, const PrevTransactionSignHelper &helper, bool isValidate) {    
+static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionInfo(const char *cur_pos, const char *end_pos, TransactionInfo &txInfo, bool isParseTx, bool isSaveAllTx, const PrevTransactionSignHelper &helper, std::vector<SignCheckTask> *signTasks, HashTasks *hashTasks) {    
     const char * const allTxStart = cur_pos;
     
     bool isBlockedFrom = false;
@@ -248,39 +412,32 @@ static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionIn
     txInfo.data = std::vector<unsigned char>(cur_pos, cur_pos + dataSize);
     cur_pos += dataSize;
     
-    std::optional<rapidjson::Document> docData;
+    //c Полный документ строится только для токенов, остальным достаточно method и params.value
+    std::optional<TxDataScanner> jsonData;
     if (dataSize > 0) {
         if (txInfo.data[0] == '{' && txInfo.data[txInfo.data.size() - 1] == '}') {
-            docData = rapidjson::Document();
-            const rapidjson::ParseResult pr = docData->Parse((const char*)txInfo.data.data(), txInfo.data.size());
-            if (!pr) {
-                docData.reset();
-            }
+            jsonData = scanTxData(txInfo.data);
         }
     }
     
     if (dataSize > 0) {
         if (dataSize == 9 && txInfo.data[0] == 1) {
             isBlockedFrom = true;
-        } else if (docData.has_value()) {
-            const rapidjson::Document &doc = *docData;
-            if (doc.HasMember("method") && doc["method"].IsString()) {
-                const std::string method = doc["method"].GetString();
+        } else if (jsonData.has_value()) {
+            if (jsonData->method.has_value()) {
+                const std::string &method = jsonData->method.value();
                 if (method == "delegate" || method == "undelegate") {
                     TransactionInfo::DelegateInfo delegateInfo;
                     
                     delegateInfo.isDelegate = method == "delegate";
                     if (delegateInfo.isDelegate) {
-                        if (doc.HasMember("params") && doc["params"].IsObject()) {
-                            const auto &paramsJson = doc["params"];
-                            if (paramsJson.HasMember("value") && paramsJson["value"].IsString()) {
-                                try {
-                                    delegateInfo.value = std::stoull(paramsJson["value"].GetString());
-                                    txInfo.delegate = delegateInfo;
-                                } catch (...) {
-                                    // ignore
-                                }
-                            }                               
+                        if (jsonData->paramsValue.has_value()) {
+                            try {
+                                delegateInfo.value = std::stoull(jsonData->paramsValue.value());
+                                txInfo.delegate = delegateInfo;
+                            } catch (...) {
+                                // ignore
+                            }
                         }
                     } else {
                         txInfo.delegate = delegateInfo;
@@ -298,10 +455,9 @@ static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionIn
             txInfo.isModuleNotSet = true;
         }
         
-        if (docData.has_value()) {
-            const rapidjson::Document &doc = *docData;
-            if (doc.HasMember("method") && doc["method"].IsString()) {
-                const std::string method = doc["method"].GetString();
+        if (jsonData.has_value()) {
+            if (jsonData->method.has_value()) {
+                const std::string &method = jsonData->method.value();
                 if (method == "compile") {
                     txInfo.scriptInfo.value().type = TransactionInfo::ScriptInfo::ScriptType::compile;
                 } else if (method == "run") {
@@ -344,8 +500,15 @@ static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionIn
     }
         
     CHECK(tx_start != nullptr, "Ups");
-    const std::array<unsigned char, 32> tx_hash = get_double_sha256((unsigned char *)tx_start, tx_hash_size);
-    txInfo.hash = std::string(tx_hash.cbegin(), tx_hash.cend());
+    std::optional<size_t> hashIndex;
+    if (hashTasks != nullptr) {
+        //c Хэш посчитает вызывающий пачкой вместе с остальными транзакциями блока
+        hashIndex = hashTasks->size();
+        hashTasks->emplace_back((const unsigned char*)tx_start, tx_hash_size);
+    } else {
+        const std::array<unsigned char, 32> tx_hash = get_double_sha256((unsigned char *)tx_start, tx_hash_size);
+        txInfo.hash = std::string(tx_hash.cbegin(), tx_hash.cend());
+    }
     
     if (txInfo.scriptInfo.has_value()) {
         CHECK(endClearTx != nullptr, "End tx not found");
@@ -359,9 +522,9 @@ static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionIn
     
     txInfo.isSignBlockTx = isSignBlockTx(txInfo, helper);
     
-    if (isValidate) {
+    if (signTasks != nullptr) {
         if (!txInfo.fromAddress.isInitialWallet()) {
-            CHECK(crypto_check_sign_data(txInfo.sign, txInfo.pubKey, (const unsigned char*)tx_start, std::distance(tx_start, endClearTx)), "Not validate");
+            signTasks->emplace_back(txInfo.sign, txInfo.pubKey, tx_start, endClearTx, txInfo.hash, hashIndex);
         }
     }
         
@@ -431,35 +594,40 @@ static std::tuple<bool, SizeTransactinType, const char*> readSimpleTransactionIn
             return std::nullopt;
         };
         
+        std::optional<rapidjson::Document> docData;
+        if (jsonData.has_value() && jsonData->method.has_value() && isTokenMethod(jsonData->method.value())) {
+            docData = rapidjson::Document();
+            const rapidjson::ParseResult pr = docData->Parse((const char*)txInfo.data.data(), txInfo.data.size());
+            if (!pr) {
+                docData.reset();
+            }
+        }
         txInfo.tokenInfo = parseTokenInfo(docData);
     }
     
     return std::make_tuple(true, tx_size, cur_pos);
 }
 
-static SizeTransactinType getSizeSimpleTransaction(IfStream &ifile) {
-    const size_t max_varint_size = sizeof(uint64_t) + sizeof(uint8_t);
-    std::vector<char> fh_buff(max_varint_size, 0);
-    ifile.read(fh_buff.data(), fh_buff.size());
-    const char *curPos = fh_buff.data();
-    const SizeTransactinType sizeTx = readVarInt(curPos, fh_buff.data() + fh_buff.size());
-    return sizeTx;
+static void remapFile(std::shared_ptr<const MappedFile> &file, size_t needSize) {
+    if (file->size() < needSize) {
+        file = openMappedFile(file->getFileName(), needSize);
+    }
 }
 
-bool readOneSimpleTransactionInfo(IfStream &ifile, size_t currPos, TransactionInfo &txInfo, bool isSaveAllTx) {
-    const size_t f_size = fileSize(ifile);
+bool readOneSimpleTransactionInfo(std::shared_ptr<const MappedFile> &file, size_t currPos, TransactionInfo &txInfo, bool isSaveAllTx) {
+    const size_t max_varint_size = sizeof(uint64_t) + sizeof(uint8_t);
+    remapFile(file, currPos + max_varint_size);
     
+    const size_t f_size = file->size();
     if (f_size <= currPos) {
         return false;
     } else if ((f_size - currPos) >= sizeof(SizeTransactinType)) {
-        seekFile(ifile, currPos);
-        const SizeTransactinType sizeTx = getSizeSimpleTransaction(ifile);
+        const char *curPos = file->data() + currPos;
+        const SizeTransactinType sizeTx = readVarInt(curPos, file->data() + f_size);
+        remapFile(file, std::distance(file->data(), curPos) + sizeTx);
         
-        std::vector<char> fh_buff(sizeTx + 2 * sizeof(SizeTransactinType), 0);
-        seekFile(ifile, currPos);
-        ifile.read(fh_buff.data(), fh_buff.size());
-        
-        const auto tuple = readSimpleTransactionInfo(fh_buff.data(), fh_buff.data() + fh_buff.size(), txInfo, true, isSaveAllTx, PrevTransactionSignHelper(), false);
+        const char *beginTx = file->data() + currPos;
+        const auto tuple = readSimpleTransactionInfo(beginTx, file->data() + file->size(), txInfo, true, isSaveAllTx, PrevTransactionSignHelper(), nullptr, nullptr);
 
         return std::get<0>(tuple);
     }
@@ -473,21 +641,26 @@ static void readSimpleBlockTxs(const char *begin_pos, const char *end_pos, size_
     std::array<unsigned char, 32> block_hash = get_double_sha256((unsigned char *)begin_pos, std::distance(begin_pos, end_pos));
     bi.header.hash.assign(block_hash.cbegin(), block_hash.cend());
     
+    //c Целостность списка транзакций проверяется до их разбора
     std::array<unsigned char, 32> txs_hash = get_double_sha256((unsigned char *)cur_pos, std::distance(cur_pos, end_pos));
     CHECK(bi.header.txsHash.size() == txs_hash.size() && std::equal(txs_hash.begin(), txs_hash.end(), bi.header.txsHash.begin()), "Incorrect txs hash");
     
+    //c Хэши самих транзакций считаются после разбора, пачка делится между потоками пула проверки
+    HashTasks hashTasks;
+    
     SizeTransactinType tx_size = 0;
     size_t txIndex = 0;
     PrevTransactionSignHelper prevTransactionSignBlockHelper;
     prevTransactionSignBlockHelper.isFirst = true;
     prevTransactionSignBlockHelper.isPrevSign = true;
     size_t countSignTxs = 0;
+    std::vector<SignCheckTask> signTasks;
     do {
         TransactionInfo txInfo;
         txInfo.filePos.pos = cur_pos - begin_pos + posInFile + BLOCK_SIZE_SIZE;
         
         const bool isReadTransaction = txIndex >= beginTx;
-        const auto &[isInitialized, newSize, newPos] = readSimpleTransactionInfo(cur_pos, end_pos, txInfo, isReadTransaction, isSaveAllTx, prevTransactionSignBlockHelper, isValidate);
+        const auto &[isInitialized, newSize, newPos] = readSimpleTransactionInfo(cur_pos, end_pos, txInfo, isReadTransaction, isSaveAllTx, prevTransactionSignBlockHelper, isValidate ? &signTasks : nullptr, &hashTasks);
         txInfo.blockIndex = txIndex;
         
         tx_size = newSize;
@@ -509,6 +682,24 @@ static void readSimpleBlockTxs(const char *begin_pos, const char *end_pos, size_
         
         txIndex++;
     } while (tx_size > 0);
+    
+    const std::vector<std::array<unsigned char, 32>> hashes = get_double_sha256_parallel(hashTasks, *validatePool);
+    //c Каждая разобранная транзакция добавила ровно один хэш и попала в bi.txs
+    CHECK(hashes.size() == bi.txs.size(), "Incorrect count tx hashes");
+    for (size_t i = 0; i < bi.txs.size(); i++) {
+        const std::array<unsigned char, 32> &tx_hash = hashes[i];
+        bi.txs[i].hash = std::string(tx_hash.cbegin(), tx_hash.cend());
+    }
+    
+    if (isValidate) {
+        for (SignCheckTask &task: signTasks) {
+            if (task.hashIndex.has_value()) {
+                const std::array<unsigned char, 32> &tx_hash = hashes[task.hashIndex.value()];
+                task.txHash = std::string(tx_hash.cbegin(), tx_hash.cend());
+            }
+        }
+        checkSigns(signTasks);
+    }
     if (countTx == 0) {
         bi.header.countTxs = bi.txs.size();
         bi.header.countSignTx = countSignTxs;
@@ -522,6 +713,42 @@ static void readSimpleBlockTxs(const char *begin_pos, const char *end_pos, size_
     }
 }
 
+std::vector<TransactionInfo> readSimpleBlockTxsPart(std::shared_ptr<const MappedFile> &file, const BlockHeader &bh, const BlockTxsOffsets &txsOffsets, size_t beginTx, size_t countTx) {
+    std::vector<TransactionInfo> result;
+    const size_t offsetIndex = beginTx / BlockTxsOffsets::STEP;
+    if (offsetIndex >= txsOffsets.offsets.size()) {
+        return result;
+    }
+    
+    const size_t blockEnd = bh.filePos.pos + BLOCK_SIZE_SIZE + bh.blockSize;
+    remapFile(file, blockEnd);
+    CHECK(file->size() >= blockEnd, "Block out of file " + file->getFileName());
+    const char *end_pos = file->data() + blockEnd;
+    const char *cur_pos = file->data() + bh.filePos.pos + txsOffsets.offsets[offsetIndex];
+    
+    //c Транзакции подписи блока идут подряд в его начале, поэтому признак определяется по номеру
+    size_t txIndex = offsetIndex * BlockTxsOffsets::STEP;
+    while (cur_pos < end_pos && (countTx == 0 || result.size() < countTx)) {
+        TransactionInfo txInfo;
+        txInfo.filePos.pos = std::distance(file->data(), cur_pos);
+        
+        const bool isReadTransaction = txIndex >= beginTx;
+        const auto &[isInitialized, newSize, newPos] = readSimpleTransactionInfo(cur_pos, end_pos, txInfo, isReadTransaction, false, PrevTransactionSignHelper(), nullptr, nullptr);
+        if (newSize == 0) {
+            break;
+        }
+        cur_pos = newPos;
+        if (isInitialized && isReadTransaction) {
+            txInfo.blockIndex = txIndex;
+            txInfo.isSignBlockTx = txIndex < bh.countSignTx;
+            result.emplace_back(std::move(txInfo));
+        }
+        
+        txIndex++;
+    }
+    return result;
+}
+
 static void readSignBlockTxs(const char *begin_pos, const char *end_pos, size_t posInFile, SignBlockInfo &bi) {
     const char *cur_pos = begin_pos;
     cur_pos += SIGN_BLOCK_HEADER_SIZE - BLOCK_SIZE_SIZE;
@@ -575,6 +802,18 @@ size_t readNextBlockDump(IfStream &ifile, size_t currPos, std::string &blockDump
     return currPos + pairRes.first + BLOCK_SIZE_SIZE;
 }
 
+size_t readNextBlockDump(std::shared_ptr<const MappedFile> &file, size_t currPos, std::string &blockDump) {
+    auto pairRes = getBlockDump(file, currPos, 0, std::numeric_limits<size_t>::max());
+    
+    if (pairRes.first == 0) {
+        return currPos;
+    }
+    
+    blockDump = std::move(pairRes.second);
+    
+    return currPos + pairRes.first + BLOCK_SIZE_SIZE;
+}
+
 std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> parseNextBlockInfo(const char *begin_pos, const char *end_pos, size_t posInFile, bool isValidate, bool isSaveAllTx, size_t beginTx, size_t countTx) {
     const uint64_t block_type = *((const uint64_t *)begin_pos);
     if (block_type == SIGN_BLOCK_TYPE) {
@@ -647,4 +886,29 @@ std::pair<size_t, std::string> getBlockDump(IfStream &ifile, size_t currPos, siz
     return std::make_pair(block_size, result);
 }
 
+std::pair<size_t, std::string> getBlockDump(std::shared_ptr<const MappedFile> &file, size_t currPos, size_t fromByte, size_t toByte) {
+    remapFile(file, currPos + BLOCK_SIZE_SIZE);
+    
+    if (currPos + BLOCK_SIZE_SIZE > file->size()) {
+        return {};
+    }
+    
+    const uint64_t block_size = *((const uint64_t *)(file->data() + currPos));
+    
+    remapFile(file, block_size + BLOCK_SIZE_SIZE + currPos);
+    if (file->size() < block_size + BLOCK_SIZE_SIZE + currPos) {
+        return std::make_pair(0, "");
+    }
+    
+    if (fromByte >= block_size) {
+        return std::make_pair(0, "");
+    }
+    if (toByte > block_size) {
+        toByte = block_size;
+    }
+    
+    const char *begin = file->data() + currPos + BLOCK_SIZE_SIZE;
+    return std::make_pair(block_size, std::string(begin + fromByte, begin + toByte));
+}
+
 }
@@ -5,8 +5,10 @@
 #include <vector>
 #include <fstream>
 #include <variant>
+#include <memory>
 
 #include "utils/IfStream.h"
+#include "utils/MappedFile.h"
 #include "blockchain_structs/TransactionInfo.h"
 #include "blockchain_structs/SignBlock.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
@@ -17,11 +19,20 @@ struct TransactionInfo;
 struct BlockInfo;
 struct SignBlockInfo;
 struct RejectedTxsBlockInfo;
+struct BlockHeader;
+struct BlockTxsOffsets;
 
 /**
- *c Возвращает размер файла до записи в него
+ *c Количество потоков общего пула для проверки подписей транзакций блока при isValidate и для хэширования транзакций блока.
+ *c Вызывать до начала синхронизации
  */
-size_t saveBlockToFileBinary(const std::string &fileName, const std::string &data);
+void setCountThreadsValidateSigns(size_t countThreads);
+
+/**
+ *c Размер кэша уже проверенных подписей (хэш транзакции, pubkey). 0 - кэш выключен.
+ *c Вызывать до начала синхронизации
+ */
+void setVerifiedSignsCacheSize(size_t maxSizeBytes);
 
 void openFile(IfStream &file, const std::string &fileName);
 
@@ -29,16 +40,28 @@ void flushFile(IfStream &file, const std::string &fileName);
 
 void closeFile(IfStream &file);
 
-bool readOneSimpleTransactionInfo(IfStream &ifile, size_t currPos, TransactionInfo &txInfo, bool isSaveAllTx);
+/**
+ *c Функции чтения из MappedFile при необходимости заменяют file на более свежее отображение
+ */
+bool readOneSimpleTransactionInfo(std::shared_ptr<const MappedFile> &file, size_t currPos, TransactionInfo &txInfo, bool isSaveAllTx);
 
 std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> parseNextBlockInfo(const char *begin_pos, const char *end_pos, size_t posInFile, bool isValidate, bool isSaveAllTx, size_t beginTx, size_t countTx);
 
+/**
+ *c Читает countTx транзакций простого блока начиная с beginTx по таблице смещений, не разбирая остальной блок
+ */
+std::vector<TransactionInfo> readSimpleBlockTxsPart(std::shared_ptr<const MappedFile> &file, const BlockHeader &bh, const BlockTxsOffsets &txsOffsets, size_t beginTx, size_t countTx);
+
 RejectedTxsBlockInfo parseRejectedTxsBlockInfo(const char *begin_pos, const char *end_pos, size_t posInFile, bool isValidate);
 
 size_t readNextBlockDump(IfStream &ifile, size_t currPos, std::string &blockDump);
 
 std::pair<size_t, std::string> getBlockDump(IfStream &ifile, size_t currPos, size_t fromByte, size_t toByte);
 
+size_t readNextBlockDump(std::shared_ptr<const MappedFile> &file, size_t currPos, std::string &blockDump);
+
+std::pair<size_t, std::string> getBlockDump(std::shared_ptr<const MappedFile> &file, size_t currPos, size_t fromByte, size_t toByte);
+
 }
 
 #endif // BLOCKCHAIN_READ_H_
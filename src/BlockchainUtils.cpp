@@ -25,6 +25,7 @@
 #include "check.h"
 #include "stringUtils.h"
 #include "convertStrings.h"
+#include "utils/ThreadPool.h"
 
 using namespace common;
 
@@ -32,6 +33,8 @@ namespace torrent_node_lib {
     
 static bool isInitialized = false;
 
+const static size_t MIN_HASHES_FOR_PARALLEL = 64;
+
 static const secp256k1_context* getCtx() {
     static thread_local std::unique_ptr<secp256k1_context, decltype(&secp256k1_context_destroy)> s_ctx{
         secp256k1_context_create(SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_SIGN),
@@ -92,6 +95,51 @@ std::array<unsigned char, 32> get_double_sha256(unsigned char * data, size_t siz
     return hash2;
 }
 
+std::vector<std::array<unsigned char, 32>> get_double_sha256_parallel(const std::vector<std::pair<const unsigned char*, size_t>> &buffers, ThreadPool &pool) {
+    CHECK(isInitialized, "Not initialized");
+    
+    std::vector<std::array<unsigned char, SHA256_DIGEST_LENGTH>> result(buffers.size());
+    //c Каждый буфер хэшируется отдельно. Openssl сам выбирает SHA-NI для одного буфера, многобуферного хэширования нет
+    const auto calcPart = [&buffers, &result](size_t begin, size_t end) {
+        std::array<unsigned char, SHA256_DIGEST_LENGTH> hash1;
+        for (size_t i = begin; i < end; i++) {
+            SHA256(buffers[i].first, buffers[i].second, hash1.data());
+            SHA256(hash1.data(), SHA256_DIGEST_LENGTH, result[i].data());
+        }
+    };
+    
+    const size_t countParts = std::min(pool.countThreads(), buffers.size() / MIN_HASHES_FOR_PARALLEL);
+    if (countParts <= 1) {
+        calcPart(0, buffers.size());
+        return result;
+    }
+    
+    size_t allSize = 0;
+    for (const auto &buffer: buffers) {
+        allSize += buffer.second;
+    }
+    const size_t partSize = (allSize + countParts - 1) / countParts;
+    std::vector<std::pair<size_t, size_t>> parts;
+    size_t beginPart = 0;
+    size_t currSize = 0;
+    for (size_t i = 0; i < buffers.size(); i++) {
+        currSize += buffers[i].second;
+        if (currSize >= partSize) {
+            parts.emplace_back(beginPart, i + 1);
+            beginPart = i + 1;
+            currSize = 0;
+        }
+    }
+    if (beginPart != buffers.size()) {
+        parts.emplace_back(beginPart, buffers.size());
+    }
+    
+    pool.parallelFor(parts.size(), [&calcPart, &parts](size_t index) {
+        calcPart(parts[index].first, parts[index].second);
+    });
+    return result;
+}
+
 
 bool IsValidECKey(EVP_PKEY* key) {
     CHECK(isInitialized, "Not initialized");
@@ -4,15 +4,23 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <utility>
 
 namespace torrent_node_lib {
 
+class ThreadPool;
+
 std::vector<unsigned char> hex2bin(const std::string & src);
 
 void ssl_init();
 
 std::array<unsigned char, 32> get_double_sha256(unsigned char * data, size_t size);
 
+/**
+ *c Double sha256 для многих независимых буферов: скалярный sha256 openssl, большие пачки делятся между потоками пула по объему данных
+ */
+std::vector<std::array<unsigned char, 32>> get_double_sha256_parallel(const std::vector<std::pair<const unsigned char*, size_t>> &buffers, ThreadPool &pool);
+
 std::string get_address(const std::string & pubk);
 
 std::string get_address(const std::vector<unsigned char> & bpubk);
@@ -0,0 +1,132 @@
+#include "BlocksSnapshot.h"
+
+#include <fstream>
+#include <iterator>
+#include <experimental/filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "check.h"
+#include "log.h"
+#include "utils/serialize.h"
+#include "utils/FileSystem.h"
+#include "BlockchainUtils.h"
+
+using namespace common;
+
+namespace fs = std::experimental::filesystem;
+
+namespace torrent_node_lib {
+
+const static std::string SNAPSHOT_VERSION = "blocks_snapshot_v1";
+
+const static size_t CHECKSUM_SIZE = 32;
+
+std::string BlocksSnapshot::serialize() const {
+    std::string res;
+    res += serializeString(SNAPSHOT_VERSION);
+    res += serializeInt<size_t>(blocks.size());
+    for (const std::string &block: blocks) {
+        res += serializeString(block);
+    }
+    res += serializeInt<size_t>(timeline.size());
+    for (const auto &[number, element]: timeline) {
+        res += serializeInt<size_t>(number);
+        res += serializeString(element);
+    }
+    
+    const std::array<unsigned char, 32> checksum = get_double_sha256((unsigned char*)res.data(), res.size());
+    res.append(checksum.begin(), checksum.end());
+    return res;
+}
+
+BlocksSnapshot BlocksSnapshot::deserialize(const std::string &raw) {
+    CHECK(raw.size() > CHECKSUM_SIZE, "Incorrect snapshot size");
+    const size_t dataSize = raw.size() - CHECKSUM_SIZE;
+    const std::array<unsigned char, 32> checksum = get_double_sha256((unsigned char*)raw.data(), dataSize);
+    CHECK(std::equal(checksum.begin(), checksum.end(), raw.begin() + dataSize), "Incorrect snapshot checksum");
+    
+    const std::string data = raw.substr(0, dataSize);
+    
+    BlocksSnapshot result;
+    size_t from = 0;
+    const std::string version = deserializeString(data, from);
+    CHECK(version == SNAPSHOT_VERSION, "Incorrect snapshot version " + version);
+    
+    const size_t countBlocks = deserializeInt<size_t>(data, from);
+    result.blocks.reserve(countBlocks);
+    for (size_t i = 0; i < countBlocks; i++) {
+        result.blocks.emplace_back(deserializeString(data, from));
+    }
+    
+    const size_t countTimeline = deserializeInt<size_t>(data, from);
+    result.timeline.reserve(countTimeline);
+    for (size_t i = 0; i < countTimeline; i++) {
+        const size_t number = deserializeInt<size_t>(data, from);
+        result.timeline.emplace_back(number, deserializeString(data, from));
+    }
+    CHECK(from == data.size(), "Incorrect snapshot data");
+    
+    return result;
+}
+
+static void writeFileSynced(const std::string &fileName, const std::string &data) {
+    const int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    CHECK(fd >= 0, "Not opened file " + fileName + ": " + strerror(errno));
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t res = ::write(fd, data.data() + written, data.size() - written);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            const std::string error = strerror(errno);
+            ::close(fd);
+            throwErr("Incorrect write snapshot " + fileName + ": " + error);
+        }
+        written += res;
+    }
+    const int res = ::fsync(fd);
+    ::close(fd);
+    CHECK(res == 0, "Not synced file " + fileName + ": " + strerror(errno));
+}
+
+static void syncFolder(const std::string &fileName) {
+    const std::string folder = fs::path(fileName).parent_path().string();
+    const int dirFd = ::open(folder.empty() ? "." : folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    CHECK(dirFd >= 0, "Not opened folder " + folder + ": " + strerror(errno));
+    const int res = ::fsync(dirFd);
+    ::close(dirFd);
+    CHECK(res == 0, "Not synced folder " + folder);
+}
+
+void saveBlocksSnapshot(const std::string &fileName, const BlocksSnapshot &snapshot) {
+    const std::string data = snapshot.serialize();
+    
+    //c Пишем во временный файл, чтобы при падении не оставить наполовину записанный снимок.
+    //c Файл сбрасываем на диск до переименования, каталог - после
+    const std::string tmpFileName = fileName + ".tmp";
+    writeFileSynced(tmpFileName, data);
+    
+    renameFile(tmpFileName, fileName);
+    syncFolder(fileName);
+}
+
+std::optional<BlocksSnapshot> loadBlocksSnapshot(const std::string &fileName) {
+    if (!isFileExist(fileName)) {
+        return std::nullopt;
+    }
+    
+    try {
+        std::ifstream file(fileName, std::ios::binary);
+        const std::string raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return BlocksSnapshot::deserialize(raw);
+    } catch (const exception &e) {
+        LOGWARN << "Incorrect snapshot " << fileName << ": " << e;
+        return std::nullopt;
+    }
+}
+
+} // namespace torrent_node_lib {
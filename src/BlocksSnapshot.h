@@ -0,0 +1,33 @@
+#ifndef BLOCKS_SNAPSHOT_H_
+#define BLOCKS_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace torrent_node_lib {
+
+/**
+ *c Снимок состояния BlockChain и BlocksTimeline для быстрого старта.
+ *c Блоки выше снимка догружаются из leveldb по timeline
+ */
+struct BlocksSnapshot {
+    std::vector<std::string> blocks;
+    
+    std::vector<std::pair<size_t, std::string>> timeline;
+    
+    std::string serialize() const;
+    
+    static BlocksSnapshot deserialize(const std::string &raw);
+};
+
+void saveBlocksSnapshot(const std::string &fileName, const BlocksSnapshot &snapshot);
+
+/**
+ *c Возвращает nullopt, если файла нет или он поврежден
+ */
+std::optional<BlocksSnapshot> loadBlocksSnapshot(const std::string &fileName);
+
+} // namespace torrent_node_lib {
+
+#endif // BLOCKS_SNAPSHOT_H_
@@ -30,7 +30,10 @@ std::vector<char> serializeElement(const BlocksTimeline::Element &element) {
     return result;
 }
 
-void BlocksTimeline::deserialize(const std::vector<std::pair<size_t, std::string>> &elements) {
+std::vector<BlocksTimeline::Hash> BlocksTimeline::deserialize(const std::vector<std::pair<size_t, std::string>> &elements) {
+    std::lock_guard<std::mutex> lock(mut);
+    
+    std::vector<Hash> simpleBlocks;
     for (const auto &[number, element]: elements) {
         CHECK(number == hashes.size(), "Incorrect sequence");
         
@@ -46,11 +49,33 @@ void BlocksTimeline::deserialize(const std::vector<std::pair<size_t, std::string
         if (std::holds_alternative<SignBlockElement>(el)) {
             const SignBlockElement &block = std::get<SignBlockElement>(el);
             signsParent.emplace(block.prevHash, iter);
+        } else {
+            simpleBlocks.emplace_back(std::get<SimpleBlockElement>(el).hash);
         }
     }
     
-    std::lock_guard<std::mutex> lock(mut);
     initialized = true;
+    return simpleBlocks;
+}
+
+std::vector<std::pair<size_t, std::string>> BlocksTimeline::serialize() const {
+    std::lock_guard<std::mutex> lock(mut);
+    
+    std::vector<std::pair<size_t, std::string>> result;
+    result.reserve(hashes.size());
+    for (const Element &element: timeline) {
+        const std::vector<char> serialized = serializeElement(element);
+        result.emplace_back(result.size(), std::string(serialized.begin(), serialized.end()));
+    }
+    return result;
+}
+
+void BlocksTimeline::clear() {
+    std::lock_guard<std::mutex> lock(mut);
+    timeline.clear();
+    hashes.clear();
+    signsParent.clear();
+    initialized = false;
 }
 
 size_t BlocksTimeline::size() const {
@@ -38,10 +38,17 @@ public:
     
 public:
     
-    void deserialize(const std::vector<std::pair<size_t, std::string>> &elements);
+    /**
+     *c Возвращает хэши добавленных простых блоков
+     */
+    std::vector<Hash> deserialize(const std::vector<std::pair<size_t, std::string>> &elements);
+    
+    std::vector<std::pair<size_t, std::string>> serialize() const;
     
     size_t size() const;
     
+    void clear();
+    
 public:
     
     std::pair<size_t, std::vector<char>> addSimpleBlock(const BlockHeader &bh);
@@ -1,43 +1,144 @@
 #include "Cache.h"
 #include "blockchain_structs/TransactionInfo.h"
 
+#include "utils/Metrics.h"
+
+#include "check.h"
+
 using namespace common;
 
 namespace torrent_node_lib {
 
+const static size_t ELEMENT_OVERHEAD = 64; //c Примерные накладные расходы на узел списка и запись в map
+
+static size_t sizeOfValue(const std::shared_ptr<std::string> &value) {
+    return sizeof(value) + (value != nullptr ? value->size() : 0);
+}
+
+static size_t sizeOfValue(const TransactionInfo &value) {
+    size_t size = sizeof(value) + value.hash.size() + value.sign.size() + value.pubKey.size() + value.data.size() + value.allRawTx.size();
+    if (value.scriptInfo.has_value()) {
+        size += value.scriptInfo->txRaw.size();
+    }
+    if (value.status.has_value()) {
+        size += value.status->transaction.size();
+    }
+    return size;
+}
+
+static size_t sizeOfValue(const TransactionStatus &value) {
+    return sizeof(value) + value.transaction.size();
+}
+
+static size_t sizeOfValue(const BalanceInfo &value) {
+    size_t size = sizeof(value);
+    for (const auto &[token, balance]: value.tokens) {
+        size += token.size() + sizeof(balance) + ELEMENT_OVERHEAD;
+    }
+    return size;
+}
+
+static size_t sizeOfValue(const bool &value) {
+    return sizeof(value);
+}
+
 template<typename Value>
-void Cache<Value>::addValue(const Key& key, const Attribute& attribute, const Value &value) {
-    std::lock_guard<std::shared_mutex> lock(mutex);
-    attributes[attribute].emplace_back(key);
-    map.insert({key, value}); // Not emplace
+Cache<Value>::Cache(size_t maxSizeBytes, const std::string &name, size_t countShards)
+    : maxSizeBytes(maxSizeBytes)
+    , maxSizeShard(maxSizeBytes / countShards)
+    , shards(countShards)
+{
+    CHECK(countShards != 0, "Incorrect count shards");
+    
+    MetricsRegistry &registry = getMetrics();
+    const std::string labels = metricLabel("cache", name);
+    hits = &registry.counter("torrent_cache_hits_total", "Count cache lookups that found the value", labels);
+    misses = &registry.counter("torrent_cache_misses_total", "Count cache lookups that did not find the value", labels);
+    evictions = &registry.counter("torrent_cache_evictions_total", "Count values evicted from cache to fit its size budget", labels);
+    registry.gauge("torrent_cache_elements", "Count values in cache", [this]{
+        return getStatistic().countElements;
+    }, labels);
+    registry.gauge("torrent_cache_size_bytes", "Approximate cache size in bytes", [this]{
+        return getStatistic().sizeBytes;
+    }, labels);
 }
 
 template<typename Value>
-std::optional<Value> Cache<Value>::getValue(const Key& key) const {
-    std::shared_lock<std::shared_mutex> lock(mutex);
-    const auto found = map.find(key);
-    if (found == map.end()) {
-        return std::nullopt;
-    } else {
-        return found->second;
+typename Cache<Value>::Shard& Cache<Value>::getShard(const Key &key) const {
+    const size_t hash = std::hash<Key>()(key);
+    return shards[(hash ^ (hash >> 32)) % shards.size()];
+}
+
+template<typename Value>
+void Cache<Value>::evict(Shard &shard) {
+    while (shard.sizeBytes > maxSizeShard && !shard.lru.empty()) {
+        const Element &last = shard.lru.back();
+        shard.sizeBytes -= last.size;
+        shard.map.erase(last.key);
+        shard.lru.pop_back();
+        evictions->inc();
     }
 }
 
 template<typename Value>
-void Cache<Value>::remove(const Attribute& attribute) {
-    std::lock_guard<std::shared_mutex> lock(mutex);
-    auto found = attributes.find(attribute);
-    if (found == attributes.end()) {
+void Cache<Value>::addValue(const Key& key, const Value &value) {
+    if (!isEnabled()) {
+        return;
+    }
+    const size_t size = sizeOfValue(value) + key.s.size() + ELEMENT_OVERHEAD;
+    if (size > maxSizeShard) {
         return;
     }
-    for (const Key &key: found->second) {
-        map.erase(key);
+
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mut);
+    const auto found = shard.map.find(key);
+    if (found != shard.map.end()) {
+        shard.sizeBytes -= found->second->size;
+        shard.lru.erase(found->second);
+        shard.map.erase(found);
+    }
+    shard.lru.push_front(Element{key, value, size});
+    shard.map.emplace(key, shard.lru.begin());
+    shard.sizeBytes += size;
+    evict(shard);
+}
+
+template<typename Value>
+std::optional<Value> Cache<Value>::getValue(const Key& key) const {
+    if (!isEnabled()) {
+        return std::nullopt;
+    }
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mut);
+    const auto found = shard.map.find(key);
+    if (found == shard.map.end()) {
+        misses->inc();
+        return std::nullopt;
+    }
+    hits->inc();
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    return found->second->value;
+}
+
+template<typename Value>
+typename Cache<Value>::Statistic Cache<Value>::getStatistic() const {
+    Statistic result;
+    for (const Shard &shard: shards) {
+        std::lock_guard<std::mutex> lock(shard.mut);
+        result.countElements += shard.map.size();
+        result.sizeBytes += shard.sizeBytes;
     }
-    attributes.erase(attribute);
+    result.hits = hits->get();
+    result.misses = misses->get();
+    result.evictions = evictions->get();
+    return result;
 }
 
 template class Cache<std::shared_ptr<std::string>>;
 template class Cache<TransactionInfo>;
 template class Cache<TransactionStatus>;
+template class Cache<BalanceInfo>;
+template class Cache<bool>;
 
 }
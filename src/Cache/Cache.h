@@ -6,7 +6,8 @@
 #include <vector>
 #include <string>
 #include <functional>
-#include <shared_mutex>
+#include <mutex>
+#include <atomic>
 #include <optional>
 #include <memory>
 
@@ -14,46 +15,95 @@
 
 #include "HashedString.h"
 #include "blockchain_structs/TransactionInfo.h"
+#include "blockchain_structs/BalanceInfo.h"
 
 namespace torrent_node_lib {
 
+class MetricCounter;
+
 template<typename Value>
 class Cache {
 public:
     
     using Key = common::HashedString;
     
-    using Attribute = std::string;
+    struct Statistic {
+        size_t countElements = 0;
+        size_t sizeBytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+    
+    const static size_t DEFAULT_COUNT_SHARDS = 16;
     
 public:
+    
+    /**
+     *c maxSizeBytes - общий бюджет кэша в байтах, делится поровну между шардами. 0 - кэш выключен.
+     *c name - значение метки cache у метрик кэша
+     */
+    Cache(size_t maxSizeBytes, const std::string &name, size_t countShards = DEFAULT_COUNT_SHARDS);
 
-    void addValue(const Key &key, const Attribute &attribute, const Value &value);
+    void addValue(const Key &key, const Value &value);
        
     std::optional<Value> getValue(const Key &key) const;
     
-    void remove(const Attribute &attribute);
+    bool isEnabled() const {
+        return maxSizeBytes != 0;
+    }
+    
+    Statistic getStatistic() const;
     
 private:
     
-    std::unordered_map<Key, Value> map;
-    std::unordered_map<Attribute, std::vector<Key>> attributes;
+    struct Element {
+        Key key;
+        Value value;
+        size_t size;
+    };
+    
+    struct Shard {
+        std::list<Element> lru;
+        std::unordered_map<Key, typename std::list<Element>::iterator> map;
+        size_t sizeBytes = 0;
+        
+        mutable std::mutex mut;
+    };
+    
+    Shard& getShard(const Key &key) const;
+    
+    void evict(Shard &shard);
+    
+private:
+    
+    const size_t maxSizeBytes;
+    const size_t maxSizeShard;
+    
+    mutable std::vector<Shard> shards;
     
-    mutable std::shared_mutex mutex;
+    MetricCounter *hits;
+    MetricCounter *misses;
+    MetricCounter *evictions;
 };
 
 struct AllCaches {   
-    size_t maxCountElementsBlockCache;
-    size_t maxCountElementsTxsCache;
     size_t macLocalCacheElements;
     
     Cache<std::shared_ptr<std::string>> blockDumpCache;
     Cache<TransactionInfo> txsCache;
     Cache<TransactionStatus> txsStatusCache;
+    /**
+     *c Балансы, записанные последними блоками. Заполняется только WorkerMain после addBatch
+     */
+    Cache<BalanceInfo> balancesCache;
     
-    AllCaches(size_t maxCountElementsBlockCache, size_t maxCountElementsTxsCache, size_t macLocalCacheElements)
-        : maxCountElementsBlockCache(maxCountElementsBlockCache)
-        , maxCountElementsTxsCache(maxCountElementsTxsCache)
-        , macLocalCacheElements(macLocalCacheElements)
+    AllCaches(size_t maxSizeBlockCache, size_t maxSizeTxsCache, size_t maxSizeTxsStatusCache, size_t maxSizeBalancesCache, size_t macLocalCacheElements)
+        : macLocalCacheElements(macLocalCacheElements)
+        , blockDumpCache(maxSizeBlockCache, "blocks")
+        , txsCache(maxSizeTxsCache, "txs")
+        , txsStatusCache(maxSizeTxsStatusCache, "txs_status")
+        , balancesCache(maxSizeBalancesCache, "balances")
     {}
 };
 
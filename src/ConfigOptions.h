@@ -3,6 +3,9 @@
 
 #include <string>
 
+#include "duration.h"
+
+#include "utils/FileAppender.h"
 
 namespace torrent_node_lib {
 
@@ -30,19 +33,53 @@ struct LevelDbOptions {
 };
 
 struct CachesOptions {
-    const size_t maxCountElementsBlockCache;
-    const size_t maxCountElementsTxsCache;
+    const size_t blockCacheMb;
+    const size_t txsCacheMb;
+    const size_t txsStatusCacheMb;
+    const size_t balancesCacheMb;
     const size_t macLocalCacheElements;
     
-    CachesOptions(size_t maxCountElementsBlockCache, size_t maxCountElementsTxsCache, size_t macLocalCacheElements)
-        : maxCountElementsBlockCache(maxCountElementsBlockCache)
-        , maxCountElementsTxsCache(maxCountElementsTxsCache)
+    CachesOptions(size_t blockCacheMb, size_t txsCacheMb, size_t txsStatusCacheMb, size_t balancesCacheMb, size_t macLocalCacheElements)
+        : blockCacheMb(blockCacheMb)
+        , txsCacheMb(txsCacheMb)
+        , txsStatusCacheMb(txsStatusCacheMb)
+        , balancesCacheMb(balancesCacheMb)
         , macLocalCacheElements(macLocalCacheElements)
     {}
 };
 
+/**
+ *c Нарезка ranged запросов блока на сегменты и дублирование (hedge) зависших запросов на другие сервера
+ */
+struct P2PSegmentOptions {
+    size_t minSegmentSize = 10000;
+    size_t maxSegmentSize = 4 * 1024 * 1024;
+    //c На каждый коннект приходится примерно столько сегментов, чтобы быстрые сервера успевали забрать больше
+    size_t segmentsPerConnection = 2;
+    //c Размер сегмента не меньше произведения скорости сервера на его задержку, умноженного на этот коэффициент
+    double bdpMultiplier = 1.;
+    //c Запрос дублируется на другой сервер, если идет дольше ожидаемого времени, умноженного на hedgePercentile перцентиль
+    //c отношений фактических времен ответов к ожидаемым (или на hedgeTimeFactor, пока статистики мало), но не раньше hedgeMinDelay
+    milliseconds hedgeMinDelay = 200ms;
+    double hedgeTimeFactor = 2.;
+    double hedgePercentile = 0.95;
+    
+    P2PSegmentOptions() = default;
+    
+    P2PSegmentOptions(size_t minSegmentSize, size_t maxSegmentSize, size_t segmentsPerConnection, double bdpMultiplier, const milliseconds &hedgeMinDelay, double hedgeTimeFactor, double hedgePercentile)
+        : minSegmentSize(minSegmentSize)
+        , maxSegmentSize(maxSegmentSize)
+        , segmentsPerConnection(segmentsPerConnection)
+        , bdpMultiplier(bdpMultiplier)
+        , hedgeMinDelay(hedgeMinDelay)
+        , hedgeTimeFactor(hedgeTimeFactor)
+        , hedgePercentile(hedgePercentile)
+    {}
+};
+
 struct GetterBlockOptions {
-    const size_t maxAdvancedLoadBlocks;
+    const size_t initAdvancedLoadBlocks;
+    const size_t advancedLoadMb;
     const size_t countBlocksInBatch;
     P2P* const p2p;
     P2P* const p2p2;
@@ -52,9 +89,11 @@ struct GetterBlockOptions {
     const bool isValidateSign;
     const bool isCompress;
     const bool isPreLoad;
+    const P2PSegmentOptions segmentOptions;
     
-    GetterBlockOptions(size_t maxAdvancedLoadBlocks, size_t countBlocksInBatch, P2P* p2p, P2P* p2p2, P2P* p2pAll, bool getBlocksFromFile, bool isValidate, bool isValidateSign, bool isCompress, bool isPreLoad)
-        : maxAdvancedLoadBlocks(maxAdvancedLoadBlocks)
+    GetterBlockOptions(size_t initAdvancedLoadBlocks, size_t advancedLoadMb, size_t countBlocksInBatch, P2P* p2p, P2P* p2p2, P2P* p2pAll, bool getBlocksFromFile, bool isValidate, bool isValidateSign, bool isCompress, bool isPreLoad, const P2PSegmentOptions &segmentOptions)
+        : initAdvancedLoadBlocks(initAdvancedLoadBlocks)
+        , advancedLoadMb(advancedLoadMb)
         , countBlocksInBatch(countBlocksInBatch)
         , p2p(p2p)
         , p2p2(p2p2)
@@ -64,6 +103,19 @@ struct GetterBlockOptions {
         , isValidateSign(isValidateSign)
         , isCompress(isCompress)
         , isPreLoad(isPreLoad)
+        , segmentOptions(segmentOptions)
+    {}
+};
+
+struct BlockFilesOptions {
+    FileSyncPolicy syncPolicy;
+    size_t preallocateMb = 64;
+    
+    BlockFilesOptions() = default;
+    
+    BlockFilesOptions(const FileSyncPolicy &syncPolicy, size_t preallocateMb)
+        : syncPolicy(syncPolicy)
+        , preallocateMb(preallocateMb)
     {}
 };
 
@@ -2,11 +2,15 @@
 
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <algorithm>
+#include <map>
 
 #include <leveldb/filter_policy.h>
 #include <leveldb/cache.h>
 
 #include "check.h"
+#include "parallel_for.h"
 
 #include "blockchain_structs/BlockInfo.h"
 
@@ -15,6 +19,7 @@
 #include "utils/serialize.h"
 #include "log.h"
 #include "blockchain_structs/AddressInfo.h"
+#include "blockchain_structs/FilePosition.h"
 #include "blockchain_structs/Token.h"
 #include "blockchain_structs/TransactionInfo.h"
 #include "blockchain_structs/BalanceInfo.h"
@@ -76,6 +81,7 @@ const static std::string V8_CODE_PREFIX = "vc_";
 const static std::string TRANSACTION_STATUS_PREFIX = "T_";
 const static char ADDRESS_POSTFIX = '!';
 const static std::string BLOCK_PREFIX = "b_";
+const static std::string BLOCK_TXS_OFFSETS_PREFIX = "bo_";
 const static std::string SCRIPT_BLOCK_NUMBER_PREFIX = "ss_";
 const static std::string MAIN_BLOCK_NUMBER_PREFIX = "ms_";
 const static std::string NODE_STAT_BLOCK_NUMBER_PREFIX = "ns_";
@@ -104,6 +110,12 @@ const static std::string SIGNS_BLOCK_NUMBER_PREFIX = "signs_";
 
 const static std::string BLOCKS_TIMELINE_PREFIX = "timeline_";
 
+const static std::string FILE_NAME_ID_PREFIX = "fi_";
+const static std::string FILE_IDS_MIGRATION_KEY = "?file_ids_migration";
+const static std::string FILE_IDS_MIGRATION_FINISHED = "finished";
+const static std::string ADDRESS_FLAGS_MIGRATION_KEY = "?address_flags_migration";
+const static std::string ADDRESS_FLAGS_MIGRATION_FINISHED = "finished";
+
 thread_local std::vector<char> Batch::bufferKey;
 
 thread_local std::vector<char> Batch::bufferValue;
@@ -200,6 +212,48 @@ Value LevelDb::findOneValueWithoutCheckValue(const Key &key) const {
     return Value::deserialize(findOneValueInternal(key, false));
 }
 
+std::vector<std::string> LevelDb::findValuesSorted(const std::vector<std::vector<char>> &keys, size_t countThreads) const {
+    std::vector<std::string> result(keys.size());
+    if (keys.empty()) {
+        return result;
+    }
+    
+    std::vector<size_t> indexes(keys.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::sort(indexes.begin(), indexes.end(), [&keys](size_t first, size_t second) {
+        return leveldb::Slice(keys[first].data(), keys[first].size()).compare(leveldb::Slice(keys[second].data(), keys[second].size())) < 0;
+    });
+    
+    //c Все части читаются из одного снимка базы, каждая своим итератором по возрастанию ключей
+    const std::shared_ptr<const leveldb::Snapshot> snapshot(db->GetSnapshot(), [this](const leveldb::Snapshot *s) {
+        db->ReleaseSnapshot(s);
+    });
+    
+    const size_t countParts = std::max(std::min(countThreads, keys.size()), size_t(1));
+    const size_t partSize = (keys.size() + countParts - 1) / countParts;
+    std::vector<std::pair<size_t, size_t>> parts;
+    for (size_t begin = 0; begin < keys.size(); begin += partSize) {
+        parts.emplace_back(begin, std::min(begin + partSize, keys.size()));
+    }
+    
+    parallelFor(countParts, parts.begin(), parts.end(), [this, &keys, &indexes, &result, &snapshot](const std::pair<size_t, size_t> &part) {
+        leveldb::ReadOptions readOptions;
+        readOptions.snapshot = snapshot.get();
+        std::unique_ptr<leveldb::Iterator> it(db->NewIterator(readOptions));
+        for (size_t i = part.first; i < part.second; i++) {
+            const std::vector<char> &key = keys[indexes[i]];
+            const leveldb::Slice keySlice(key.data(), key.size());
+            it->Seek(keySlice);
+            if (it->Valid() && it->key() == keySlice) {
+                result[indexes[i]] = it->value().ToString();
+            }
+        }
+        CHECK(it->status().ok(), "Error while read values " + it->status().ToString());
+    });
+    
+    return result;
+}
+
 template<class Key>
 std::string LevelDb::findOneValueInternal(const Key& key, bool isCheck) const {
     std::string value;
@@ -244,6 +298,7 @@ template<class Key, class Value>
 void Batch::addKeyInternal(const Key &key, const Value& value, bool isSave) {
     std::lock_guard<std::mutex> lock(mut);
     batch.Put(leveldb::Slice(key.data(), key.size()), leveldb::Slice(value.data(), value.size()));
+    countOps++;
     if (isSave) {
         save.emplace(std::vector<char>(key.begin(), key.end()), std::vector<char>(value.begin(), value.end()));
     }
@@ -275,6 +330,7 @@ std::optional<Value> Batch::findValueInBatch(const std::vector<char> &key) const
 void Batch::removeValue(const std::vector<char> &key, bool isSave) {
     std::lock_guard<std::mutex> lock(mut);
     batch.Delete(leveldb::Slice(key.data(), key.size()));
+    countOps++;
     if (isSave) {
         save.erase(key);
         deleted.insert(key);
@@ -321,11 +377,89 @@ void addBatch(Batch& batch, LevelDb& leveldb) {
     leveldb.addBatch(batch.batch);
 }
 
+struct BatchOpsCollector final: public leveldb::WriteBatch::Handler {
+    
+    struct Op {
+        bool isPut;
+        std::string key;
+        std::string value;
+    };
+    
+    std::vector<Op> ops;
+    
+    void Put(const leveldb::Slice &key, const leveldb::Slice &value) override {
+        ops.push_back(Op{true, key.ToString(), value.ToString()});
+    }
+    
+    void Delete(const leveldb::Slice &key) override {
+        ops.push_back(Op{false, key.ToString(), ""});
+    }
+    
+};
+
+static void replacePartCounter(std::string &key, std::unordered_map<size_t, size_t> &counters, const std::function<size_t()> &getCounter) {
+    const size_t sizeCounter = sizeof(size_t);
+    if (key.size() < sizeCounter + 1 || key[key.size() - sizeCounter - 1] != ADDRESS_POSTFIX) {
+        return;
+    }
+    if (!common::beginWith(key, ADDRESS_PREFIX) && !common::beginWith(key, ADDRESS_TOKEN_PREFIX) && !common::beginWith(key, DELEGATE_PREFIX)) {
+        return;
+    }
+    size_t fromPos = key.size() - sizeCounter;
+    const size_t partCounter = deserializeInt<size_t>(key, fromPos);
+    if (partCounter >= BATCH_PART_COUNTER_LIMIT) {
+        return;
+    }
+    const auto [found, isInserted] = counters.try_emplace(partCounter, 0);
+    if (isInserted) {
+        found->second = getCounter();
+    }
+    const std::string counter = serializeInt<size_t>(found->second);
+    key.replace(key.size() - sizeCounter, sizeCounter, counter);
+}
+
+void mergeBatches(Batch &batch, std::vector<Batch> &parts, const std::vector<std::pair<size_t, size_t>> &order, const std::function<size_t()> &getCounter) {
+    std::vector<BatchOpsCollector> collectors(parts.size());
+    for (size_t i = 0; i < parts.size(); i++) {
+        const leveldb::Status s = parts[i].batch.Iterate(&collectors[i]);
+        CHECK(s.ok(), "Error while iterate batch " + s.ToString());
+    }
+    
+    std::unordered_map<size_t, size_t> counters;
+    std::vector<size_t> positions(parts.size(), 0);
+    std::lock_guard<std::mutex> lock(batch.mut);
+    for (const auto &[partIndex, countOps]: order) {
+        CHECK(partIndex < parts.size(), "Incorrect part index");
+        std::vector<BatchOpsCollector::Op> &ops = collectors[partIndex].ops;
+        size_t &position = positions[partIndex];
+        CHECK(position + countOps <= ops.size(), "Incorrect count ops in part");
+        for (size_t i = position; i < position + countOps; i++) {
+            BatchOpsCollector::Op &op = ops[i];
+            replacePartCounter(op.key, counters, getCounter);
+            if (op.isPut) {
+                batch.batch.Put(op.key, op.value);
+            } else {
+                batch.batch.Delete(op.key);
+            }
+            batch.countOps++;
+        }
+        position += countOps;
+    }
+    for (size_t i = 0; i < parts.size(); i++) {
+        CHECK(positions[i] == collectors[i].ops.size(), "Not all ops of part merged");
+    }
+}
+
 void Batch::addBlockHeader(const std::vector<unsigned char>& blockHash, const BlockHeader& value) {
     makeKey(bufferKey, BLOCK_PREFIX, blockHash);
     addKey(bufferKey, value);
 }
 
+void Batch::addBlockTxsOffsets(const std::vector<unsigned char> &blockHash, const BlockTxsOffsets &value) {
+    makeKey(bufferKey, BLOCK_TXS_OFFSETS_PREFIX, blockHash);
+    addKey(bufferKey, value);
+}
+
 void Batch::addSignBlockHeader(const std::vector<unsigned char> &blockHash, const SignBlockHeader &value) {
     makeKey(bufferKey, SIGNS_BLOCK_NUMBER_PREFIX, blockHash);
     addKey(bufferKey, value);
@@ -362,6 +496,10 @@ void Batch::addAddressToken(const std::string& address, const AddressInfo& value
     addKey(bufferKey, value);
 }
 
+void Batch::replaceAddressRecord(const std::string &key, const AddressInfo &value) {
+    addKey(key, value);
+}
+
 void Batch::addAddressStatus(const std::string& addressAndHash, const TransactionStatus& value) {
     addKey(addressAndHash, value);
 }
@@ -425,6 +563,11 @@ void Batch::removeDelegateKey(const std::vector<char> &delegateKey) {
     removeValue(delegateKey);
 }
 
+size_t Batch::getCountOps() const {
+    std::lock_guard<std::mutex> lock(mut);
+    return countOps;
+}
+
 std::unordered_set<std::string> Batch::getDeletedDelegate() const {
     std::lock_guard<std::mutex> lock(mut);
     std::unordered_set<std::string> result;
@@ -504,6 +647,76 @@ std::vector<AddressInfo> LevelDb::findAddressTokens(const std::string &address,
     return findKeyValue<AddressInfo>(keyBegin, keyEnd, from, count);
 }
 
+std::vector<std::pair<size_t, AddressInfo>> LevelDb::findAddressFromCursor(const std::string &address, const std::optional<size_t> &afterCounter, size_t count) const {
+    CHECK(count != 0, "Incorrect count");
+    std::vector<char> keyPrefix;
+    makeKey(keyPrefix, ADDRESS_PREFIX, address);
+    std::vector<char> keyBegin = keyPrefix;
+    keyBegin.emplace_back(ADDRESS_POSTFIX);
+    if (afterCounter.has_value()) {
+        if (afterCounter.value() == std::numeric_limits<size_t>::max()) {
+            return {};
+        }
+        // Ключи упорядочены по счетчику, поэтому продолжаем сразу со следующего за последним прочитанным
+        SerializerInt<size_t>(afterCounter.value() + 1).serialize(keyBegin);
+    }
+    std::vector<char> keyEnd = keyPrefix;
+    keyEnd.emplace_back(ADDRESS_POSTFIX + 1);
+    return findKeyInternal<std::pair<size_t, AddressInfo>>(keyBegin, keyEnd, 0, count, [](const leveldb::Iterator* iter) {
+        const leveldb::Slice key = iter->key();
+        CHECK(key.size() >= sizeof(size_t), "Incorrect address key");
+        const size_t counter = SerializerInt<size_t>::deserialize(std::string(key.data() + key.size() - sizeof(size_t), sizeof(size_t)));
+        return std::make_pair(counter, AddressInfo::deserialize(iter->value().ToString()));
+    });
+}
+
+std::vector<AddressInfo> LevelDb::findAddressFiltered(const std::string &address, bool isTokens, size_t &from, size_t count, const std::function<bool(const AddressInfo &info)> &filter) const {
+    CHECK(count != 0, "Incorrect count");
+    std::vector<char> keyPrefix;
+    makeKey(keyPrefix, isTokens ? ADDRESS_TOKEN_PREFIX : ADDRESS_PREFIX, address);
+    std::vector<char> keyBegin = keyPrefix;
+    keyBegin.emplace_back(ADDRESS_POSTFIX);
+    std::vector<char> keyEnd = keyPrefix;
+    keyEnd.emplace_back(ADDRESS_POSTFIX + 1);
+    const leveldb::Slice keyEndSlice(keyEnd.data(), keyEnd.size());
+    
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    std::vector<AddressInfo> result;
+    size_t index = 0;
+    for (it->Seek(leveldb::Slice(keyBegin.data(), keyBegin.size())); it->Valid() && it->key().compare(keyEndSlice) < 0 && result.size() < count; it->Next()) {
+        if (index >= from) {
+            AddressInfo info = AddressInfo::deserialize(it->value().ToString());
+            if (filter(info)) {
+                result.emplace_back(std::move(info));
+            }
+        }
+        index++;
+    }
+    from = std::max(from, index);
+    return result;
+}
+
+std::vector<std::pair<std::string, AddressInfo>> LevelDb::findAllAddressesPart(bool isTokens, const std::string &afterKey, size_t count) const {
+    const std::string &prefix = isTokens ? ADDRESS_TOKEN_PREFIX : ADDRESS_PREFIX;
+    std::string keyEnd = prefix;
+    keyEnd.back()++;
+    
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    if (afterKey.empty()) {
+        it->Seek(prefix);
+    } else {
+        it->Seek(afterKey);
+        if (it->Valid() && it->key() == afterKey) {
+            it->Next();
+        }
+    }
+    std::vector<std::pair<std::string, AddressInfo>> result;
+    for (; it->Valid() && it->key().compare(keyEnd) < 0 && result.size() < count; it->Next()) {
+        result.emplace_back(it->key().ToString(), AddressInfo::deserialize(it->value().ToString()));
+    }
+    return result;
+}
+
 std::vector<TransactionStatus> LevelDb::findAddressStatus(const std::string& address) const { // TODO придумать, как не читать все записи
     std::vector<char> keyPrefix;
     makeKey(keyPrefix, ADDRESS_STATUS_PREFIX, address);
@@ -524,6 +737,53 @@ std::optional<TransactionInfo> LevelDb::findTx(const std::string& txHash) const
     return findOneValueWithoutCheckOpt<TransactionInfo>(bufferKey);
 }
 
+std::vector<BalanceInfo> LevelDb::findBalances(const std::vector<std::string> &addresses, size_t countThreads) const {
+    std::vector<std::vector<char>> keys(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        makeKey(keys[i], BALANCE_PREFIX, addresses[i]);
+    }
+    const std::vector<std::string> values = findValuesSorted(keys, countThreads);
+    
+    std::vector<BalanceInfo> result;
+    result.reserve(values.size());
+    std::transform(values.begin(), values.end(), std::back_inserter(result), [](const std::string &value) {
+        return BalanceInfo::deserialize(value);
+    });
+    return result;
+}
+
+std::vector<std::optional<TransactionInfo>> LevelDb::findTxs(const std::vector<std::string> &txHashes, size_t countThreads) const {
+    std::vector<std::vector<char>> keys(txHashes.size());
+    for (size_t i = 0; i < txHashes.size(); i++) {
+        makeKey(keys[i], TRANSACTION_PREFIX, txHashes[i]);
+    }
+    const std::vector<std::string> values = findValuesSorted(keys, countThreads);
+    
+    std::vector<std::optional<TransactionInfo>> result(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        if (!values[i].empty()) {
+            result[i] = TransactionInfo::deserialize(values[i]);
+        }
+    }
+    return result;
+}
+
+std::vector<std::optional<TransactionStatus>> LevelDb::findTxsStatuses(const std::vector<std::string> &txHashes, size_t countThreads) const {
+    std::vector<std::vector<char>> keys(txHashes.size());
+    for (size_t i = 0; i < txHashes.size(); i++) {
+        makeKey(keys[i], TRANSACTION_STATUS_PREFIX, txHashes[i]);
+    }
+    const std::vector<std::string> values = findValuesSorted(keys, countThreads);
+    
+    std::vector<std::optional<TransactionStatus>> result(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        if (!values[i].empty()) {
+            result[i] = TransactionStatus::deserialize(values[i]);
+        }
+    }
+    return result;
+}
+
 Token LevelDb::findToken(const std::string &address) const {
     makeKey(bufferKey, TOKEN_PREFIX, address);
     return findOneValueWithoutCheckValue<Token>(bufferKey);
@@ -569,6 +829,16 @@ std::set<std::string> LevelDb::getAllBlocks() const {
     return std::set<std::string>(res.begin(), res.end());
 }
 
+std::optional<BlockHeader> LevelDb::findBlockHeader(const std::vector<unsigned char> &blockHash) const {
+    makeKey(bufferKey, BLOCK_PREFIX, blockHash);
+    return findOneValueWithoutCheckOpt<BlockHeader>(bufferKey);
+}
+
+std::optional<BlockTxsOffsets> LevelDb::findBlockTxsOffsets(const std::vector<unsigned char> &blockHash) const {
+    makeKey(bufferKey, BLOCK_TXS_OFFSETS_PREFIX, blockHash);
+    return findOneValueWithoutCheckOpt<BlockTxsOffsets>(bufferKey);
+}
+
 void LevelDb::saveTransactionStatus(const std::string& txHash, const TransactionStatus& value) {
     makeKey(bufferKey, TRANSACTION_STATUS_PREFIX, txHash);
     
@@ -583,6 +853,14 @@ std::string makeAddressStatusKey(const std::string &address, const std::string &
     return key;
 }
 
+std::string getAddressFromAddressKey(const std::string &key, bool isTokens) {
+    const std::string &prefix = isTokens ? ADDRESS_TOKEN_PREFIX : ADDRESS_PREFIX;
+    //c prefix + address + ADDRESS_POSTFIX + counter
+    CHECK(key.size() > prefix.size() + 1 + sizeof(size_t) && key.compare(0, prefix.size(), prefix) == 0, "Incorrect address key");
+    CHECK(key[key.size() - sizeof(size_t) - 1] == ADDRESS_POSTFIX, "Incorrect address key");
+    return key.substr(prefix.size(), key.size() - prefix.size() - sizeof(size_t) - 1);
+}
+
 void LevelDb::saveAddressStatus(const std::string& addressAndHash, const TransactionStatus& value) {
     std::vector<char> buffer;
     value.serialize(buffer);
@@ -594,9 +872,16 @@ void LevelDb::saveVersionDb(const std::string &value) {
 }
 
 std::vector<std::pair<size_t, std::string>> LevelDb::findAllBlocksTimeline() {
-    const std::string &from = BLOCKS_TIMELINE_PREFIX;
-    std::string to = from.substr(0, from.size() - 1);
-    to += (char)(from.back() + 1);
+    return findBlocksTimelineFrom(0);
+}
+
+std::vector<std::pair<size_t, std::string>> LevelDb::findBlocksTimelineFrom(size_t fromKey) const {
+    std::vector<char> keyFrom;
+    makeKey(keyFrom, BLOCKS_TIMELINE_PREFIX, SerializerInt(fromKey));
+    const std::string from(keyFrom.begin(), keyFrom.end());
+    const std::string &prefix = BLOCKS_TIMELINE_PREFIX;
+    std::string to = prefix.substr(0, prefix.size() - 1);
+    to += (char)(prefix.back() + 1);
     
     std::vector<std::pair<size_t, std::string>> result;
     
@@ -660,6 +945,130 @@ std::string LevelDb::findVersionDb() const {
     return findOneValueWithoutCheck(VERSION_DB);
 }
 
+void Batch::addFileName(size_t id, const std::string &fileName) {
+    makeKey(bufferKey, FILE_NAME_ID_PREFIX, SerializerInt(id));
+    addKeyInternal(bufferKey, fileName, false);
+}
+
+void Batch::addAddressFlagsMigration(bool isTokens, const std::string &lastKey) {
+    //c Пока ключей нет, сохраняется сам префикс, чтобы отличить начатую миграцию от ненужной
+    const std::string &prefix = isTokens ? ADDRESS_TOKEN_PREFIX : ADDRESS_PREFIX;
+    addKeyInternal(ADDRESS_FLAGS_MIGRATION_KEY, lastKey.empty() ? prefix : lastKey, false);
+}
+
+void Batch::addAddressFlagsMigrationFinished() {
+    addKeyInternal(ADDRESS_FLAGS_MIGRATION_KEY, ADDRESS_FLAGS_MIGRATION_FINISHED, false);
+}
+
+std::vector<std::pair<size_t, std::string>> LevelDb::findAllFileNames() const {
+    std::string keyEnd = FILE_NAME_ID_PREFIX;
+    keyEnd.back()++;
+    const std::vector<std::pair<std::string, std::string>> found = findKey2(FILE_NAME_ID_PREFIX, keyEnd);
+    std::vector<std::pair<size_t, std::string>> result;
+    result.reserve(found.size());
+    for (const auto &[key, fileName]: found) {
+        CHECK(key.size() == FILE_NAME_ID_PREFIX.size() + sizeof(size_t), "Incorrect file name key");
+        result.emplace_back(SerializerInt<size_t>::deserialize(key.substr(FILE_NAME_ID_PREFIX.size())), fileName);
+    }
+    return result;
+}
+
+using NewFileNames = std::map<size_t, std::string>;
+
+template<class Value>
+static std::string recodeValue(const std::string &raw, FileNamesDictionary &fileNames, NewFileNames &newFileNames) {
+    Value value = Value::deserialize(raw);
+    if (!value.filePos.fileId.has_value()) {
+        const auto [id, isNotSaved] = fileNames.getOrAddId(value.filePos.fileNameRelative);
+        if (isNotSaved) {
+            newFileNames.emplace(id, value.filePos.fileNameRelative);
+        }
+        value.filePos.fileId = id;
+    }
+    std::vector<char> buffer;
+    value.serialize(buffer);
+    return std::string(buffer.begin(), buffer.end());
+}
+
+bool LevelDb::migrateFilePositionsPart(size_t count, FileNamesDictionary &fileNames) {
+    CHECK(fileNames.isInitialized(), "File names dictionary not initialized");
+    
+    //c Префиксы в порядке возрастания ключей
+    const static std::vector<std::pair<std::string, std::string(*)(const std::string&, FileNamesDictionary&, NewFileNames&)>> RECODERS = {
+        {ADDRESS_PREFIX, recodeValue<AddressInfo>},
+        {TRANSACTION_PREFIX, recodeValue<TransactionInfo>},
+        {ADDRESS_TOKEN_PREFIX, recodeValue<AddressInfo>},
+    };
+    
+    std::string lastKey = findOneValueWithoutCheck(FILE_IDS_MIGRATION_KEY);
+    if (lastKey == FILE_IDS_MIGRATION_FINISHED) {
+        return false;
+    }
+    
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    leveldb::WriteBatch batch;
+    NewFileNames newFileNames;
+    size_t countScanned = 0;
+    for (const auto &[prefix, recode]: RECODERS) {
+        std::string keyEnd = prefix;
+        keyEnd.back()++;
+        if (!lastKey.empty() && leveldb::Slice(lastKey).compare(keyEnd) >= 0) {
+            continue;
+        }
+        if (lastKey.empty() || leveldb::Slice(lastKey).compare(prefix) < 0) {
+            it->Seek(prefix);
+        } else {
+            it->Seek(lastKey);
+            if (it->Valid() && it->key() == leveldb::Slice(lastKey)) {
+                it->Next();
+            }
+        }
+        for (; it->Valid() && it->key().compare(keyEnd) < 0 && countScanned < count; it->Next()) {
+            const std::string raw = it->value().ToString();
+            const std::string recoded = recode(raw, fileNames, newFileNames);
+            if (recoded != raw) {
+                batch.Put(it->key(), recoded);
+            }
+            lastKey = it->key().ToString();
+            countScanned++;
+        }
+        if (countScanned >= count) {
+            break;
+        }
+    }
+    
+    const bool isFinished = countScanned < count;
+    for (const auto &[id, fileName]: newFileNames) {
+        std::vector<char> key;
+        makeKey(key, FILE_NAME_ID_PREFIX, SerializerInt(id));
+        batch.Put(leveldb::Slice(key.data(), key.size()), fileName);
+    }
+    batch.Put(FILE_IDS_MIGRATION_KEY, isFinished ? FILE_IDS_MIGRATION_FINISHED : lastKey);
+    addBatch(batch);
+    for (const auto &[id, fileName]: newFileNames) {
+        fileNames.confirmSaved(id);
+    }
+    if (isFinished) {
+        LOGINFO << "File ids migration finished";
+    }
+    return !isFinished;
+}
+
+void LevelDb::startAddressFlagsMigration() {
+    saveValue(ADDRESS_FLAGS_MIGRATION_KEY, ADDRESS_PREFIX, true);
+}
+
+std::optional<std::pair<bool, std::string>> LevelDb::findAddressFlagsMigration() const {
+    const std::string value = findOneValueWithoutCheck(ADDRESS_FLAGS_MIGRATION_KEY);
+    if (value.empty() || value == ADDRESS_FLAGS_MIGRATION_FINISHED) {
+        return std::nullopt;
+    }
+    const bool isTokens = value.compare(0, ADDRESS_TOKEN_PREFIX.size(), ADDRESS_TOKEN_PREFIX) == 0;
+    const std::string &prefix = isTokens ? ADDRESS_TOKEN_PREFIX : ADDRESS_PREFIX;
+    CHECK(value.compare(0, prefix.size(), prefix) == 0, "Incorrect address flags migration state");
+    return std::make_pair(isTokens, value == prefix ? "" : value);
+}
+
 NodeStatBlockInfo LevelDb::findNodeStatBlock() const {
     return findOneValueWithoutCheckValue<NodeStatBlockInfo>(NODE_STAT_BLOCK_NUMBER_PREFIX);
 }
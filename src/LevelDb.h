@@ -8,6 +8,8 @@
 #include <deque>
 #include <mutex>
 #include <vector>
+#include <functional>
+#include <optional>
 
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -24,6 +26,7 @@ struct hash<std::vector<char>> {
 namespace torrent_node_lib {
 
 struct FilePosition;
+class FileNamesDictionary;
 class BlockChainReadInterface;
 class Address;
 struct TransactionInfo;
@@ -56,14 +59,21 @@ struct ScriptBlockInfo;
 struct AllNodes;
 struct SignBlockHeader;
 struct BlocksMetadata;
+struct BlockTxsOffsets;
 struct TransactionStatus;
 
 struct FileInfo;
 struct CroppedFileName;
 class LevelDb;
 
+/**
+ *c Счетчики записей истории и делегирований в частях батча меньше этого значения. При слиянии частей они заменяются на настоящие
+ */
+const static size_t BATCH_PART_COUNTER_LIMIT = size_t(1) << 56;
+
 class Batch {
     friend void addBatch(Batch &batch, LevelDb &leveldb);
+    friend void mergeBatches(Batch &batch, std::vector<Batch> &parts, const std::vector<std::pair<size_t, size_t>> &order, const std::function<size_t()> &getCounter);
     
 public:
     
@@ -75,6 +85,11 @@ public:
     
     void addAddressToken(const std::string &address, const AddressInfo &value, size_t counter);
     
+    /**
+     *c Перезаписывает запись истории по готовому ключу. Для миграций
+     */
+    void replaceAddressRecord(const std::string &key, const AddressInfo &value);
+    
     void addTransaction(const std::string &txHash, const TransactionInfo &value);
     
     void addBalance(const std::string &address, const BalanceInfo &value);
@@ -121,10 +136,21 @@ public:
     
     void addSignBlockHeader(const std::vector<unsigned char> &blockHash, const SignBlockHeader &value);
     
+    void addBlockTxsOffsets(const std::vector<unsigned char> &blockHash, const BlockTxsOffsets &value);
+    
     void addBlockMetadata(const BlocksMetadata &value);
     
     void addFileMetadata(const CroppedFileName &fileName, const FileInfo &value);
     
+    void addFileName(size_t id, const std::string &fileName);
+    
+    /**
+     *c Прогресс миграции флагов истории адресов. Пишется в том же батче, что и перезаписанные записи
+     */
+    void addAddressFlagsMigration(bool isTokens, const std::string &lastKey);
+    
+    void addAddressFlagsMigrationFinished();
+    
     void addCommonBalance(const CommonBalance &value);
     
     void addMainBlock(const MainBlockInfo &value);
@@ -136,6 +162,8 @@ public:
     void addAllNodes(const AllNodes &value);
     
     void saveBlockTimeline(size_t key, const std::vector<char> &data);
+    
+    size_t getCountOps() const;
         
 private:
     
@@ -155,6 +183,7 @@ private:
     leveldb::WriteBatch batch;
     std::unordered_map<std::vector<char>, std::vector<char>> save;
     std::unordered_set<std::vector<char>> deleted;
+    size_t countOps = 0;
     mutable std::mutex mut;
     
     thread_local static std::vector<char> bufferKey;
@@ -182,18 +211,42 @@ public:
        
     std::vector<std::pair<size_t, std::string>> findAllBlocksTimeline();
     
+    std::vector<std::pair<size_t, std::string>> findBlocksTimelineFrom(size_t fromKey) const;
+    
     BlocksMetadata findBlockMetadata() const;
     
     std::vector<AddressInfo> findAddress(const std::string &address, size_t from, size_t count) const;
     
     std::vector<AddressInfo> findAddressTokens(const std::string &address, size_t from, size_t count) const;
     
+    std::vector<std::pair<size_t, AddressInfo>> findAddressFromCursor(const std::string &address, const std::optional<size_t> &afterCounter, size_t count) const;
+    
+    /**
+     *c Просматривает историю адреса с записи from, пока не наберется count записей, прошедших filter.
+     *c В from возвращается номер записи, следующей за последней просмотренной
+     */
+    std::vector<AddressInfo> findAddressFiltered(const std::string &address, bool isTokens, size_t &from, size_t count, const std::function<bool(const AddressInfo &info)> &filter) const;
+    
+    /**
+     *c Порция записей истории всех адресов после ключа afterKey вместе с ключами. Для миграций
+     */
+    std::vector<std::pair<std::string, AddressInfo>> findAllAddressesPart(bool isTokens, const std::string &afterKey, size_t count) const;
+    
     std::vector<TransactionStatus> findAddressStatus(const std::string &address) const;
     
     BalanceInfo findBalance(const std::string &address) const;
     
     std::optional<TransactionInfo> findTx(const std::string &txHash) const;
     
+    /**
+     *c Пакетное чтение. Ключи сортируются и читаются из одного снимка базы в countThreads потоков. Порядок результата совпадает с порядком входа
+     */
+    std::vector<BalanceInfo> findBalances(const std::vector<std::string> &addresses, size_t countThreads) const;
+    
+    std::vector<std::optional<TransactionInfo>> findTxs(const std::vector<std::string> &txHashes, size_t countThreads) const;
+    
+    std::vector<std::optional<TransactionStatus>> findTxsStatuses(const std::vector<std::string> &txHashes, size_t countThreads) const;
+    
     Token findToken(const std::string &address) const;
     
     std::optional<TransactionStatus> findTxStatus(const std::string &txHash) const;
@@ -204,6 +257,10 @@ public:
     
     std::set<std::string> getAllBlocks() const;
     
+    std::optional<BlockHeader> findBlockHeader(const std::vector<unsigned char> &blockHash) const;
+    
+    std::optional<BlockTxsOffsets> findBlockTxsOffsets(const std::vector<unsigned char> &blockHash) const;
+    
     std::string findModules() const;
     
     MainBlockInfo findMainBlock() const;
@@ -222,6 +279,24 @@ public:
     
     std::string findVersionDb() const;
     
+    std::vector<std::pair<size_t, std::string>> findAllFileNames() const;
+    
+    /**
+     *c Онлайн миграция на номера файлов. Просматривает не больше count записей истории адресов и транзакций
+     *c и перезаписывает сохраненные со старым форматом FilePosition. Прогресс хранится в базе. Возвращает false, когда миграция закончена
+     */
+    bool migrateFilePositionsPart(size_t count, FileNamesDictionary &fileNames);
+    
+    /**
+     *c Помечает, что записи истории адресов нужно дополнить флагами. Сама миграция идет онлайн из WorkerMain
+     */
+    void startAddressFlagsMigration();
+    
+    /**
+     *c Тип истории и последний обработанный ключ миграции флагов. nullopt, если миграция не нужна или закончена
+     */
+    std::optional<std::pair<bool, std::string>> findAddressFlagsMigration() const;
+    
     NodeStatBlockInfo findNodeStatBlock() const;
 
     BestNodeTest findNodeStatLastResults(const std::string &address) const;
@@ -273,6 +348,8 @@ private:
     template<class Key>
     std::string findOneValueInternal(const Key &key, bool isCheck) const;
     
+    std::vector<std::string> findValuesSorted(const std::vector<std::vector<char>> &keys, size_t countThreads) const;
+    
     template<typename Result, class Key, typename Func>
     std::vector<Result> findKeyInternal(const Key &keyFrom, const Key &keyTo, size_t from, size_t count, const Func &func) const;
     
@@ -287,8 +364,16 @@ private:
 
 void addBatch(Batch &batch, LevelDb &leveldb);
 
+/**
+ *c Переносит операции частей в batch. order - номер части и количество ее операций в порядке исходной последовательности.
+ *c Счетчики частей в ключах истории и делегирований заменяются значениями getCounter в порядке первого появления
+ */
+void mergeBatches(Batch &batch, std::vector<Batch> &parts, const std::vector<std::pair<size_t, size_t>> &order, const std::function<size_t()> &getCounter);
+
 std::string makeAddressStatusKey(const std::string &address, const std::string &txHash);
 
+std::string getAddressFromAddressKey(const std::string &key, bool isTokens);
+
 std::string makeKeyDelegatePair(const std::string &keyFrom, const std::string &keyTo);
 
 std::string getSecondOnKeyDelegatePair(const std::string &keyFrom, const std::string &delegateKeyPair);
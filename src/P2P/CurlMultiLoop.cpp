@@ -0,0 +1,329 @@
+#include "CurlMultiLoop.h"
+
+#include <event2/event.h>
+
+#include <algorithm>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "log.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+struct CurlMultiLoop::Request {
+    size_t id;
+    std::string url;
+    std::string postData;
+    std::string header;
+    size_t timeoutSec;
+    Callback callback;
+
+    CURL *easy = nullptr;
+    curl_slist *headers = nullptr;
+    std::string response;
+    char errorBuffer[CURL_ERROR_SIZE] = {0};
+    time_point beginTime;
+
+    ~Request() {
+        if (headers != nullptr) {
+            curl_slist_free_all(headers);
+        }
+        if (easy != nullptr) {
+            curl_easy_cleanup(easy);
+        }
+    }
+};
+
+static size_t writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    std::string &response = *static_cast<std::string*>(userdata);
+    response.append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+CurlMultiLoop::CurlMultiLoop() {
+    base = event_base_new();
+    CHECK(base != nullptr, "Not created event base");
+
+    multi = curl_multi_init();
+    CHECK(multi != nullptr, "Not created curl multi");
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, &CurlMultiLoop::socketCallback);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, &CurlMultiLoop::timerCallback);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+
+    timerEvent = evtimer_new(base, &CurlMultiLoop::timeoutCallback, this);
+    CHECK(timerEvent != nullptr, "Not created timer event");
+
+    //c Через eventfd другие потоки будят цикл, не требуя потокобезопасной сборки libevent
+    wakeupFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    CHECK(wakeupFd >= 0, "Not created eventfd");
+    wakeupEvent = event_new(base, wakeupFd, EV_READ | EV_PERSIST, &CurlMultiLoop::wakeupCallback, this);
+    CHECK(wakeupEvent != nullptr, "Not created wakeup event");
+    event_add(wakeupEvent, nullptr);
+
+    thread = std::thread(&CurlMultiLoop::run, this);
+}
+
+CurlMultiLoop::~CurlMultiLoop() {
+    std::unique_lock<std::mutex> lock(pendingMut);
+    stopped = true;
+    lock.unlock();
+    wakeup();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    std::vector<std::unique_ptr<Request>> notStarted;
+    lock.lock();
+    notStarted.swap(pendingRequests);
+    lock.unlock();
+    for (std::unique_ptr<Request> &request: notStarted) {
+        finishRequest(std::move(request), CURLE_ABORTED_BY_CALLBACK);
+    }
+    while (!activeRequests.empty()) {
+        std::unique_ptr<Request> request = std::move(activeRequests.begin()->second);
+        activeRequests.erase(activeRequests.begin());
+        curl_multi_remove_handle(multi, request->easy);
+        finishRequest(std::move(request), CURLE_ABORTED_BY_CALLBACK);
+    }
+
+    curl_multi_cleanup(multi);
+    event_free(wakeupEvent);
+    ::close(wakeupFd);
+    event_free(timerEvent);
+    event_base_free(base);
+}
+
+size_t CurlMultiLoop::request(const std::string &url, const std::string &postData, const std::string &header, size_t timeoutSec, const Callback &callback) {
+    auto request = std::make_unique<Request>();
+    request->url = url;
+    request->postData = postData;
+    request->header = header;
+    request->timeoutSec = timeoutSec;
+    request->callback = callback;
+    request->beginTime = ::now();
+
+    std::unique_lock<std::mutex> lock(pendingMut);
+    const size_t requestId = nextRequestId++;
+    request->id = requestId;
+    if (stopped) {
+        lock.unlock();
+        finishRequest(std::move(request), CURLE_ABORTED_BY_CALLBACK);
+        return requestId;
+    }
+    pendingRequests.emplace_back(std::move(request));
+    lock.unlock();
+
+    wakeup();
+    return requestId;
+}
+
+void CurlMultiLoop::cancel(size_t requestId) {
+    std::unique_lock<std::mutex> lock(pendingMut);
+    if (stopped) {
+        return;
+    }
+    pendingCancels.emplace_back(requestId);
+    lock.unlock();
+
+    wakeup();
+}
+
+void CurlMultiLoop::wakeup() {
+    const uint64_t value = 1;
+    const ssize_t res = ::write(wakeupFd, &value, sizeof(value));
+    if (res != sizeof(value) && errno != EAGAIN) {
+        LOGERR << "Not writed to eventfd";
+    }
+}
+
+void CurlMultiLoop::run() {
+    try {
+        event_base_dispatch(base);
+    } catch (const exception &e) {
+        LOGERR << e;
+    } catch (const std::exception &e) {
+        LOGERR << e.what();
+    } catch (...) {
+        LOGERR << "Unknown error";
+    }
+}
+
+void CurlMultiLoop::addPendingRequests() {
+    std::unique_lock<std::mutex> lock(pendingMut);
+    if (stopped) {
+        event_base_loopbreak(base);
+        return;
+    }
+    std::vector<std::unique_ptr<Request>> requests;
+    requests.swap(pendingRequests);
+    std::vector<size_t> cancels;
+    cancels.swap(pendingCancels);
+    lock.unlock();
+
+    for (std::unique_ptr<Request> &request: requests) {
+        startRequest(std::move(request));
+    }
+    cancelRequests(cancels);
+}
+
+void CurlMultiLoop::cancelRequests(const std::vector<size_t> &ids) {
+    for (const size_t id: ids) {
+        const auto found = std::find_if(activeRequests.begin(), activeRequests.end(), [id](const auto &pair) {
+            return pair.second->id == id;
+        });
+        //c Запрос мог уже завершиться сам
+        if (found == activeRequests.end()) {
+            continue;
+        }
+        std::unique_ptr<Request> request = std::move(found->second);
+        activeRequests.erase(found);
+        curl_multi_remove_handle(multi, request->easy);
+        finishRequest(std::move(request), CURLE_ABORTED_BY_CALLBACK, true);
+    }
+}
+
+void CurlMultiLoop::startRequest(std::unique_ptr<Request> &&request) {
+    CURL *easy = curl_easy_init();
+    if (easy == nullptr) {
+        finishRequest(std::move(request), CURLE_FAILED_INIT);
+        return;
+    }
+    request->easy = easy;
+
+    curl_easy_setopt(easy, CURLOPT_URL, request->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT, static_cast<long>(request->timeoutSec));
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, static_cast<long>(request->timeoutSec));
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &writeCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &request->response);
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, request->errorBuffer);
+    if (!request->postData.empty()) {
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request->postData.data());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(request->postData.size()));
+    }
+    if (!request->header.empty()) {
+        request->headers = curl_slist_append(request->headers, request->header.c_str());
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request->headers);
+    }
+
+    const CURLMcode res = curl_multi_add_handle(multi, easy);
+    if (res != CURLM_OK) {
+        finishRequest(std::move(request), CURLE_FAILED_INIT);
+        return;
+    }
+    activeRequests.emplace(easy, std::move(request));
+}
+
+void CurlMultiLoop::checkFinished() {
+    int countLeft = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi, &countLeft)) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL *easy = msg->easy_handle;
+        const CURLcode result = msg->data.result;
+        curl_multi_remove_handle(multi, easy);
+
+        const auto found = activeRequests.find(easy);
+        if (found == activeRequests.end()) {
+            LOGERR << "Finished unknown curl request";
+            continue;
+        }
+        std::unique_ptr<Request> request = std::move(found->second);
+        activeRequests.erase(found);
+        finishRequest(std::move(request), result);
+    }
+}
+
+void CurlMultiLoop::finishRequest(std::unique_ptr<Request> &&request, CURLcode result, bool isCancelled) {
+    Response response;
+    response.time = std::chrono::duration_cast<milliseconds>(::now() - request->beginTime);
+    response.isCancelled = isCancelled;
+    if (result == CURLE_OK) {
+        response.response = std::move(request->response);
+    } else {
+        response.error = std::string(curl_easy_strerror(result)) + " " + request->errorBuffer + " " + request->url;
+    }
+    const Callback callback = std::move(request->callback);
+    request.reset();
+
+    try {
+        callback(std::move(response));
+    } catch (const exception &e) {
+        LOGERR << e;
+    } catch (const std::exception &e) {
+        LOGERR << e.what();
+    } catch (...) {
+        LOGERR << "Unknown error";
+    }
+}
+
+int CurlMultiLoop::socketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    CurlMultiLoop &loop = *static_cast<CurlMultiLoop*>(userp);
+    event *ev = static_cast<event*>(socketp);
+
+    if (what == CURL_POLL_REMOVE) {
+        if (ev != nullptr) {
+            event_free(ev);
+        }
+        curl_multi_assign(loop.multi, s, nullptr);
+        return 0;
+    }
+
+    const short kind = EV_PERSIST | ((what & CURL_POLL_IN) ? EV_READ : 0) | ((what & CURL_POLL_OUT) ? EV_WRITE : 0);
+    if (ev != nullptr) {
+        event_del(ev);
+        event_assign(ev, loop.base, s, kind, &CurlMultiLoop::eventCallback, &loop);
+    } else {
+        ev = event_new(loop.base, s, kind, &CurlMultiLoop::eventCallback, &loop);
+        curl_multi_assign(loop.multi, s, ev);
+    }
+    event_add(ev, nullptr);
+    return 0;
+}
+
+int CurlMultiLoop::timerCallback(CURLM *multi, long timeoutMs, void *userp) {
+    CurlMultiLoop &loop = *static_cast<CurlMultiLoop*>(userp);
+    if (timeoutMs < 0) {
+        evtimer_del(loop.timerEvent);
+    } else {
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        evtimer_add(loop.timerEvent, &tv);
+    }
+    return 0;
+}
+
+void CurlMultiLoop::eventCallback(int fd, short kind, void *userp) {
+    CurlMultiLoop &loop = *static_cast<CurlMultiLoop*>(userp);
+    const int flags = ((kind & EV_READ) ? CURL_CSELECT_IN : 0) | ((kind & EV_WRITE) ? CURL_CSELECT_OUT : 0);
+    int running = 0;
+    curl_multi_socket_action(loop.multi, fd, flags, &running);
+    loop.checkFinished();
+    if (running <= 0) {
+        evtimer_del(loop.timerEvent);
+    }
+}
+
+void CurlMultiLoop::timeoutCallback(int fd, short kind, void *userp) {
+    CurlMultiLoop &loop = *static_cast<CurlMultiLoop*>(userp);
+    int running = 0;
+    curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    loop.checkFinished();
+}
+
+void CurlMultiLoop::wakeupCallback(int fd, short kind, void *userp) {
+    CurlMultiLoop &loop = *static_cast<CurlMultiLoop*>(userp);
+    uint64_t value;
+    while (::read(fd, &value, sizeof(value)) == sizeof(value)) {
+    }
+    loop.addPendingRequests();
+}
+
+} // namespace torrent_node_lib
@@ -0,0 +1,111 @@
+#ifndef CURL_MULTI_LOOP_H_
+#define CURL_MULTI_LOOP_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <curl/curl.h>
+
+#include "duration.h"
+#include "OopUtils.h"
+
+struct event_base;
+struct event;
+
+namespace torrent_node_lib {
+
+/**
+ *c Выполняет http запросы через curl multi в одном потоке с циклом libevent.
+ *c Все запросы делят один пул соединений, поэтому медленный сервер не занимает поток
+ */
+class CurlMultiLoop: common::no_copyable, common::no_moveable {
+public:
+
+    struct Response {
+        std::string response;
+        std::optional<std::string> error;
+        milliseconds time;
+        bool isCancelled = false;
+    };
+
+    using Callback = std::function<void(Response &&response)>;
+
+public:
+
+    CurlMultiLoop();
+
+    ~CurlMultiLoop();
+
+    /**
+     *c Можно вызывать из любого потока. callback вызывается из потока цикла и не должен надолго его занимать
+     */
+    size_t request(const std::string &url, const std::string &postData, const std::string &header, size_t timeoutSec, const Callback &callback);
+    
+    /**
+     *c Прерывает запрос, если он еще не завершился. callback придет с ошибкой и isCancelled
+     */
+    void cancel(size_t requestId);
+
+private:
+
+    struct Request;
+
+private:
+
+    void run();
+
+    void addPendingRequests();
+
+    void startRequest(std::unique_ptr<Request> &&request);
+
+    void checkFinished();
+
+    void cancelRequests(const std::vector<size_t> &ids);
+
+    void finishRequest(std::unique_ptr<Request> &&request, CURLcode result, bool isCancelled = false);
+
+    static int socketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp);
+
+    static int timerCallback(CURLM *multi, long timeoutMs, void *userp);
+
+    static void eventCallback(int fd, short kind, void *userp);
+
+    static void timeoutCallback(int fd, short kind, void *userp);
+
+    static void wakeupCallback(int fd, short kind, void *userp);
+
+    void wakeup();
+
+private:
+
+    event_base *base = nullptr;
+
+    CURLM *multi = nullptr;
+
+    event *timerEvent = nullptr;
+
+    int wakeupFd = -1;
+
+    event *wakeupEvent = nullptr;
+
+    std::unordered_map<CURL*, std::unique_ptr<Request>> activeRequests;
+
+    std::mutex pendingMut;
+    std::vector<std::unique_ptr<Request>> pendingRequests;
+    std::vector<size_t> pendingCancels;
+    size_t nextRequestId = 0;
+    bool stopped = false;
+
+    std::thread thread;
+
+};
+
+} // namespace torrent_node_lib
+
+#endif // CURL_MULTI_LOOP_H_
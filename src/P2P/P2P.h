@@ -10,6 +10,7 @@
 #include "duration.h"
 
 #include "P2PStructs.h"
+#include "ConfigOptions.h"
 
 namespace common {
 struct CurlInstance;
@@ -65,6 +66,12 @@ public:
      */
     virtual void broadcast(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const = 0;
     
+    /**
+     *c Как broadcast, но после первого успешного ответа остальные сервера ждет только до их порога hedge.
+     *c Не успевшие сервера в callback не попадают
+     */
+    virtual void broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const = 0;
+    
     virtual std::string request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) = 0;
     
     virtual std::vector<std::string> requests(size_t countRequests, const MakeQsAndPostFunction2 &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) = 0;
@@ -72,6 +79,8 @@ public:
     virtual std::string runOneRequest(const std::string &server, const std::string &qs, const std::string &postData, const std::string &header) const = 0;
     
     virtual SendAllResult requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const = 0;
+    
+    virtual void setSegmentOptions(const P2PSegmentOptions &options) = 0;
 
 };
 
@@ -10,6 +10,8 @@
 #include "QueueP2P.h"
 #include "P2P_Impl.h"
 
+#include "utils/Metrics.h"
+
 using namespace common;
 
 namespace torrent_node_lib {
@@ -77,7 +79,11 @@ void P2PThread::work() {
                         curl = std::make_unique<CurlInstance>(Curl::getInstance());
                     }
                     const std::string response = P2P_Impl::request(*curl, qs, post, "", server);
-                    referenceWrapper->get()->processResponse(response, *segment);
+                    const bool isWon = referenceWrapper->get()->processResponse(response, *segment);
+                    if (isWon && element.isHedged()) {
+                        static MetricCounter &hedgedWins = getMetrics().counter("torrent_p2p_hedged_wins_total", "Duplicated requests answered before the original", metricLabel("kind", "segment"));
+                        hedgedWins.inc();
+                    }
                     queue.removeElement(element);
                 } catch (const exception &e) {
                     LOGWARN << "Error " << e << " " << server;
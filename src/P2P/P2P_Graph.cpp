@@ -73,7 +73,8 @@ std::vector<std::string> P2P_Graph::requestImpl(size_t responseSize, size_t minR
     
     const size_t maxServers = getMaxServersCount(server);
     
-    const size_t countSegments = isMultitplyRequests ? responseSize : std::min((responseSize + minResponseSize - 1) / minResponseSize, maxServers);
+    const size_t segmentSize = isMultitplyRequests ? minResponseSize : P2P_Impl::getSegmentSize(p2p.getSegmentOptions(), {server}, maxServers, responseSize);
+    const size_t countSegments = isMultitplyRequests ? responseSize : (responseSize + segmentSize - 1) / segmentSize;
     const auto requestServers = getServersList(server, countSegments);
     
     std::vector<std::string> answers(countSegments);
@@ -95,7 +96,7 @@ std::vector<std::string> P2P_Graph::requestImpl(size_t responseSize, size_t minR
         }
     };
     
-    const std::vector<Segment> segments = P2P_Impl::makeSegments(countSegments, responseSize, minResponseSize);
+    const std::vector<Segment> segments = P2P_Impl::makeSegments(countSegments, responseSize, segmentSize);
     const bool isSuccess = p2p.process(requestServers, segments, makeQsAndPost, processResponse);
     CHECK(isSuccess, "dont run request");
         
@@ -103,9 +104,7 @@ std::vector<std::string> P2P_Graph::requestImpl(size_t responseSize, size_t minR
 }
 
 std::string P2P_Graph::request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction& makeQsAndPost, const std::string& header, const ResponseParseFunction& responseParse, const std::vector<std::string> &hintsServers) {
-    const size_t MIN_RESPONSE_SIZE = 10000;
-    
-    const std::vector<std::string> answers = requestImpl(responseSize, MIN_RESPONSE_SIZE, isPrecisionSize, makeQsAndPost, header, responseParse, hintsServers);
+    const std::vector<std::string> answers = requestImpl(responseSize, p2p.getSegmentOptions().minSegmentSize, isPrecisionSize, makeQsAndPost, header, responseParse, hintsServers);
     
     std::string response;
     response.reserve(responseSize);
@@ -143,3 +142,11 @@ SendAllResult P2P_Graph::requestAll(const std::string &qs, const std::string &po
     
     return P2P_Impl::process(allServers, qs, postData, header, requestFunction);
 }
+
+void P2P_Graph::setSegmentOptions(const P2PSegmentOptions &options) {
+    p2p.setSegmentOptions(options);
+}
+
+void P2P_Graph::broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const {
+    broadcast(qs, postData, header, callback);
+}
@@ -26,6 +26,8 @@ public:
      */
     void broadcast(const std::string &qs, const std::string &postData, const std::string &header, const torrent_node_lib::BroadcastResult &callback) const override;
     
+    void broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const torrent_node_lib::BroadcastResult &callback) const override;
+    
     std::string request(size_t responseSize, bool isPrecisionSize, const torrent_node_lib::MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const torrent_node_lib::ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
        
     std::vector<std::string> requests(size_t countRequests, const torrent_node_lib::MakeQsAndPostFunction2 &makeQsAndPost, const std::string &header, const torrent_node_lib::ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
@@ -34,6 +36,8 @@ public:
    
     torrent_node_lib::SendAllResult requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const override;
     
+    void setSegmentOptions(const torrent_node_lib::P2PSegmentOptions &options) override;
+    
 private:
     
     size_t getMaxServersCount(const std::string &srvr) const;
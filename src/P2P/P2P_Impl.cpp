@@ -1,5 +1,8 @@
 #include "P2P_Impl.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "check.h"
 
 #include "parallel_for.h"
@@ -10,6 +13,7 @@
 #include "curlWrapper.h"
 
 #include "ReferenceWrapper.h"
+#include "PeersHealth.h"
 
 using namespace common;
 
@@ -32,6 +36,28 @@ std::vector<Segment> P2P_Impl::makeSegments(size_t countSegments, size_t size, s
     return answer;
 }
 
+size_t P2P_Impl::getSegmentSize(const P2PSegmentOptions &options, const std::vector<std::string> &servers, size_t countThreads, size_t size) {
+    std::vector<double> bdps;
+    for (const std::string &server: servers) {
+        const std::optional<PeersHealth::PeerStat> stat = getPeersHealth().getStat(server);
+        if (stat.has_value() && stat->latencyMs != 0 && stat->bytesPerMs != 0) {
+            bdps.emplace_back(stat->latencyMs * stat->bytesPerMs);
+        }
+    }
+    
+    const size_t countSegments = std::max<size_t>(countThreads * options.segmentsPerConnection, 1);
+    const size_t byThreads = (size + countSegments - 1) / countSegments;
+    
+    size_t segmentSize = byThreads;
+    if (!bdps.empty()) {
+        std::nth_element(bdps.begin(), bdps.begin() + bdps.size() / 2, bdps.end());
+        const size_t bySpeed = std::llround(bdps[bdps.size() / 2] * options.bdpMultiplier);
+        segmentSize = std::min(bySpeed, byThreads);
+    }
+    
+    return std::clamp(segmentSize, options.minSegmentSize, std::max(options.minSegmentSize, options.maxSegmentSize));
+}
+
 template<typename T, typename F>
 static size_t countUnique(const std::vector<T> &elements, const F &compare) {
     std::vector<T> copy = elements;
@@ -48,6 +74,14 @@ P2P_Impl::P2P_Impl(size_t countThreads) {
     }
 }
 
+void P2P_Impl::setSegmentOptions(const P2PSegmentOptions &options) {
+    segmentOptions = options;
+}
+
+const P2PSegmentOptions& P2P_Impl::getSegmentOptions() const {
+    return segmentOptions;
+}
+
 std::string P2P_Impl::request(const CurlInstance &curl, const std::string& qs, const std::string& postData, const std::string& header, const std::string& server) {
     std::string url = server;
     CHECK(!url.empty(), "server empty");
@@ -55,8 +89,17 @@ std::string P2P_Impl::request(const CurlInstance &curl, const std::string& qs, c
         url += '/';
     }
     url += qs;
-    const std::string response = Curl::request(curl, url, postData, header, "", 5);
-    return response;
+    Timer tt;
+    try {
+        const std::string response = Curl::request(curl, url, postData, header, "", 5);
+        tt.stop();
+        getPeersHealth().addResult(server, tt.count(), response.size(), false);
+        return response;
+    } catch (const exception &e) {
+        tt.stop();
+        getPeersHealth().addResult(server, tt.count(), 0, true);
+        throw;
+    }
 }
 
 bool P2P_Impl::process(const std::vector<ThreadDistribution> &threadsDistribution, const std::vector<Segment> &segments, const MakeQsAndPostFunction &makeQsAndPost, const ProcessResponse &processResponse) {   
@@ -66,7 +109,7 @@ bool P2P_Impl::process(const std::vector<ThreadDistribution> &threadsDistributio
         return first.server < second.server;
     });
     
-    blockedQueue.start(taskId);
+    blockedQueue.start(taskId, segmentOptions);
     
     for (const ThreadDistribution &distr: threadsDistribution) {
         for (size_t index = distr.from; index < distr.to; index++) {
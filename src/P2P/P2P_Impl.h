@@ -7,6 +7,8 @@
 
 #include "duration.h"
 
+#include "ConfigOptions.h"
+
 #include "P2PStructs.h"
 #include "P2PThread.h"
 #include "QueueP2P.h"
@@ -43,6 +45,18 @@ public:
     
     static std::vector<Segment> makeSegments(size_t countSegments, size_t size, size_t minSize);
     
+    /**
+     *c Размер сегмента для запроса size байт с servers. Берется по медиане произведения скорости на задержку среди servers,
+     *c один на все серверы, так как сегмент может забрать поток любого сервера.
+     *c Не больше size / (countThreads * segmentsPerConnection), чтобы на каждый поток пришлось хотя бы segmentsPerConnection сегментов.
+     *c Результат ограничен minSegmentSize и maxSegmentSize, minSegmentSize важнее числа сегментов
+     */
+    static size_t getSegmentSize(const P2PSegmentOptions &options, const std::vector<std::string> &servers, size_t countThreads, size_t size);
+    
+    void setSegmentOptions(const P2PSegmentOptions &options);
+    
+    const P2PSegmentOptions& getSegmentOptions() const;
+    
     static std::string request(const common::CurlInstance &curl, const std::string &qs, const std::string &postData, const std::string &header, const std::string &server);
     
     bool process(const std::vector<ThreadDistribution> &threadsDistribution, const std::vector<Segment> &segments, const MakeQsAndPostFunction &makeQsAndPost, const ProcessResponse &processResponse);
@@ -53,6 +67,8 @@ private:
     
     size_t taskId = 1;
     
+    P2PSegmentOptions segmentOptions;
+    
     QueueP2P blockedQueue; // queue должна стоять выше по стеку чем threads, чтобы уничтожится после всех
     
     std::deque<P2PThread> threads;
@@ -1,22 +1,39 @@
 #include "P2P_Ips.h"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
 #include "curlWrapper.h"
 
 #include "check.h"
 #include "log.h"
 
 #include "parallel_for.h"
+#include "PeersHealth.h"
+#include "utils/Metrics.h"
 
 using namespace common;
 
 namespace torrent_node_lib {
 
 const static size_t SIZE_PARALLEL_BROADCAST = 8;
+
+const static size_t SIZE_PARALLEL_PROBE = 16;
+
+const static milliseconds RERANK_PERIOD = 60s;
+
+const static milliseconds CHECK_STOP_PERIOD = 100ms;
     
 P2P_Ips::P2P_Ips(const std::vector<std::string> &servers, size_t countConnections)
+    : P2P_Ips(servers, countConnections, {})
+{}
+
+P2P_Ips::P2P_Ips(const std::vector<std::string> &servers, size_t countConnections, const std::vector<std::string> &candidates)
     : p2p(countConnections * servers.size())
     , servers(servers.begin(), servers.end())
     , countConnections(countConnections)
+    , candidates(candidates)
 {
     CHECK(countConnections != 0, "Incorrect count connections: 0");
     Curl::initialize();
@@ -24,11 +41,103 @@ P2P_Ips::P2P_Ips(const std::vector<std::string> &servers, size_t countConnection
     for (size_t i = 0; i < SIZE_PARALLEL_BROADCAST; i++) {
         curlsBroadcast.emplace_back(Curl::getInstance());
     }
+    for (size_t i = 0; i < SIZE_PARALLEL_BROADCAST; i++) {
+        hedgedThreads.emplace_back(&P2P_Ips::hedgedWorker, this);
+    }
+    
+    if (!candidates.empty()) {
+        rerankThread = Thread(&P2P_Ips::rerankWorker, this);
+    }
+}
+
+P2P_Ips::~P2P_Ips() {
+    std::unique_lock<std::mutex> lock(rerankMut);
+    isRerankStopped = true;
+    rerankCond.notify_one();
+    lock.unlock();
+    rerankThread.join();
+    
+    std::unique_lock<std::mutex> lockHedged(hedgedMut);
+    isHedgedStopped = true;
+    hedgedCond.notify_all();
+    lockHedged.unlock();
+    for (Thread &thread: hedgedThreads) {
+        thread.join();
+    }
+}
+
+void P2P_Ips::hedgedWorker() {
+    const CurlInstance curl = Curl::getInstance();
+    while (true) {
+        std::unique_lock<std::mutex> lock(hedgedMut);
+        hedgedCond.wait(lock, [this] {
+            return isHedgedStopped || !hedgedTasks.empty();
+        });
+        if (isHedgedStopped) {
+            return;
+        }
+        const std::function<void(const CurlInstance&)> task = std::move(hedgedTasks.front());
+        hedgedTasks.pop_front();
+        lock.unlock();
+        
+        task(curl);
+    }
+}
+
+std::vector<std::string> P2P_Ips::getServers() const {
+    std::lock_guard<std::mutex> lock(serversMut);
+    return servers;
 }
 
-P2P_Ips::~P2P_Ips() = default;
+void P2P_Ips::rerankWorker() {
+    try {
+        while (true) {
+            std::unique_lock<std::mutex> lock(rerankMut);
+            rerankCond.wait_for(lock, RERANK_PERIOD, [this]{
+                return isRerankStopped;
+            });
+            if (isRerankStopped) {
+                break;
+            }
+            lock.unlock();
+            
+            //c Результаты проб попадают в PeersHealth внутри P2P_Impl::request
+            parallelFor(SIZE_PARALLEL_PROBE, candidates.begin(), candidates.end(), [](const std::string &server) {
+                try {
+                    P2P_Impl::request(Curl::getInstance(), "status", "", "", server);
+                } catch (const exception &e) {
+                    // empty
+                }
+            });
+            checkStopSignal();
+            
+            //c Текущие сервера идут первыми, чтобы при равных оценках их не вытесняли кандидаты
+            std::vector<std::string> ordered = getServers();
+            std::copy_if(candidates.begin(), candidates.end(), std::back_inserter(ordered), [&ordered](const std::string &server) {
+                return std::find(ordered.begin(), ordered.end(), server) == ordered.end();
+            });
+            const std::vector<std::string> ranked = getPeersHealth().rank(ordered);
+            
+            std::lock_guard<std::mutex> lockServers(serversMut);
+            std::vector<std::string> newServers(ranked.begin(), ranked.begin() + std::min(ranked.size(), servers.size()));
+            if (!newServers.empty() && newServers != servers) {
+                LOGINFO << "P2P servers reranked. Best " << newServers.front() << " score " << getPeersHealth().getScore(newServers.front());
+                servers = newServers;
+            }
+        }
+    } catch (const exception &e) {
+        LOGERR << e;
+    } catch (const StopException &e) {
+        LOGINFO << "Stop p2p rerank thread";
+    } catch (const std::exception &e) {
+        LOGERR << e.what();
+    } catch (...) {
+        LOGERR << "Unknown error";
+    }
+}
 
 void P2P_Ips::broadcast(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult& callback) const {
+    const std::vector<std::string> servers = getServers();
     parallelFor(SIZE_PARALLEL_BROADCAST, servers.begin(), servers.end(), [&qs, &postData, &header, &callback, this](size_t threadNum, const std::string &server) {
         try {
             const std::string response = P2P_Impl::request(curlsBroadcast.at(threadNum), qs, postData, header, server);
@@ -44,6 +153,92 @@ void P2P_Ips::broadcast(const std::string &qs, const std::string &postData, cons
     checkStopSignal();
 }
 
+struct HedgedResponses {
+    std::mutex mut;
+    std::condition_variable cond;
+    std::deque<std::tuple<size_t, std::string, std::optional<std::string>>> responses;
+};
+
+void P2P_Ips::broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const {
+    static MetricCounter &hedgedCuts = getMetrics().counter("torrent_p2p_hedged_broadcast_cuts_total", "Servers not awaited by hedged broadcast after its hedge delay");
+    
+    const std::vector<std::string> servers = getServers();
+    const auto responses = std::make_shared<HedgedResponses>();
+    std::vector<time_point> hedgeTimes;
+    
+    std::vector<bool> isAnswered(servers.size(), false);
+    size_t countSent = 0;
+    std::unique_lock<std::mutex> lockTasks(hedgedMut);
+    for (size_t i = 0; i < servers.size(); i++) {
+        hedgeTimes.emplace_back(::now() + getHedgeDelay(p2p.getSegmentOptions(), servers[i], 0));
+        if (!hedgedInFlight.insert(servers[i]).second) {
+            //c Прошлый запрос к серверу еще не закончился, его не ждем
+            isAnswered[i] = true;
+            continue;
+        }
+        hedgedTasks.emplace_back([this, responses, i, server=servers[i], qs, postData, header](const CurlInstance &curl) {
+            std::string response;
+            std::optional<std::string> error;
+            try {
+                response = P2P_Impl::request(curl, qs, postData, header, server);
+            } catch (const exception &e) {
+                error = e;
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+            std::unique_lock<std::mutex> lockTasks(hedgedMut);
+            hedgedInFlight.erase(server);
+            lockTasks.unlock();
+            
+            std::lock_guard<std::mutex> lock(responses->mut);
+            responses->responses.emplace_back(i, std::move(response), error);
+            responses->cond.notify_one();
+        });
+        countSent++;
+    }
+    hedgedCond.notify_all();
+    lockTasks.unlock();
+    hedgedCuts.inc(servers.size() - countSent);
+    
+    bool isSuccess = false;
+    std::unique_lock<std::mutex> lock(responses->mut);
+    for (size_t i = 0; i < countSent; i++) {
+        std::optional<time_point> deadline;
+        if (isSuccess) {
+            for (size_t j = 0; j < servers.size(); j++) {
+                if (!isAnswered[j] && (!deadline.has_value() || deadline.value() < hedgeTimes[j])) {
+                    deadline = hedgeTimes[j];
+                }
+            }
+        }
+        while (responses->responses.empty() && (!deadline.has_value() || ::now() < deadline.value())) {
+            const time_point waitUntil = ::now() + CHECK_STOP_PERIOD;
+            responses->cond.wait_until(lock, deadline.has_value() ? std::min(deadline.value(), waitUntil) : waitUntil);
+            checkStopSignal();
+        }
+        if (responses->responses.empty()) {
+            hedgedCuts.inc(std::count(isAnswered.begin(), isAnswered.end(), false));
+            break;
+        }
+        const auto [serverIndex, response, error] = std::move(responses->responses.front());
+        responses->responses.pop_front();
+        lock.unlock();
+        
+        isAnswered[serverIndex] = true;
+        if (error.has_value()) {
+            callback(servers[serverIndex], "", CurlException(error.value()));
+        } else {
+            callback(servers[serverIndex], response, {});
+            isSuccess = true;
+        }
+        
+        lock.lock();
+    }
+    lock.unlock();
+    
+    checkStopSignal();
+}
+
 std::string P2P_Ips::runOneRequest(const std::string& server, const std::string& qs, const std::string& postData, const std::string& header) const {
     return P2P_Impl::request(Curl::getInstance(), qs, postData, header, server);
 }
@@ -60,11 +255,23 @@ std::vector<P2P_Impl::ThreadDistribution> P2P_Ips::getServersList(const std::vec
     const size_t maxConnectionsForServer = countConnections;
     CHECK(currConnections <= maxConnectionsForServer, "Ups");
     
-    for (const std::string &srv: srves) {
-        const auto found = std::find(servers.begin(), servers.end(), srv);
-        CHECK(found != servers.end(), "where did this come from?");
-        const size_t index = std::distance(servers.begin(), found);
-        result.emplace_back(index * maxConnectionsForServer, index * maxConnectionsForServer + currConnections, srv);
+    std::vector<double> scores;
+    std::transform(srves.begin(), srves.end(), std::back_inserter(scores), [](const std::string &srv) {
+        return getPeersHealth().getScore(srv);
+    });
+    const double maxScore = *std::max_element(scores.begin(), scores.end());
+    
+    for (size_t i = 0; i < srves.size(); i++) {
+        const std::string &srv = srves[i];
+        const auto found = std::find(srves.begin(), srves.end(), srv);
+        CHECK(found != srves.end(), "where did this come from?");
+        const size_t index = std::distance(srves.begin(), found);
+        //c Серверу с худшей оценкой достается пропорционально меньше потоков, но хотя бы один
+        size_t serverConnections = currConnections;
+        if (maxScore > 0) {
+            serverConnections = std::clamp<size_t>(std::llround(currConnections * scores[i] / maxScore), 1, currConnections);
+        }
+        result.emplace_back(index * maxConnectionsForServer, index * maxConnectionsForServer + serverConnections, srv);
     }
     return result;
 }
@@ -74,9 +281,11 @@ std::vector<std::string> P2P_Ips::requestImpl(size_t responseSize, size_t minRes
     
     const bool isMultitplyRequests = minResponseSize == 1;
     
+    const std::vector<std::string> servers = getServers();
     const size_t maxServers = getMaxServersCount(servers);
     
-    const size_t countSegments = isMultitplyRequests ? responseSize : std::min((responseSize + minResponseSize - 1) / minResponseSize, maxServers);
+    const size_t segmentSize = isMultitplyRequests ? minResponseSize : P2P_Impl::getSegmentSize(p2p.getSegmentOptions(), servers, maxServers, responseSize);
+    const size_t countSegments = isMultitplyRequests ? responseSize : (responseSize + segmentSize - 1) / segmentSize;
     const auto requestServers = getServersList(servers, countSegments);
     
     std::vector<std::string> answers(countSegments);
@@ -98,7 +307,7 @@ std::vector<std::string> P2P_Ips::requestImpl(size_t responseSize, size_t minRes
         }
     };
     
-    const std::vector<Segment> segments = P2P_Impl::makeSegments(countSegments, responseSize, minResponseSize);
+    const std::vector<Segment> segments = P2P_Impl::makeSegments(countSegments, responseSize, segmentSize);
     const bool isSuccess = p2p.process(requestServers, segments, makeQsAndPost, processResponse);
     CHECK(isSuccess, "dont run request");
     
@@ -106,9 +315,7 @@ std::vector<std::string> P2P_Ips::requestImpl(size_t responseSize, size_t minRes
 }
 
 std::string P2P_Ips::request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction& makeQsAndPost, const std::string& header, const ResponseParseFunction& responseParse, const std::vector<std::string> &hintsServers) {
-    const size_t MIN_RESPONSE_SIZE = 10000;
-    
-    const std::vector<std::string> answers = requestImpl(responseSize, MIN_RESPONSE_SIZE, isPrecisionSize, makeQsAndPost, header, responseParse, hintsServers);
+    const std::vector<std::string> answers = requestImpl(responseSize, p2p.getSegmentOptions().minSegmentSize, isPrecisionSize, makeQsAndPost, header, responseParse, hintsServers);
     
     std::string response;
     response.reserve(responseSize);
@@ -132,6 +339,10 @@ std::vector<std::string> P2P_Ips::requests(size_t countRequests, const MakeQsAnd
     return answers;
 }
 
+void P2P_Ips::setSegmentOptions(const P2PSegmentOptions &options) {
+    p2p.setSegmentOptions(options);
+}
+
 SendAllResult P2P_Ips::requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const {
     const auto &mainElementsGraph = servers;
     //const std::vector<Server> mainServers(mainElementsGraph.begin(), mainElementsGraph.end());
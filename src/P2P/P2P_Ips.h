@@ -5,6 +5,13 @@
 #include "P2P_Impl.h"
 
 #include <map>
+#include <set>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "Thread.h"
 
 #include "LimitArray.h"
 
@@ -19,6 +26,11 @@ public:
     
     P2P_Ips(const std::vector<std::string> &servers, size_t countConnections);
     
+    /**
+     *c candidates - сервера, из которых в фоне периодически выбираются servers.size() лучших по PeersHealth
+     */
+    P2P_Ips(const std::vector<std::string> &servers, size_t countConnections, const std::vector<std::string> &candidates);
+    
     ~P2P_Ips() override;
     
     /**
@@ -27,6 +39,8 @@ public:
      */
     void broadcast(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const override;
     
+    void broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const override;
+    
     std::string request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
     
     std::vector<std::string> requests(size_t countRequests, const MakeQsAndPostFunction2 &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
@@ -35,10 +49,18 @@ public:
    
     SendAllResult requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const override;
     
+    void setSegmentOptions(const P2PSegmentOptions &options) override;
+    
 private:
     
     size_t getMaxServersCount(const std::vector<std::string> &srvrs) const;
     
+    std::vector<std::string> getServers() const;
+    
+    void rerankWorker();
+    
+    void hedgedWorker();
+    
     std::vector<P2P_Impl::ThreadDistribution> getServersList(const std::vector<std::string> &srvrs, size_t countSegments) const;
     
     std::vector<std::string> requestImpl(size_t responseSize, size_t minResponseSize, bool isPrecisionSize, const torrent_node_lib::MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const torrent_node_lib::ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers);
@@ -47,12 +69,30 @@ private:
     
     P2P_Impl p2p;
     
+    //c Набор серверов может поменять поток переранжирования, поэтому запросы работают с копией
+    mutable std::mutex serversMut;
     std::vector<std::string> servers;
     
     size_t countConnections;
     
     std::vector<common::CurlInstance> curlsBroadcast;
     
+    const std::vector<std::string> candidates;
+    
+    std::mutex rerankMut;
+    std::condition_variable rerankCond;
+    bool isRerankStopped = false;
+    common::Thread rerankThread;
+    
+    //c Запросы broadcastHedged выполняет постоянный набор потоков, у каждого свой curl.
+    //c Недождавшиеся запросы держат поток не дольше таймаута curl, а сервер с незавершенным запросом повторно не опрашивается
+    mutable std::mutex hedgedMut;
+    mutable std::condition_variable hedgedCond;
+    mutable std::deque<std::function<void(const common::CurlInstance&)>> hedgedTasks;
+    mutable std::set<std::string> hedgedInFlight;
+    bool isHedgedStopped = false;
+    std::vector<common::Thread> hedgedThreads;
+    
 };
 
 }
@@ -0,0 +1,358 @@
+#include "P2P_Multi.h"
+
+#include <deque>
+#include <set>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+#include "CurlMultiLoop.h"
+#include "P2P_Impl.h"
+#include "PeersHealth.h"
+#include "utils/Metrics.h"
+
+#include "curlWrapper.h"
+
+#include "check.h"
+#include "log.h"
+#include "stopProgram.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+const static size_t REQUEST_TIMEOUT_SEC = 5;
+
+const static milliseconds CHECK_STOP_PERIOD = 100ms;
+
+/**
+ *c Ответы, пришедшие из потока цикла. Держится через shared_ptr, чтобы запросы могли завершиться после выхода из ожидания
+ */
+struct MultiResponses {
+    std::mutex mut;
+    std::condition_variable cond;
+    std::deque<std::pair<size_t, CurlMultiLoop::Response>> responses;
+};
+
+static CurlMultiLoop::Callback makeCallback(const std::shared_ptr<MultiResponses> &responses, size_t id, const std::string &server) {
+    return [responses, id, server](CurlMultiLoop::Response &&response) {
+        //c Прерванный нами запрос ничего не говорит о сервере: он мог просто ответить вторым
+        if (!response.isCancelled) {
+            getPeersHealth().addResult(server, response.time, response.response.size(), response.error.has_value());
+        }
+        std::lock_guard<std::mutex> lock(responses->mut);
+        responses->responses.emplace_back(id, std::move(response));
+        responses->cond.notify_one();
+    };
+}
+
+static std::optional<std::pair<size_t, CurlMultiLoop::Response>> waitResponse(MultiResponses &responses, const std::optional<time_point> &deadline) {
+    std::unique_lock<std::mutex> lock(responses.mut);
+    while (responses.responses.empty()) {
+        if (deadline.has_value() && ::now() >= deadline.value()) {
+            return std::nullopt;
+        }
+        const time_point waitUntil = ::now() + CHECK_STOP_PERIOD;
+        responses.cond.wait_until(lock, deadline.has_value() ? std::min(deadline.value(), waitUntil) : waitUntil);
+        checkStopSignal();
+    }
+    std::pair<size_t, CurlMultiLoop::Response> result = std::move(responses.responses.front());
+    responses.responses.pop_front();
+    return result;
+}
+
+static std::string makeUrl(const std::string &server, const std::string &qs) {
+    std::string url = server;
+    CHECK(!url.empty(), "server empty");
+    if (url[url.size() - 1] != '/') {
+        url += '/';
+    }
+    url += qs;
+    return url;
+}
+
+P2P_Multi::P2P_Multi(const std::vector<std::string> &servers, size_t countConnections)
+    : servers(servers)
+    , countConnections(countConnections)
+{
+    CHECK(countConnections != 0, "Incorrect count connections: 0");
+    CHECK(!servers.empty(), "Empty servers");
+    Curl::initialize();
+
+    loop = std::make_unique<CurlMultiLoop>();
+}
+
+P2P_Multi::~P2P_Multi() = default;
+
+void P2P_Multi::broadcast(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const {
+    const auto responses = std::make_shared<MultiResponses>();
+    for (size_t i = 0; i < servers.size(); i++) {
+        loop->request(makeUrl(servers[i], qs), postData, header, REQUEST_TIMEOUT_SEC, makeCallback(responses, i, servers[i]));
+    }
+
+    for (size_t i = 0; i < servers.size(); i++) {
+        const auto [serverIndex, response] = waitResponse(*responses, std::nullopt).value();
+        const std::string &server = servers.at(serverIndex);
+        try {
+            CHECK(!response.error.has_value(), response.error.value());
+            callback(server, response.response, {});
+        } catch (const exception &e) {
+            callback(server, "", CurlException(e));
+        }
+    }
+
+    checkStopSignal();
+}
+
+void P2P_Multi::broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const {
+    static MetricCounter &hedgedCuts = getMetrics().counter("torrent_p2p_hedged_broadcast_cuts_total", "Servers not awaited by hedged broadcast after its hedge delay");
+
+    const auto responses = std::make_shared<MultiResponses>();
+    std::vector<size_t> requestIds;
+    std::vector<time_point> hedgeTimes;
+    for (size_t i = 0; i < servers.size(); i++) {
+        requestIds.emplace_back(loop->request(makeUrl(servers[i], qs), postData, header, REQUEST_TIMEOUT_SEC, makeCallback(responses, i, servers[i])));
+        hedgeTimes.emplace_back(::now() + getHedgeDelay(segmentOptions, servers[i], 0));
+    }
+
+    std::vector<bool> isAnswered(servers.size(), false);
+    bool isSuccess = false;
+    for (size_t i = 0; i < servers.size(); i++) {
+        std::optional<time_point> deadline;
+        if (isSuccess) {
+            for (size_t j = 0; j < servers.size(); j++) {
+                if (!isAnswered[j] && (!deadline.has_value() || deadline.value() < hedgeTimes[j])) {
+                    deadline = hedgeTimes[j];
+                }
+            }
+        }
+        const std::optional<std::pair<size_t, CurlMultiLoop::Response>> result = waitResponse(*responses, deadline);
+        if (!result.has_value()) {
+            for (size_t j = 0; j < servers.size(); j++) {
+                if (!isAnswered[j]) {
+                    hedgedCuts.inc();
+                    loop->cancel(requestIds[j]);
+                }
+            }
+            break;
+        }
+        const auto &[serverIndex, response] = result.value();
+        isAnswered[serverIndex] = true;
+        const std::string &server = servers.at(serverIndex);
+        try {
+            CHECK(!response.error.has_value(), response.error.value());
+            callback(server, response.response, {});
+            isSuccess = true;
+        } catch (const exception &e) {
+            callback(server, "", CurlException(e));
+        }
+    }
+
+    checkStopSignal();
+}
+
+std::string P2P_Multi::runOneRequest(const std::string &server, const std::string &qs, const std::string &postData, const std::string &header) const {
+    const auto responses = std::make_shared<MultiResponses>();
+    loop->request(makeUrl(server, qs), postData, header, REQUEST_TIMEOUT_SEC, makeCallback(responses, 0, server));
+    const auto [id, response] = waitResponse(*responses, std::nullopt).value();
+    CHECK(!response.error.has_value(), response.error.value());
+    return response.response;
+}
+
+std::vector<std::string> P2P_Multi::requestImpl(size_t responseSize, size_t minResponseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse) {
+    CHECK(responseSize != 0, "response size 0");
+
+    static MetricCounter &hedgedRequests = getMetrics().counter("torrent_p2p_hedged_requests_total", "Requests duplicated to another server after hedge delay", metricLabel("kind", "segment"));
+    static MetricCounter &hedgedWins = getMetrics().counter("torrent_p2p_hedged_wins_total", "Duplicated requests answered before the original", metricLabel("kind", "segment"));
+
+    const bool isMultitplyRequests = minResponseSize == 1;
+    const size_t maxServers = countConnections * servers.size();
+    const size_t segmentSize = isMultitplyRequests ? minResponseSize : P2P_Impl::getSegmentSize(segmentOptions, servers, maxServers, responseSize);
+    const size_t countSegments = isMultitplyRequests ? responseSize : (responseSize + segmentSize - 1) / segmentSize;
+    const std::vector<Segment> segments = P2P_Impl::makeSegments(countSegments, responseSize, segmentSize);
+
+    std::vector<std::string> answers(countSegments);
+
+    std::deque<size_t> waitingSegments;
+    for (size_t i = 0; i < segments.size(); i++) {
+        waitingSegments.emplace_back(i);
+    }
+    struct InFlight {
+        size_t requestId;
+        time_point hedgeTime;
+        bool isHedged;
+    };
+    std::vector<std::map<size_t, InFlight>> inFlight(segments.size());
+    std::vector<bool> isDone(segments.size(), false);
+    std::vector<std::set<size_t>> failedServers(segments.size());
+    std::vector<size_t> serversInFlight(servers.size(), 0);
+    size_t countInFlight = 0;
+    bool isError = false;
+
+    //c Сегмент уходит на наименее загруженный из серверов, на которых он еще не падал и не качается
+    const auto selectServer = [this, &serversInFlight, &failedServers, &inFlight](size_t segmentIndex) -> std::optional<size_t> {
+        std::optional<size_t> result;
+        for (size_t i = 0; i < servers.size(); i++) {
+            if (failedServers[segmentIndex].find(i) != failedServers[segmentIndex].end() || inFlight[segmentIndex].find(i) != inFlight[segmentIndex].end() || serversInFlight[i] >= countConnections) {
+                continue;
+            }
+            if (!result.has_value() || serversInFlight[i] < serversInFlight[result.value()]) {
+                result = i;
+            }
+        }
+        return result;
+    };
+
+    const auto responses = std::make_shared<MultiResponses>();
+    const auto sendSegment = [this, &segments, &makeQsAndPost, &header, &responses, &inFlight, &serversInFlight, &countInFlight](size_t segmentIndex, size_t serverIndex, bool isHedged) {
+        const Segment &segment = segments[segmentIndex];
+        const std::string &server = servers[serverIndex];
+        const auto &[qs, post] = makeQsAndPost(segment.fromByte, segment.toByte);
+        const size_t requestId = loop->request(makeUrl(server, qs), post, header, REQUEST_TIMEOUT_SEC, makeCallback(responses, segmentIndex * servers.size() + serverIndex, server));
+        inFlight[segmentIndex].emplace(serverIndex, InFlight{requestId, ::now() + getHedgeDelay(segmentOptions, server, segment.toByte - segment.fromByte), isHedged});
+        serversInFlight[serverIndex]++;
+        countInFlight++;
+    };
+
+    while (true) {
+        std::optional<time_point> nextHedgeTime;
+        if (!isError) {
+            for (auto iter = waitingSegments.begin(); iter != waitingSegments.end();) {
+                const std::optional<size_t> serverIndex = selectServer(*iter);
+                if (!serverIndex.has_value()) {
+                    ++iter;
+                    continue;
+                }
+                sendSegment(*iter, serverIndex.value(), false);
+                iter = waitingSegments.erase(iter);
+            }
+
+            //c Зависший сегмент один раз дублируется на другой сервер, ответ берется от того, кто успеет первым
+            const time_point currTime = ::now();
+            for (size_t segmentIndex = 0; segmentIndex < segments.size(); segmentIndex++) {
+                if (isDone[segmentIndex] || inFlight[segmentIndex].size() != 1) {
+                    continue;
+                }
+                const InFlight &current = inFlight[segmentIndex].begin()->second;
+                if (current.isHedged) {
+                    continue;
+                }
+                if (current.hedgeTime > currTime) {
+                    if (!nextHedgeTime.has_value() || current.hedgeTime < nextHedgeTime.value()) {
+                        nextHedgeTime = current.hedgeTime;
+                    }
+                    continue;
+                }
+                const std::optional<size_t> serverIndex = selectServer(segmentIndex);
+                if (!serverIndex.has_value()) {
+                    continue;
+                }
+                hedgedRequests.inc();
+                sendSegment(segmentIndex, serverIndex.value(), true);
+            }
+        }
+        if (countInFlight == 0) {
+            break;
+        }
+
+        const std::optional<std::pair<size_t, CurlMultiLoop::Response>> result = waitResponse(*responses, nextHedgeTime);
+        if (!result.has_value()) {
+            continue;
+        }
+        const auto &[id, response] = result.value();
+        const size_t segmentIndex = id / servers.size();
+        const size_t serverIndex = id % servers.size();
+        const auto foundInFlight = inFlight[segmentIndex].find(serverIndex);
+        CHECK(foundInFlight != inFlight[segmentIndex].end(), "Unknown response");
+        const bool isHedged = foundInFlight->second.isHedged;
+        inFlight[segmentIndex].erase(foundInFlight);
+        serversInFlight[serverIndex]--;
+        countInFlight--;
+        if (isError || isDone[segmentIndex] || response.isCancelled) {
+            continue;
+        }
+
+        const Segment &segment = segments[segmentIndex];
+        try {
+            CHECK(!response.error.has_value(), response.error.value());
+            const ResponseParse parsed = responseParse(response.response, segment.fromByte, segment.toByte);
+            CHECK(!parsed.error.has_value(), parsed.error.value());
+            if (isPrecisionSize) {
+                CHECK(parsed.response.size() == segment.toByte - segment.fromByte, "Incorrect response size");
+            }
+            answers.at(segment.posInArray) = parsed.response;
+            isDone[segmentIndex] = true;
+            if (isHedged) {
+                hedgedWins.inc();
+            }
+            for (const auto &[otherServer, other]: inFlight[segmentIndex]) {
+                loop->cancel(other.requestId);
+            }
+        } catch (const exception &e) {
+            LOGWARN << "Error " << e << " " << servers[serverIndex];
+            failedServers[segmentIndex].insert(serverIndex);
+            //c Если сегмент еще качается с другого сервера, ждем его ответа
+            if (inFlight[segmentIndex].empty()) {
+                if (failedServers[segmentIndex].size() >= servers.size()) {
+                    isError = true;
+                } else {
+                    waitingSegments.emplace_back(segmentIndex);
+                }
+            }
+        }
+    }
+    CHECK(!isError, "dont run request");
+
+    return answers;
+}
+
+std::string P2P_Multi::request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &/*hintsServers*/) {
+    const std::vector<std::string> answers = requestImpl(responseSize, segmentOptions.minSegmentSize, isPrecisionSize, makeQsAndPost, header, responseParse);
+
+    std::string response;
+    response.reserve(responseSize);
+    for (const std::string &answer: answers) {
+        response += answer;
+    }
+    if (isPrecisionSize) {
+        CHECK(response.size() == responseSize, "response size != getted response. Getted response size: " + std::to_string(response.size()) + ". Expected response size: " + std::to_string(responseSize));
+    }
+
+    return response;
+}
+
+std::vector<std::string> P2P_Multi::requests(size_t countRequests, const MakeQsAndPostFunction2 &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &/*hintsServers*/) {
+    const auto makeQsAndPortImpl = [makeQsAndPost](size_t from, size_t to) {
+        CHECK(to == from + 1, "Incorrect call makeQsAndPortFunc");
+        return makeQsAndPost(from);
+    };
+    const std::vector<std::string> answers = requestImpl(countRequests, 1, false, makeQsAndPortImpl, header, responseParse);
+    CHECK(answers.size() == countRequests, "Incorrect count answers");
+    return answers;
+}
+
+void P2P_Multi::setSegmentOptions(const P2PSegmentOptions &options) {
+    segmentOptions = options;
+}
+
+SendAllResult P2P_Multi::requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const {
+    const std::vector<std::string> otherServers(additionalServers.begin(), additionalServers.end());
+
+    const auto responses = std::make_shared<MultiResponses>();
+    for (size_t i = 0; i < otherServers.size(); i++) {
+        loop->request(makeUrl(otherServers[i], qs), postData, header, REQUEST_TIMEOUT_SEC, makeCallback(responses, i, otherServers[i]));
+    }
+
+    SendAllResult result;
+    for (size_t i = 0; i < otherServers.size(); i++) {
+        auto [serverIndex, response] = waitResponse(*responses, std::nullopt).value();
+        ResponseParse r;
+        r.response = std::move(response.response);
+        r.error = std::move(response.error);
+        result.results.emplace_back(otherServers.at(serverIndex), r, response.time);
+    }
+
+    return result;
+}
+
+} // namespace torrent_node_lib
@@ -0,0 +1,55 @@
+#ifndef P2P_MULTI_H_
+#define P2P_MULTI_H_
+
+#include "P2P.h"
+
+#include <memory>
+
+namespace torrent_node_lib {
+
+class CurlMultiLoop;
+
+/**
+ *c Реализация P2P поверх curl multi и libevent. Все запросы идут из одного потока цикла,
+ *c countConnections ограничивает только число одновременных запросов к одному серверу
+ */
+class P2P_Multi: public P2P {
+public:
+
+    P2P_Multi(const std::vector<std::string> &servers, size_t countConnections);
+
+    ~P2P_Multi() override;
+
+    void broadcast(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const override;
+    
+    void broadcastHedged(const std::string &qs, const std::string &postData, const std::string &header, const BroadcastResult &callback) const override;
+
+    std::string request(size_t responseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
+
+    std::vector<std::string> requests(size_t countRequests, const MakeQsAndPostFunction2 &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse, const std::vector<std::string> &hintsServers) override;
+
+    std::string runOneRequest(const std::string &server, const std::string &qs, const std::string &postData, const std::string &header) const override;
+
+    SendAllResult requestAll(const std::string &qs, const std::string &postData, const std::string &header, const std::set<std::string> &additionalServers) const override;
+    
+    void setSegmentOptions(const P2PSegmentOptions &options) override;
+
+private:
+
+    std::vector<std::string> requestImpl(size_t responseSize, size_t minResponseSize, bool isPrecisionSize, const MakeQsAndPostFunction &makeQsAndPost, const std::string &header, const ResponseParseFunction &responseParse);
+
+private:
+
+    const std::vector<std::string> servers;
+
+    const size_t countConnections;
+    
+    P2PSegmentOptions segmentOptions;
+
+    std::unique_ptr<CurlMultiLoop> loop;
+
+};
+
+} // namespace torrent_node_lib
+
+#endif // P2P_MULTI_H_
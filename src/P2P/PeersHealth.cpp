@@ -0,0 +1,158 @@
+#include "PeersHealth.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace torrent_node_lib {
+
+const static double AVERAGE_ALPHA = 0.2;
+
+//c Ответы меньше этого размера считаются по задержке, больше - по скорости
+const static size_t SMALL_RESPONSE_SIZE = 16 * 1024;
+
+const static size_t REFERENCE_RESPONSE_SIZE = 100 * 1024;
+
+//c Для сервера без статистики, чтобы он получал запросы наравне с неплохими
+const static double UNKNOWN_LATENCY_MS = 200;
+
+const static size_t MAX_TIME_RATIOS = 256;
+
+const static size_t MIN_TIME_RATIOS = 32;
+
+static void addAverage(double &average, double value, bool isFirst) {
+    if (isFirst) {
+        average = value;
+    } else {
+        average += AVERAGE_ALPHA * (value - average);
+    }
+}
+
+void PeersHealth::addResult(const std::string &server, const milliseconds &time, size_t responseSize, bool isError) {
+    std::lock_guard<std::mutex> lock(mut);
+    PeerStat &stat = stats[server];
+    addAverage(stat.errorRate, isError ? 1. : 0., stat.countResults == 0);
+    if (!isError) {
+        const double timeMs = std::max<double>(time.count(), 1.);
+        if (stat.countResults != 0) {
+            const double ratio = timeMs / getExpectedMsImpl(server, responseSize);
+            if (timeRatios.size() < MAX_TIME_RATIOS) {
+                timeRatios.emplace_back(ratio);
+            } else {
+                timeRatios[timeRatiosPos] = ratio;
+                timeRatiosPos = (timeRatiosPos + 1) % MAX_TIME_RATIOS;
+            }
+        }
+        if (responseSize < SMALL_RESPONSE_SIZE) {
+            addAverage(stat.latencyMs, timeMs, stat.latencyMs == 0);
+        } else {
+            addAverage(stat.bytesPerMs, responseSize / timeMs, stat.bytesPerMs == 0);
+            medianBytesPerMs.reset();
+        }
+    }
+    stat.countResults++;
+}
+
+std::optional<PeersHealth::PeerStat> PeersHealth::getStat(const std::string &server) const {
+    std::lock_guard<std::mutex> lock(mut);
+    const auto found = stats.find(server);
+    if (found == stats.end()) {
+        return std::nullopt;
+    }
+    return found->second;
+}
+
+double PeersHealth::getMedianBytesPerMsImpl() const {
+    if (!medianBytesPerMs.has_value()) {
+        std::vector<double> speeds;
+        for (const auto &[server, stat]: stats) {
+            if (stat.bytesPerMs != 0) {
+                speeds.emplace_back(stat.bytesPerMs);
+            }
+        }
+        if (speeds.empty()) {
+            medianBytesPerMs = 0.;
+        } else {
+            std::nth_element(speeds.begin(), speeds.begin() + speeds.size() / 2, speeds.end());
+            medianBytesPerMs = speeds[speeds.size() / 2];
+        }
+    }
+    return medianBytesPerMs.value();
+}
+
+double PeersHealth::getExpectedMsImpl(const std::string &server, size_t responseSize) const {
+    const auto found = stats.find(server);
+    const PeerStat stat = found != stats.end() ? found->second : PeerStat();
+    double expectedMs = stat.latencyMs != 0 ? stat.latencyMs : UNKNOWN_LATENCY_MS;
+    //c Скорость сервера, который еще не отдавал больших ответов, считаем медианной. Иначе он всегда выигрывал бы у загруженных серверов
+    const double bytesPerMs = stat.bytesPerMs != 0 ? stat.bytesPerMs : getMedianBytesPerMsImpl();
+    if (bytesPerMs != 0) {
+        expectedMs += responseSize / bytesPerMs;
+    }
+    return expectedMs;
+}
+
+double PeersHealth::getScoreImpl(const std::string &server) const {
+    const auto found = stats.find(server);
+    const double errorRate = found != stats.end() ? found->second.errorRate : 0.;
+    return (1. - errorRate) / getExpectedMsImpl(server, REFERENCE_RESPONSE_SIZE);
+}
+
+double PeersHealth::getScore(const std::string &server) const {
+    std::lock_guard<std::mutex> lock(mut);
+    return getScoreImpl(server);
+}
+
+milliseconds PeersHealth::getExpectedTime(const std::string &server, size_t responseSize) const {
+    std::lock_guard<std::mutex> lock(mut);
+    return milliseconds(std::llround(getExpectedMsImpl(server, responseSize)));
+}
+
+std::vector<std::string> PeersHealth::rank(const std::vector<std::string> &servers) const {
+    std::vector<double> scores;
+    std::unique_lock<std::mutex> lock(mut);
+    std::transform(servers.begin(), servers.end(), std::back_inserter(scores), [this](const std::string &server) {
+        return getScoreImpl(server);
+    });
+    lock.unlock();
+
+    std::vector<size_t> indexes(servers.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::stable_sort(indexes.begin(), indexes.end(), [&scores](size_t first, size_t second) {
+        return scores[first] > scores[second];
+    });
+
+    std::vector<std::string> result;
+    result.reserve(servers.size());
+    for (const size_t index: indexes) {
+        result.emplace_back(servers[index]);
+    }
+    return result;
+}
+
+std::optional<double> PeersHealth::getTimeRatioPercentile(double percentile) const {
+    std::unique_lock<std::mutex> lock(mut);
+    if (timeRatios.size() < MIN_TIME_RATIOS) {
+        return std::nullopt;
+    }
+    std::vector<double> ratios = timeRatios;
+    lock.unlock();
+    
+    const size_t index = std::min(static_cast<size_t>(percentile * ratios.size()), ratios.size() - 1);
+    std::nth_element(ratios.begin(), ratios.begin() + index, ratios.end());
+    return ratios[index];
+}
+
+PeersHealth& getPeersHealth() {
+    static PeersHealth peersHealth;
+    return peersHealth;
+}
+
+milliseconds getHedgeDelay(const P2PSegmentOptions &options, const std::string &server, size_t responseSize) {
+    const PeersHealth &peersHealth = getPeersHealth();
+    const double factor = peersHealth.getTimeRatioPercentile(options.hedgePercentile).value_or(options.hedgeTimeFactor);
+    const milliseconds expectedTime = peersHealth.getExpectedTime(server, responseSize);
+    return std::max(options.hedgeMinDelay, milliseconds(std::llround(expectedTime.count() * factor)));
+}
+
+} // namespace torrent_node_lib
@@ -0,0 +1,85 @@
+#ifndef PEERS_HEALTH_H_
+#define PEERS_HEALTH_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <optional>
+
+#include "duration.h"
+
+#include "ConfigOptions.h"
+
+namespace torrent_node_lib {
+
+/**
+ *c Скользящие средние по ответам серверов: задержка на маленьких ответах, скорость на больших и доля ошибок
+ */
+class PeersHealth {
+public:
+
+    struct PeerStat {
+        double latencyMs = 0;
+        double bytesPerMs = 0;
+        double errorRate = 0;
+        size_t countResults = 0;
+    };
+
+public:
+
+    void addResult(const std::string &server, const milliseconds &time, size_t responseSize, bool isError);
+
+    std::optional<PeerStat> getStat(const std::string &server) const;
+
+    /**
+     *c Оценка обратна ожидаемому времени ответа среднего размера с учетом ошибок. Чем больше, тем лучше
+     */
+    double getScore(const std::string &server) const;
+    
+    /**
+     *c Ожидаемое время ответа сервера размером responseSize
+     */
+    milliseconds getExpectedTime(const std::string &server, size_t responseSize) const;
+
+    /**
+     *c Сервера по убыванию оценки. При равных оценках сохраняется исходный порядок
+     */
+    std::vector<std::string> rank(const std::vector<std::string> &servers) const;
+    
+    /**
+     *c Перцентиль отношений фактического времени последних ответов к ожидаемому. Пустой, пока ответов мало
+     */
+    std::optional<double> getTimeRatioPercentile(double percentile) const;
+
+private:
+
+    double getMedianBytesPerMsImpl() const;
+    
+    double getExpectedMsImpl(const std::string &server, size_t responseSize) const;
+    
+    double getScoreImpl(const std::string &server) const;
+
+private:
+
+    mutable std::mutex mut;
+
+    std::unordered_map<std::string, PeerStat> stats;
+    
+    mutable std::optional<double> medianBytesPerMs;
+    
+    std::vector<double> timeRatios;
+    size_t timeRatiosPos = 0;
+
+};
+
+PeersHealth& getPeersHealth();
+
+/**
+ *c Через сколько после начала запроса к server стоит продублировать его на другой сервер
+ */
+milliseconds getHedgeDelay(const P2PSegmentOptions &options, const std::string &server, size_t responseSize);
+
+} // namespace torrent_node_lib
+
+#endif // PEERS_HEALTH_H_
@@ -1,12 +1,23 @@
 #include "QueueP2P.h"
 
+#include <algorithm>
+
 #include "stopProgram.h"
 #include "check.h"
 
+#include "PeersHealth.h"
+#include "utils/Metrics.h"
+
 using namespace common;
 
 namespace torrent_node_lib {
+
+const static milliseconds CHECK_STOP_PERIOD = 100ms;
     
+bool QueueP2PElement::isHedged() const {
+    return hedged;
+}
+
 std::optional<Segment> QueueP2PElement::getSegment() const {
     std::shared_ptr<QueueP2P::QueueElement> lock(element.lock());
     if (lock == nullptr) {
@@ -33,19 +44,33 @@ bool QueueP2P::getElement(QueueP2PElement &element, const std::function<bool(con
     std::unique_lock<std::mutex> lock(mut);
     CHECK(taskId <= this->taskId, "Ups");
     typename std::list<std::shared_ptr<QueueElement>>::reverse_iterator it;
-    conditionWait(cond_pop, lock, [this, &it, &predicate, taskId]{ 
-        if (isStopped) {
-            return true;
-        }
-        if (taskId != this->taskId) {
+    while (!isStopped && taskId == this->taskId) {
+        const time_point currTime = ::now();
+        std::optional<time_point> nearestSteal;
+        const auto p = [&predicate, &currTime, &nearestSteal](const std::shared_ptr<QueueElement> &ptr) {
+            if (!predicate(ptr->segment, ptr->servers)) {
+                return false;
+            }
+            //c Сегмент, который уже качает другой сервер, дублируем только когда тот явно не успевает
+            if (!ptr->servers.empty() && ptr->stealTime > currTime) {
+                if (!nearestSteal.has_value() || ptr->stealTime < nearestSteal.value()) {
+                    nearestSteal = ptr->stealTime;
+                }
+                return false;
+            }
             return true;
-        }
-        const auto p = [&predicate](const std::shared_ptr<QueueElement> &ptr) {
-            return predicate(ptr->segment, ptr->servers);
         };
         it = std::find_if(queue.rbegin(), queue.rend(), p);
-        return it != queue.rend(); 
-    });
+        if (it != queue.rend()) {
+            break;
+        }
+        if (nearestSteal.has_value()) {
+            cond_pop.wait_until(lock, std::min(nearestSteal.value(), currTime + CHECK_STOP_PERIOD));
+        } else {
+            cond_pop.wait_for(lock, CHECK_STOP_PERIOD);
+        }
+        checkStopSignal();
+    }
     if (taskId != this->taskId) {
         cond_pop.notify_one();
         return false;
@@ -55,8 +80,16 @@ bool QueueP2P::getElement(QueueP2PElement &element, const std::function<bool(con
     }
     
     typename std::list<std::shared_ptr<QueueElement>>::iterator normIt = (std::next(it)).base();
-    normIt->get()->servers.insert(currentServer);
+    QueueElement &queueElement = *normIt->get();
+    const bool isHedged = queueElement.servers.size() > queueElement.errorServers.size();
+    if (isHedged) {
+        static MetricCounter &hedgedRequests = getMetrics().counter("torrent_p2p_hedged_requests_total", "Requests duplicated to another server after hedge delay", metricLabel("kind", "segment"));
+        hedgedRequests.inc();
+    }
+    queueElement.servers.insert(currentServer);
+    queueElement.stealTime = ::now() + getHedgeDelay(options, currentServer, queueElement.segment.toByte - queueElement.segment.fromByte);
     element = QueueP2PElement(*normIt);
+    element.hedged = isHedged;
     queue.splice(queue.begin(), queue, normIt);
     return true;
 }
@@ -90,6 +123,9 @@ size_t QueueP2P::errorElement(QueueP2PElement &element, const std::string &serve
         return 0;
     } else {
         lockPtr->errorServers.insert(server);
+        //c После ошибки сегмент сразу доступен остальным серверам
+        lockPtr->stealTime = ::now();
+        cond_pop.notify_all();
         return lockPtr->errorServers.size();
     }
 }
@@ -112,13 +148,14 @@ void QueueP2P::stop() {
     cond_empty.notify_all();
 }
 
-void QueueP2P::start(size_t taskId) {
+void QueueP2P::start(size_t taskId, const P2PSegmentOptions &options) {
     std::lock_guard<std::mutex> lock(mut);
     CHECK(isStopped, "Already started");
     isStopped = false;
     isError = false;
     CHECK(taskId > this->taskId, "Incorrect sequences task");
     this->taskId = taskId;
+    this->options = options;
     cond_pop.notify_all();
     cond_empty.notify_all();
 }
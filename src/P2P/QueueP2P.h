@@ -9,6 +9,9 @@
 #include <condition_variable>
 #include <functional>
 
+#include "duration.h"
+
+#include "ConfigOptions.h"
 #include "P2PStructs.h"
 
 namespace torrent_node_lib {
@@ -26,6 +29,9 @@ private:
         
         std::set<std::string> errorServers;
         
+        //c С этого момента сегмент, взятый одним сервером, дублируется на другой
+        time_point stealTime;
+        
         std::list<std::shared_ptr<QueueElement>>::iterator it;
         
         explicit QueueElement(const Segment &segment)
@@ -51,7 +57,7 @@ public:
     
     void stop();
     
-    void start(size_t taskId);
+    void start(size_t taskId, const P2PSegmentOptions &options);
     
     std::optional<size_t> started() const;
     
@@ -78,6 +84,8 @@ private:
     bool isError = false;
     
     size_t taskId = 0;
+    
+    P2PSegmentOptions options;
 };
 
 class QueueP2PElement {
@@ -96,9 +104,16 @@ public:
     
     std::optional<Segment> getSegment() const;
     
+    /**
+     *c Сегмент взят, пока его еще качает другой сервер
+     */
+    bool isHedged() const;
+    
 private:
     
     std::weak_ptr<QueueP2P::QueueElement> element;
+    
+    bool hedged = false;
 };
 
 } // namespace torrent_node_lib 
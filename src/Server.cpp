@@ -34,6 +34,9 @@
 #include "blockchain_structs/CommonBalance.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
 
+#include "utils/serialize.h"
+#include "utils/Metrics.h"
+
 #include "RejectedBlockSource/RejectedBlockSource.h"
 
 using namespace common;
@@ -41,6 +44,7 @@ using namespace torrent_node_lib;
 
 const static std::string GET_ADDRESS_HISTORY = "fetch-history";
 const static std::string GET_ADDRESS_HISTORY_FILTER = "fetch-history-filter";
+const static std::string GET_ADDRESS_HISTORY_CURSOR = "fetch-history-cursor";
 const static std::string GET_ADDRESS_BALANCE = "fetch-balance";
 const static std::string GET_ADDRESS_TOKENS = "address-get-tokens";
 const static std::string GET_ADDRESS_BALANCES = "fetch-balances";
@@ -134,6 +138,21 @@ TransactionsFilters parseFilters(const rapidjson::Value &v) {
     return res;
 }
 
+static std::string makeHistoryCursor(size_t counter) {
+    const std::string raw = serializeInt<size_t>(counter);
+    return toHex(raw.begin(), raw.end());
+}
+
+static std::optional<size_t> parseHistoryCursor(const std::string &cursor) {
+    if (cursor.empty()) {
+        return std::nullopt;
+    }
+    const std::vector<unsigned char> raw = fromHex(cursor);
+    CHECK_USER(raw.size() == sizeof(size_t), "Incorrect cursor");
+    size_t pos = 0;
+    return deserializeInt<size_t>(std::string(raw.begin(), raw.end()), pos);
+}
+
 template<typename T>
 std::string getBlock(const RequestId &requestId, const rapidjson::Document &doc, const std::string &nameParam, const Sync &sync, bool isFormat, const JsonVersion &version) {   
     const auto &jsonParams = get<JsonObject>(doc, "params");
@@ -261,13 +280,13 @@ static std::vector<std::vector<std::vector<unsigned char>>> getBlocksSignatures(
     return blockSignaturesConvert(getBlocksSignaturesFull(sync, bhs));
 }
 
-static std::string getBlocks(const RequestId &requestId, const rapidjson::Document &doc, const Sync &sync, bool isFormat, const JsonVersion &version) {
+static std::string getBlocks(const RequestId &requestId, const rapidjson::Document &doc, const Sync &sync, size_t maxBatchSize, bool isFormat, const JsonVersion &version) {
     const auto &jsonParams = get<JsonObject>(doc, "params");
     
     const int64_t countBlocks = getOpt<int>(jsonParams, "countBlocks", 0);
     const int64_t beginBlock = getOpt<int>(jsonParams, "beginBlock", 0);
     
-    CHECK_USER(countBlocks <= MAX_BATCH_BLOCKS, "Too many blocks");
+    CHECK_USER(countBlocks <= static_cast<int64_t>(maxBatchSize), "Too many blocks");
     
     BlockTypeInfo type = BlockTypeInfo::Simple;
     if (jsonParams.HasMember("type") && jsonParams["type"].IsString()) {
@@ -365,14 +384,14 @@ std::string getBlockDump(const rapidjson::Document &doc, const RequestId &reques
 }
 
 template<typename T>
-std::string getBlockDumps(const rapidjson::Document &doc, const RequestId &requestId, const std::string nameParam, const Sync &sync) {   
+std::string getBlockDumps(const rapidjson::Document &doc, const RequestId &requestId, const std::string nameParam, const Sync &sync, size_t maxBatchSize) {   
     const auto &jsonParams = get<JsonObject>(doc, "params");
     
     const bool isSign = getOpt<bool>(jsonParams, "isSign", false);
     const bool isCompress = getOpt<bool>(jsonParams, "compress", false);
     
     const auto &jsonVals = get<JsonArray>(jsonParams, nameParam);
-    CHECK_USER(jsonVals.Size() <= MAX_BATCH_DUMPS, "Too many blocks");
+    CHECK_USER(jsonVals.Size() <= maxBatchSize, "Too many blocks");
     std::vector<std::string> result;
     for (const auto &jsonVal: jsonVals) {
         const T &hashOrNumber = get<T>(jsonVal);
@@ -402,6 +421,463 @@ std::string getBlockDumps(const rapidjson::Document &doc, const RequestId &reque
     return genDumpBlocksBinary(result, isCompress);
 }
 
+Server::MethodInfo& Server::addMethod(const std::string &name, size_t maxBatchSize, const MethodHandler &handler) {
+    MetricsRegistry &registry = getMetrics();
+    const std::string labels = metricLabel("method", name);
+    MethodMetrics metrics;
+    metrics.countRequests = &registry.counter("torrent_server_requests_total", "Count requests by method", labels);
+    metrics.countErrors = &registry.counter("torrent_server_errors_total", "Count requests finished with error by method", labels);
+    metrics.latencyUs = &registry.histogram("torrent_server_request_duration_us", "Request processing time in microseconds", labels);
+    metrics.responseSize = &registry.histogram("torrent_server_response_size_bytes", "Response size in bytes", labels);
+    
+    const auto [iter, isInserted] = methods.emplace(HashedString(name), MethodInfo{handler, maxBatchSize, metrics, ""});
+    CHECK(isInserted, "Method " + name + " already registered");
+    return iter->second;
+}
+
+void Server::registerMethods() {
+    MetricsRegistry &registry = getMetrics();
+    countUnknownRequests = &registry.counter("torrent_server_unknown_requests_total", "Count requests with unknown method or unparsed body");
+    registry.gauge("torrent_server_running_threads", "Count server threads processing requests", [this]{
+        return countRunningThreads.load();
+    });
+    
+    addMethod("metrics", 0, [](const MethodRequest &request) {
+        return getMetrics().exposition();
+    }).contentType = "text/plain; version=0.0.4";
+    
+    addMethod("status", 0, [this](const MethodRequest &request) {
+        return genStatusResponse(request.requestId, VERSION, g_GIT_SHA1);
+    });
+    
+    addMethod("getinfo", 0, [this](const MethodRequest &request) {
+        return genInfoResponse(request.requestId, VERSION, SERVER_TYPE, serverPrivKey);
+    });
+    
+    addMethod("get-statistic", 0, [this](const MethodRequest &request) {
+        const SmallStatisticElement smallStat = smallRequestStatistics.getStatistic();
+        return genStatisticResponse(smallStat.stat);
+    });
+    
+    addMethod("get-statistic2", 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &pubkey = get<std::string>(jsonParams, "pubkey");
+        const std::string &sign = get<std::string>(jsonParams, "sign");
+        const std::string &timestamp = get<std::string>(jsonParams, "timestamp");
+        const long long timestampLong = std::stoll(timestamp);
+        
+        const auto now = nowSystem();
+        const long long nowTimestamp = getTimestampMs(now);
+        CHECK_USER(std::abs(nowTimestamp - timestampLong) <= milliseconds(5s).count(), "Timestamp is out");
+        
+        CHECK_USER(sync.verifyTechnicalAddressSign(timestamp, fromHex(sign), fromHex(pubkey)), "Incorrect signature");
+        
+        const SmallStatisticElement smallStat = smallRequestStatistics.getStatistic();
+        return genStatisticResponse(request.requestId, smallStat.stat, getProcLoad(), getTotalSystemMemory(), getOpenedConnections());
+    });
+    
+    addMethod(GET_ADDRESS_HISTORY, MAX_HISTORY_SIZE, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        const Address address(addressString);
+        
+        const size_t countTxs = getOpt<int>(jsonParams, "countTxs", 0);
+        const size_t beginTx = getOpt<int>(jsonParams, "beginTx", 0);
+        
+        const std::vector<TransactionInfo> txs = sync.getTxsForAddress(address, beginTx, countTxs, request.maxBatchSize);
+        CHECK(txs.size() <= request.maxBatchSize, "Incorrect result size");
+        
+        return addressesInfoToJson(request.requestId, addressString, txs, sync.getBlockchain(), 0, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_HISTORY_FILTER, MAX_HISTORY_SIZE, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        const Address address(addressString);
+        
+        const size_t countTxs = getOpt<int>(jsonParams, "countTxs", 0);
+        size_t beginTx = getOpt<int>(jsonParams, "beginTx", 0);
+        
+        const TransactionsFilters filters = parseFilters(jsonParams["filters"]);
+        
+        const std::vector<TransactionInfo> txs = sync.getTxsForAddress(address, beginTx, countTxs, request.maxBatchSize, filters);
+        CHECK(txs.size() <= request.maxBatchSize, "Incorrect result size");
+        
+        return addressesInfoToJsonFilter(request.requestId, addressString, txs, beginTx, sync.getBlockchain(), 0, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_HISTORY_CURSOR, MAX_HISTORY_SIZE, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        const Address address(addressString);
+        
+        const size_t countTxs = getOpt<int>(jsonParams, "countTxs", 0);
+        std::optional<size_t> cursor = parseHistoryCursor(getOpt<std::string>(jsonParams, "cursor", ""));
+        
+        const std::vector<TransactionInfo> txs = sync.getTxsForAddressFromCursor(address, cursor, countTxs, request.maxBatchSize);
+        CHECK(txs.size() <= request.maxBatchSize, "Incorrect result size");
+        
+        std::optional<std::string> nextCursor;
+        if (cursor.has_value()) {
+            nextCursor = makeHistoryCursor(cursor.value());
+        }
+        
+        return addressesInfoToJsonCursor(request.requestId, addressString, txs, nextCursor, sync.getBlockchain(), 0, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_BALANCE, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        const Address address(addressString);
+        
+        const BalanceInfo balance = sync.getBalance(address);
+        
+        return balanceInfoToJson(request.requestId, addressString, balance, sync.getBlockchain().countBlocks(), request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_TOKENS, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        const Address address(addressString);
+        
+        const BalanceInfo balance = sync.getBalance(address);
+        
+        return balanceTokenInfoToJson(request.requestId, addressString, balance, sync.getBlockchain().countBlocks(), request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_BALANCES, MAX_BATCH_BALANCES, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const auto &addressesJson = get<JsonArray>(jsonParams, "addresses");
+        
+        CHECK_USER(addressesJson.Size() <= request.maxBatchSize, "Too many transactions. Please, decrease count addresses");
+        std::vector<std::string> addressesStrings;
+        std::vector<Address> addresses;
+        for (const auto &addressJson: addressesJson) {
+            addressesStrings.emplace_back(get<std::string>(addressJson));
+            addresses.emplace_back(addressesStrings.back());
+        }
+        
+        const std::vector<BalanceInfo> balancesInfo = sync.getBalances(addresses);
+        std::vector<std::pair<std::string, BalanceInfo>> balances;
+        balances.reserve(balancesInfo.size());
+        for (size_t i = 0; i < balancesInfo.size(); i++) {
+            balances.emplace_back(addressesStrings[i], balancesInfo[i]);
+        }
+        
+        return balancesInfoToJson(request.requestId, balances, sync.getBlockchain().countBlocks(), request.isFormat, request.version);
+    });
+    
+    addMethod(GET_BLOCK_BY_HASH, 0, [this](const MethodRequest &request) {
+        return getBlock<std::string>(request.requestId, request.doc, "hash", sync, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_BLOCK_BY_NUMBER, 0, [this](const MethodRequest &request) {
+        return getBlock<size_t>(request.requestId, request.doc, "number", sync, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_BLOCKS, MAX_BATCH_BLOCKS, [this](const MethodRequest &request) {
+        return getBlocks(request.requestId, request.doc, sync, request.maxBatchSize, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_DUMP_BLOCK_BY_HASH, 0, [this](const MethodRequest &request) {
+        return getBlockDump<std::string>(request.doc, request.requestId, "hash", sync, request.isFormat);
+    });
+    
+    addMethod(GET_DUMP_BLOCK_BY_NUMBER, 0, [this](const MethodRequest &request) {
+        return getBlockDump<size_t>(request.doc, request.requestId, "number", sync, request.isFormat);
+    });
+    
+    addMethod(GET_DUMPS_BLOCKS_BY_HASH, MAX_BATCH_DUMPS, [this](const MethodRequest &request) {
+        return getBlockDumps<std::string>(request.doc, request.requestId, "hashes", sync, request.maxBatchSize);
+    });
+    
+    addMethod(GET_DUMPS_BLOCKS_BY_NUMBER, MAX_BATCH_DUMPS, [this](const MethodRequest &request) {
+        return getBlockDumps<size_t>(request.doc, request.requestId, "numbers", sync, request.maxBatchSize);
+    });
+    
+    addMethod(GET_LAST_TXS, 0, [this](const MethodRequest &request) {
+        return transactionsToJson(request.requestId, sync.getLastTxs(), sync.getBlockchain(), request.isFormat, request.version);
+    });
+    
+    addMethod(GET_TRANSACTION_INFO, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+
+        const std::vector<unsigned char> &hash0 = fromHex(get<std::string>(jsonParams, "hash"));
+        const std::string hash(hash0.begin(), hash0.end());
+        
+        const std::optional<TransactionInfo> res = sync.getTransaction(hash);
+        
+        if (!res.has_value()) {
+            return genTransactionNotFoundResponse(request.requestId, hash);
+        } else {
+            return transactionToJson(request.requestId, res.value(), sync.getBlockchain(), sync.getBlockchain().countBlocks(), sync.getKnownBlock(), request.isFormat, request.version);
+        }
+    });
+    
+    addMethod(GET_TOKEN_INFO, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const Address &address = Address(get<std::string>(jsonParams, "address"));
+        
+        const Token res = sync.getTokenInfo(address);
+        return tokenToJson(request.requestId, res, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_TRANSACTIONS_INFO, MAX_BATCH_TXS, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const auto &hashesJson = get<JsonArray>(jsonParams, "hashes");
+        CHECK_USER(hashesJson.Size() <= request.maxBatchSize, "Too many transactions. Please, decrease count transactions");
+        std::vector<std::string> hashes;
+        for (const auto &hashJson: hashesJson) {
+            const auto &hash0 = fromHex(get<std::string>(hashJson));
+            hashes.emplace_back(hash0.begin(), hash0.end());
+        }
+        
+        std::vector<TransactionInfo> txsResult;
+        for (const std::optional<TransactionInfo> &res: sync.getTransactions(hashes)) {
+            if (res.has_value()) {
+                txsResult.emplace_back(res.value());
+            }
+        }
+        return transactionsToJson(request.requestId, txsResult, sync.getBlockchain(), request.isFormat, request.version);
+    });
+    
+    addMethod(GET_COUNT_BLOCKS, 0, [this](const MethodRequest &request) {
+        bool forP2P = false;
+        if (request.doc.HasMember("params") && request.doc["params"].IsObject()) {
+            const auto &jsonParams = get<JsonObject>(request.doc, "params");
+            forP2P = getOpt<std::string>(jsonParams, "type", "") == "forP2P";
+        }
+        
+        const size_t countBlocks = sync.getBlockchain().countBlocks();
+        
+        if (!forP2P) {
+            return genCountBlockJson(request.requestId, countBlocks, request.isFormat, request.version);
+        } else {
+            const BlockHeader header = sync.getBlockchain().getBlock(countBlocks);
+            const std::vector<MinimumSignBlockHeader> signatures = sync.getSignaturesBetween(header.hash, std::nullopt);
+            CHECK(signatures.size() <= 10, "Too many signatures");
+            std::vector<std::vector<unsigned char>> signHashes;
+            signHashes.reserve(signatures.size());
+            std::transform(signatures.begin(), signatures.end(), std::back_inserter(signHashes), std::mem_fn(&MinimumSignBlockHeader::hash));
+            
+            return genCountBlockForP2PJson(request.requestId, countBlocks, signHashes, request.isFormat, request.version);
+        }
+    });
+    
+    addMethod(PRE_LOAD_BLOCKS, MAX_PRELOAD_BLOCKS, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const size_t currentBlock = get<int>(jsonParams, "currentBlock");
+        const bool isCompress = get<bool>(jsonParams, "compress");
+        const bool isSign = get<bool>(jsonParams, "isSign");
+        const size_t preLoadBlocks = get<int>(jsonParams, "preLoad");
+        const size_t maxBlockSize = get<int>(jsonParams, "maxBlockSize");
+        
+        CHECK(preLoadBlocks <= request.maxBatchSize, "Incorrect preload parameter");
+        
+        const size_t countBlocks = sync.getBlockchain().countBlocks();
+        
+        std::vector<BlockHeader> bhs;
+        std::vector<std::string> blocks;
+        if (countBlocks <= currentBlock + preLoadBlocks + MAX_PRELOAD_BLOCKS / 2) {
+            for (size_t i = currentBlock + 1; i < std::min(currentBlock + 1 + preLoadBlocks, countBlocks + 1); i++) {
+                const BlockHeader &bh = sync.getBlockchain().getBlock(i);
+                CHECK(bh.blockNumber.has_value(), "block " + to_string(i) + " not found");
+                if (bh.blockSize > maxBlockSize) {
+                    break;
+                }
+                
+                bhs.emplace_back(bh);
+                blocks.emplace_back(sync.getBlockDump(bh.hash, bh.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
+            }
+        }
+        
+        std::vector<std::vector<std::vector<unsigned char>>> blockSignaturesHashes;
+        if (!bhs.empty()) {
+            const std::vector<std::vector<MinimumSignBlockHeader>> blockSignatures = getBlocksSignaturesFull(sync, bhs);
+            blockSignaturesHashes = blockSignaturesConvert(blockSignatures);
+            
+            for (const auto &elements: blockSignatures) {
+                for (const MinimumSignBlockHeader &element: elements) {
+                    blocks.emplace_back(sync.getBlockDump(element.hash, element.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
+                }
+            }
+        } else {
+            if (countBlocks == currentBlock) {
+                const BlockHeader &b = sync.getBlockchain().getBlock(countBlocks);
+                const std::vector<MinimumSignBlockHeader> signatures = sync.getSignaturesBetween(b.hash, std::nullopt);
+                for (const MinimumSignBlockHeader &element: signatures) {
+                    blocks.emplace_back(sync.getBlockDump(element.hash, element.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
+                }
+                
+                blockSignaturesHashes = blockSignaturesConvert({signatures});
+            }
+        }
+        
+        return preLoadBlocksJson(request.requestId, countBlocks, bhs, blockSignaturesHashes, blocks, isCompress, request.version);
+    });
+    
+    addMethod(GET_ADDRESS_DELEGATIONS, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const Address address(get<std::string>(jsonParams, "address"));
+        
+        const auto result = sync.getDelegateStates(address);
+        
+        return delegateStatesToJson(request.requestId, address.calcHexString(), result, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_CONTRACT_DETAILS, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const Address address(get<std::string>(jsonParams, "address"));
+        const std::string path = getOpt<std::string>(jsonParams, "path", "");
+        
+        const auto result = sync.getContractDetails(address);
+        
+        return genV8DetailsJson(request.requestId, address.calcHexString(), result, path, request.isFormat);
+    });
+    
+    addMethod(GET_CONTRACT_CODE, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const Address address(get<std::string>(jsonParams, "address"));
+        
+        const auto result = sync.getContractCode(address);
+        
+        return genV8CodeJson(request.requestId, address.calcHexString(), result, request.isFormat);
+    });
+    
+    addMethod(GET_COMMON_BALANCE, 0, [this](const MethodRequest &request) {
+        const auto result = sync.getCommonBalance();
+        return genCommonBalanceJson(request.requestId, result, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_FORGING_SUM, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const int blockIndent = get<int>(jsonParams, "block_indent");
+        const ForgingSums forgingSum = sync.getForgingSumForLastBlock(blockIndent);
+        return genForgingSumJson(request.requestId, forgingSum, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_FORGING_SUM_ALL, 0, [this](const MethodRequest &request) {
+        const ForgingSums forgingSum = sync.getForgingSumAll();
+        return genForgingSumJson(request.requestId, forgingSum, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_LAST_NODE_STAT_RESULT, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        
+        const auto result = sync.getLastNodeTestResult(addressString);
+        
+        return genNodeStatResultJson(request.requestId, addressString, result.first, result.second, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_LAST_NODE_STAT_TRUST, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        
+        const auto result = sync.getLastNodeTestTrust(addressString);
+        
+        return genNodeStatTrustJson(request.requestId, addressString, result.first, result.second, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_LAST_NODE_STAT_COUNT, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+
+        const auto result = sync.getLastDayNodeTestCount(addressString);
+
+        const size_t lastBlockDay = sync.getLastBlockDay();
+        return genNodeStatCountJson(request.requestId, addressString, lastBlockDay, result, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_ALL_LAST_NODES_RESULT, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const size_t &countTests = get<int>(jsonParams, "count_tests");
+        
+        const auto result = sync.filterLastNodes(countTests);
+        
+        const size_t lastBlockDay = sync.getLastBlockDay();
+        return genAllNodesStatsCountJson(request.requestId, lastBlockDay, result, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_NODE_RAITING, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const size_t countTests = getOpt<int>(jsonParams, "count_tests", 10);
+        const std::string &addressString = get<std::string>(jsonParams, "address");
+        
+        const auto result = sync.calcNodeRaiting(addressString, countTests);
+        const size_t lastBlockDay = sync.getLastBlockDay();
+        return genNodesRaitingJson(request.requestId, addressString, result.first, result.second, lastBlockDay, request.isFormat, request.version);
+    });
+    
+    addMethod(GET_RANDOM_ADDRESSES, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+        
+        const size_t countAddresses = get<size_t>(jsonParams, "count_addresses");
+        
+        const auto result = sync.getRandomAddresses(countAddresses);
+        
+        return genRandomAddressesJson(request.requestId, result, request.isFormat);
+    });
+    
+    addMethod(GET_REJECTED_TX_INFO, 0, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+
+        const std::string hash = get<std::string>(jsonParams, "hash");
+
+        const auto result = sync.findRejectedTx(fromHex(hash));
+
+        return genRejectedTxHistoryJson(request.requestId, result, request.isFormat);
+    });
+    
+    addMethod(GET_REJECTED_BLOCKS, MAX_REJECTED_BLOCKS, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+
+        const size_t count = get<size_t>(jsonParams, "count");
+
+        CHECK_USER(count <= request.maxBatchSize, "Incorrect count value");
+
+        const auto result = sync.calcLastRejectedBlocks(count);
+
+        return genRejectedBlocksInfo(result);
+    });
+    
+    addMethod(GET_REJECTED_DUMPS, MAX_REJECTED_BLOCKS, [this](const MethodRequest &request) {
+        const auto &jsonParams = get<JsonObject>(request.doc, "params");
+
+        const bool isCompress = get<bool>(jsonParams, "isCompress");
+        const auto &hashesJson = get<JsonArray>(jsonParams, "hashes");
+        std::vector<std::vector<unsigned char>> hashes;
+        std::transform(hashesJson.Begin(), hashesJson.End(), std::back_inserter(hashes), [](const auto &hashJson) {
+            return fromHex(get<std::string>(hashJson));
+        });
+
+        CHECK_USER(hashes.size() <= request.maxBatchSize, "Incorrect count value");
+
+        const auto result = sync.getRejectedDumps(hashes);
+
+        return genDumpBlocksBinary(result, isCompress);
+    });
+}
+
 bool Server::run(int thread_number, Request& mhd_req, Response& mhd_resp) {
     mhd_resp.headers["Access-Control-Allow-Origin"] = "*";
     //mhd_resp.headers["Connection"] = "close";
@@ -425,10 +901,12 @@ bool Server::run(int thread_number, Request& mhd_req, Response& mhd_resp) {
     RequestId requestId;
     
     Timer tt;
+    const time_point startTime = ::now();
     
     smallRequestStatistics.addStatistic(1, ::now(), 1min);
         
     std::string func;
+    const MethodInfo *methodInfo = nullptr;
     try {
         std::string jsonRequest;
         
@@ -479,343 +957,15 @@ bool Server::run(int thread_number, Request& mhd_req, Response& mhd_resp) {
             isFormatJson = doc["pretty"].GetBool();
         }
         
-        std::string response;
+        const auto found = methods.find(HashedString(func));
+        CHECK_USER(found != methods.end(), "Incorrect func " + func);
+        methodInfo = &found->second;
         
-        if (func == "status") {
-            response = genStatusResponse(requestId, VERSION, g_GIT_SHA1);
-        } else if (func == "getinfo") {
-            response = genInfoResponse(requestId, VERSION, SERVER_TYPE, serverPrivKey);
-        } else if (func == "get-statistic") {
-            const SmallStatisticElement smallStat = smallRequestStatistics.getStatistic();
-            response = genStatisticResponse(smallStat.stat);
-        } else if (func == "get-statistic2") {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &pubkey = get<std::string>(jsonParams, "pubkey");
-            const std::string &sign = get<std::string>(jsonParams, "sign");
-            const std::string &timestamp = get<std::string>(jsonParams, "timestamp");
-            const long long timestampLong = std::stoll(timestamp);
-            
-            const auto now = nowSystem();
-            const long long nowTimestamp = getTimestampMs(now);
-            CHECK_USER(std::abs(nowTimestamp - timestampLong) <= milliseconds(5s).count(), "Timestamp is out");
-            
-            CHECK_USER(sync.verifyTechnicalAddressSign(timestamp, fromHex(sign), fromHex(pubkey)), "Incorrect signature");
-            
-            const SmallStatisticElement smallStat = smallRequestStatistics.getStatistic();
-            response = genStatisticResponse(requestId, smallStat.stat, getProcLoad(), getTotalSystemMemory(), getOpenedConnections());
-        } else if (func == GET_ADDRESS_HISTORY) {            
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            const Address address(addressString);
-            
-            const size_t countTxs = getOpt<int>(jsonParams, "countTxs", 0);
-            const size_t beginTx = getOpt<int>(jsonParams, "beginTx", 0);
-            
-            const std::vector<TransactionInfo> txs = sync.getTxsForAddress(address, beginTx, countTxs, MAX_HISTORY_SIZE);
-            CHECK(txs.size() <= MAX_HISTORY_SIZE, "Incorrect result size");
-            
-            response = addressesInfoToJson(requestId, addressString, txs, sync.getBlockchain(), 0, isFormatJson, jsonVersion);
-        } else if (func == GET_ADDRESS_HISTORY_FILTER) {            
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            const Address address(addressString);
-            
-            const size_t countTxs = getOpt<int>(jsonParams, "countTxs", 0);
-            size_t beginTx = getOpt<int>(jsonParams, "beginTx", 0);
-            
-            const TransactionsFilters filters = parseFilters(jsonParams["filters"]);
-            
-            const std::vector<TransactionInfo> txs = sync.getTxsForAddress(address, beginTx, countTxs, MAX_HISTORY_SIZE, filters);
-            CHECK(txs.size() <= MAX_HISTORY_SIZE, "Incorrect result size");
-            
-            response = addressesInfoToJsonFilter(requestId, addressString, txs, beginTx, sync.getBlockchain(), 0, isFormatJson, jsonVersion);
-        } else if (func == GET_ADDRESS_BALANCE) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            const Address address(addressString);
-            
-            const BalanceInfo balance = sync.getBalance(address);
-            
-            response = balanceInfoToJson(requestId, addressString, balance, sync.getBlockchain().countBlocks(), isFormatJson, jsonVersion);
-        } else if (func == GET_ADDRESS_TOKENS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            const Address address(addressString);
-            
-            const BalanceInfo balance = sync.getBalance(address);
-            
-            response = balanceTokenInfoToJson(requestId, addressString, balance, sync.getBlockchain().countBlocks(), isFormatJson, jsonVersion);
-        } else if (func == GET_ADDRESS_BALANCES) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const auto &addressesJson = get<JsonArray>(jsonParams, "addresses");
-            
-            std::vector<std::pair<std::string, BalanceInfo>> balances;
-            CHECK_USER(addressesJson.Size() <= MAX_BATCH_BALANCES, "Too many transactions. Please, decrease count addresses");
-            for (const auto &addressJson: addressesJson) {
-                const std::string addressString = get<std::string>(addressJson);
-                const Address address(addressString);
-                const BalanceInfo balance = sync.getBalance(address);
-                balances.emplace_back(addressString, balance);
-            }
-            
-            response = balancesInfoToJson(requestId, balances, sync.getBlockchain().countBlocks(), isFormatJson, jsonVersion);
-        } else if (func == GET_BLOCK_BY_HASH) {
-            response = getBlock<std::string>(requestId, doc, "hash", sync, isFormatJson, jsonVersion);
-        } else if (func == GET_BLOCK_BY_NUMBER) {
-            response = getBlock<size_t>(requestId, doc, "number", sync, isFormatJson, jsonVersion);
-        } else if (func == GET_BLOCKS) {
-            response = getBlocks(requestId, doc, sync, isFormatJson, jsonVersion);
-        } else if (func == GET_DUMP_BLOCK_BY_HASH) {
-            response = getBlockDump<std::string>(doc, requestId, "hash", sync, isFormatJson);
-        } else if (func == GET_DUMP_BLOCK_BY_NUMBER) {
-            response = getBlockDump<size_t>(doc, requestId, "number", sync, isFormatJson);
-        } else if (func == GET_DUMPS_BLOCKS_BY_HASH) {
-            response = getBlockDumps<std::string>(doc, requestId, "hashes", sync);
-        } else if (func == GET_DUMPS_BLOCKS_BY_NUMBER) {
-            response = getBlockDumps<size_t>(doc, requestId, "numbers", sync);
-        } else if (func == GET_LAST_TXS) {
-            response = transactionsToJson(requestId, sync.getLastTxs(), sync.getBlockchain(), isFormatJson, jsonVersion);
-        } else if (func == GET_TRANSACTION_INFO) {           
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-
-            const std::vector<unsigned char> &hash0 = fromHex(get<std::string>(jsonParams, "hash"));
-            const std::string hash(hash0.begin(), hash0.end());
-            
-            const std::optional<TransactionInfo> res = sync.getTransaction(hash);
-            
-            if (!res.has_value()) {
-                response = genTransactionNotFoundResponse(requestId, hash);
-            } else {
-                response = transactionToJson(requestId, res.value(), sync.getBlockchain(), sync.getBlockchain().countBlocks(), sync.getKnownBlock(), isFormatJson, jsonVersion);
-            }
-        } else if (func == GET_TOKEN_INFO) {           
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const Address &address = Address(get<std::string>(jsonParams, "address"));
-            
-            const Token res = sync.getTokenInfo(address);
-            response = tokenToJson(requestId, res, isFormatJson, jsonVersion);
-        } else if (func == GET_TRANSACTIONS_INFO) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const auto &hashesJson = get<JsonArray>(jsonParams, "hashes");
-            CHECK_USER(hashesJson.Size() <= MAX_BATCH_TXS, "Too many transactions. Please, decrease count transactions");
-            std::vector<TransactionInfo> txsResult;
-            for (const auto &hashJson: hashesJson) {
-                const auto &hash0 = fromHex(get<std::string>(hashJson));
-                const std::string hash(hash0.begin(), hash0.end());
-                
-                const std::optional<TransactionInfo> res = sync.getTransaction(hash);
-                
-                if (res.has_value()) {
-                    txsResult.emplace_back(res.value());
-                }
-            }
-            response = transactionsToJson(requestId, txsResult, sync.getBlockchain(), isFormatJson, jsonVersion);
-        } else if (func == GET_COUNT_BLOCKS) {
-            bool forP2P = false;
-            if (doc.HasMember("params") && doc["params"].IsObject()) {
-                const auto &jsonParams = get<JsonObject>(doc, "params");
-                forP2P = getOpt<std::string>(jsonParams, "type", "") == "forP2P";
-            }
-            
-            const size_t countBlocks = sync.getBlockchain().countBlocks();
-            
-            if (!forP2P) {
-                response = genCountBlockJson(requestId, countBlocks, isFormatJson, jsonVersion);
-            } else {
-                const BlockHeader header = sync.getBlockchain().getBlock(countBlocks);
-                const std::vector<MinimumSignBlockHeader> signatures = sync.getSignaturesBetween(header.hash, std::nullopt);
-                CHECK(signatures.size() <= 10, "Too many signatures");
-                std::vector<std::vector<unsigned char>> signHashes;
-                signHashes.reserve(signatures.size());
-                std::transform(signatures.begin(), signatures.end(), std::back_inserter(signHashes), std::mem_fn(&MinimumSignBlockHeader::hash));
-                
-                response = genCountBlockForP2PJson(requestId, countBlocks, signHashes, isFormatJson, jsonVersion);
-            }
-        } else if (func == PRE_LOAD_BLOCKS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const size_t currentBlock = get<int>(jsonParams, "currentBlock");
-            const bool isCompress = get<bool>(jsonParams, "compress");
-            const bool isSign = get<bool>(jsonParams, "isSign");
-            const size_t preLoadBlocks = get<int>(jsonParams, "preLoad");
-            const size_t maxBlockSize = get<int>(jsonParams, "maxBlockSize");
-            
-            CHECK(preLoadBlocks <= MAX_PRELOAD_BLOCKS, "Incorrect preload parameter");
-            
-            const size_t countBlocks = sync.getBlockchain().countBlocks();
-            
-            std::vector<BlockHeader> bhs;
-            std::vector<std::string> blocks;
-            if (countBlocks <= currentBlock + preLoadBlocks + MAX_PRELOAD_BLOCKS / 2) {
-                for (size_t i = currentBlock + 1; i < std::min(currentBlock + 1 + preLoadBlocks, countBlocks + 1); i++) {
-                    const BlockHeader &bh = sync.getBlockchain().getBlock(i);
-                    CHECK(bh.blockNumber.has_value(), "block " + to_string(i) + " not found");
-                    if (bh.blockSize > maxBlockSize) {
-                        break;
-                    }
-                    
-                    bhs.emplace_back(bh);
-                    blocks.emplace_back(sync.getBlockDump(bh.hash, bh.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
-                }
-            }
-            
-            std::vector<std::vector<std::vector<unsigned char>>> blockSignaturesHashes;
-            if (!bhs.empty()) {
-                const std::vector<std::vector<MinimumSignBlockHeader>> blockSignatures = getBlocksSignaturesFull(sync, bhs);
-                blockSignaturesHashes = blockSignaturesConvert(blockSignatures);
-                
-                for (const auto &elements: blockSignatures) {
-                    for (const MinimumSignBlockHeader &element: elements) {
-                        blocks.emplace_back(sync.getBlockDump(element.hash, element.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
-                    }
-                }
-            } else {
-                if (countBlocks == currentBlock) {
-                    const BlockHeader &b = sync.getBlockchain().getBlock(countBlocks);
-                    const std::vector<MinimumSignBlockHeader> signatures = sync.getSignaturesBetween(b.hash, std::nullopt);
-                    for (const MinimumSignBlockHeader &element: signatures) {
-                        blocks.emplace_back(sync.getBlockDump(element.hash, element.filePos, 0, std::numeric_limits<size_t>::max(), false, isSign));
-                    }
-                    
-                    blockSignaturesHashes = blockSignaturesConvert({signatures});
-                }
-            }
-            
-            response = preLoadBlocksJson(requestId, countBlocks, bhs, blockSignaturesHashes, blocks, isCompress, jsonVersion);
-        } else if (func == GET_ADDRESS_DELEGATIONS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const Address address(get<std::string>(jsonParams, "address"));
-            
-            const auto result = sync.getDelegateStates(address);
-            
-            response = delegateStatesToJson(requestId, address.calcHexString(), result, isFormatJson, jsonVersion);
-        } else if (func == GET_CONTRACT_DETAILS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const Address address(get<std::string>(jsonParams, "address"));
-            const std::string path = getOpt<std::string>(jsonParams, "path", "");
-            
-            const auto result = sync.getContractDetails(address);
-            
-            response = genV8DetailsJson(requestId, address.calcHexString(), result, path, isFormatJson);
-        } else if (func == GET_CONTRACT_CODE) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const Address address(get<std::string>(jsonParams, "address"));
-            
-            const auto result = sync.getContractCode(address);
-            
-            response = genV8CodeJson(requestId, address.calcHexString(), result, isFormatJson);
-        } else if (func == GET_COMMON_BALANCE) {
-            const auto result = sync.getCommonBalance();
-            response = genCommonBalanceJson(requestId, result, isFormatJson, jsonVersion);
-        } else if (func == GET_FORGING_SUM) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const int blockIndent = get<int>(jsonParams, "block_indent");
-            const ForgingSums forgingSum = sync.getForgingSumForLastBlock(blockIndent);
-            response = genForgingSumJson(requestId, forgingSum, isFormatJson, jsonVersion);
-        } else if (func == GET_FORGING_SUM_ALL) {
-            const ForgingSums forgingSum = sync.getForgingSumAll();
-            response = genForgingSumJson(requestId, forgingSum, isFormatJson, jsonVersion);
-        } else if (func == GET_LAST_NODE_STAT_RESULT) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            
-            const auto result = sync.getLastNodeTestResult(addressString);
-            
-            response = genNodeStatResultJson(requestId, addressString, result.first, result.second, isFormatJson, jsonVersion);
-        } else if (func == GET_LAST_NODE_STAT_TRUST) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            
-            const auto result = sync.getLastNodeTestTrust(addressString);
-            
-            response = genNodeStatTrustJson(requestId, addressString, result.first, result.second, isFormatJson, jsonVersion);
-        } else if (func == GET_LAST_NODE_STAT_COUNT) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-
-            const auto result = sync.getLastDayNodeTestCount(addressString);
-
-            const size_t lastBlockDay = sync.getLastBlockDay();
-            response = genNodeStatCountJson(requestId, addressString, lastBlockDay, result, isFormatJson, jsonVersion);
-        } else if (func == GET_ALL_LAST_NODES_RESULT) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const size_t &countTests = get<int>(jsonParams, "count_tests");
-            
-            const auto result = sync.filterLastNodes(countTests);
-            
-            const size_t lastBlockDay = sync.getLastBlockDay();
-            response = genAllNodesStatsCountJson(requestId, lastBlockDay, result, isFormatJson, jsonVersion);
-        } else if (func == GET_NODE_RAITING) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const size_t countTests = getOpt<int>(jsonParams, "count_tests", 10);
-            const std::string &addressString = get<std::string>(jsonParams, "address");
-            
-            const auto result = sync.calcNodeRaiting(addressString, countTests);
-            const size_t lastBlockDay = sync.getLastBlockDay();
-            response = genNodesRaitingJson(requestId, addressString, result.first, result.second, lastBlockDay, isFormatJson, jsonVersion);
-        } else if (func == GET_RANDOM_ADDRESSES) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-            
-            const size_t countAddresses = get<size_t>(jsonParams, "count_addresses");
-            
-            const auto result = sync.getRandomAddresses(countAddresses);
-            
-            response = genRandomAddressesJson(requestId, result, isFormatJson);
-        } else if (func == GET_REJECTED_TX_INFO) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-
-            const std::string hash = get<std::string>(jsonParams, "hash");
-
-            const auto result = sync.findRejectedTx(fromHex(hash));
-
-            response = genRejectedTxHistoryJson(requestId, result, isFormatJson);
-        } else if (func == GET_REJECTED_BLOCKS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-
-            const size_t count = get<size_t>(jsonParams, "count");
-
-            CHECK_USER(count <= MAX_REJECTED_BLOCKS, "Incorrect count value");
-
-            const auto result = sync.calcLastRejectedBlocks(count);
-
-            response = genRejectedBlocksInfo(result);
-        } else if (func == GET_REJECTED_DUMPS) {
-            const auto &jsonParams = get<JsonObject>(doc, "params");
-
-            const bool isCompress = get<bool>(jsonParams, "isCompress");
-            const auto &hashesJson = get<JsonArray>(jsonParams, "hashes");
-            std::vector<std::vector<unsigned char>> hashes;
-            std::transform(hashesJson.Begin(), hashesJson.End(), std::back_inserter(hashes), [](const auto &hashJson) {
-                return fromHex(get<std::string>(hashJson));
-            });
-
-            CHECK_USER(hashes.size() <= MAX_REJECTED_BLOCKS, "Incorrect count value");
-
-            const auto result = sync.getRejectedDumps(hashes);
-
-            response = genDumpBlocksBinary(result, isCompress);
-        } else {
-            throwUserErr("Incorrect func " + func);
+        const MethodRequest request{requestId, doc, isFormatJson, jsonVersion, methodInfo->maxBatchSize};
+        mhd_resp.data = methodInfo->handler(request);
+        if (!methodInfo->contentType.empty()) {
+            mhd_resp.headers["Content-Type"] = methodInfo->contentType;
         }
-        
-        mhd_resp.data = response;
         mhd_resp.code = HTTP_STATUS_OK;
     } catch (const exception &e) {
         LOGERR << e;
@@ -835,6 +985,18 @@ bool Server::run(int thread_number, Request& mhd_req, Response& mhd_resp) {
         mhd_resp.code = HTTP_STATUS_INTERNAL_SERVER_ERROR;
     }
     
+    if (methodInfo != nullptr) {
+        const MethodMetrics &metrics = methodInfo->metrics;
+        metrics.countRequests->inc();
+        if (mhd_resp.code != HTTP_STATUS_OK) {
+            metrics.countErrors->inc();
+        }
+        metrics.latencyUs->observe(std::chrono::duration_cast<std::chrono::microseconds>(::now() - startTime).count());
+        metrics.responseSize->observe(mhd_resp.data.size());
+    } else {
+        countUnknownRequests->inc();
+    }
+    
     if (tt.countMs() > 2000 || mhd_resp.data.size() >= 800 * 1024 * 1024) {
         LOGINFO << "Long request time: " << tt.countMs() << ". Count threads: " << countRunningThreads.load() << ". Response size: " << mhd_resp.data.size() << ". Request: " << url << " " << mhd_req.post;
     }
@@ -3,11 +3,20 @@
 
 #include <string>
 #include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include <rapidjson/fwd.h>
+
+#include "HashedString.h"
 
 #include "utils/SmallStatistic.h"
+#include "generate_json.h"
 
 namespace torrent_node_lib {
 class Sync;
+class MetricCounter;
+class MetricHistogram;
 }
 
 #ifdef UBUNTU14
@@ -19,6 +28,39 @@ using MHD = sniper::mhd::MHD;
 #endif
 
 class Server: public MHD {
+public:
+    
+    struct MethodRequest {
+        const RequestId &requestId;
+        const rapidjson::Document &doc;
+        bool isFormat;
+        JsonVersion version;
+        size_t maxBatchSize;
+    };
+    
+    using MethodHandler = std::function<std::string(const MethodRequest &request)>;
+    
+    struct MethodMetrics {
+        torrent_node_lib::MetricCounter *countRequests;
+        torrent_node_lib::MetricCounter *countErrors;
+        torrent_node_lib::MetricHistogram *latencyUs;
+        torrent_node_lib::MetricHistogram *responseSize;
+    };
+    
+    struct MethodInfo {
+        MethodHandler handler;
+        /**
+         *c Максимальный размер пачки элементов в одном запросе. 0 - метод не пакетный
+         */
+        size_t maxBatchSize;
+        
+        MethodMetrics metrics;
+        /**
+         *c Если не пусто, ответ не json
+         */
+        std::string contentType;
+    };
+    
 public:
     
     Server(const torrent_node_lib::Sync &sync, int port, std::atomic<int> &countRunningThreads, const std::string &serverPrivKey) 
@@ -27,7 +69,9 @@ public:
         , serverPrivKey(serverPrivKey)
         , countRunningThreads(countRunningThreads)
         , isStoped(false)
-    {}
+    {
+        registerMethods();
+    }
     
     ~Server() override {}
     
@@ -35,6 +79,12 @@ public:
     
     bool init() override;
     
+private:
+    
+    void registerMethods();
+    
+    MethodInfo& addMethod(const std::string &name, size_t maxBatchSize, const MethodHandler &handler);
+    
 private:
     
     const torrent_node_lib::Sync &sync;
@@ -48,6 +98,10 @@ private:
     std::atomic<bool> isStoped;
         
     SmallStatistic smallRequestStatistics;
+    
+    std::unordered_map<common::HashedString, MethodInfo> methods;
+    
+    torrent_node_lib::MetricCounter *countUnknownRequests;
 };
 
 #endif // SERVER_H_
@@ -1,9 +1,12 @@
 #include "SyncImpl.h"
 
 #include "BlockchainRead.h"
+#include "BlocksSnapshot.h"
 #include "PrivateKey.h"
 
 #include "parallel_for.h"
+#include "BlockedQueue.h"
+#include "Thread.h"
 #include "stopProgram.h"
 #include "duration.h"
 #include "check.h"
@@ -28,6 +31,7 @@
 #include "blockchain_structs/SignBlock.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
 #include "blockchain_structs/BlocksMetadata.h"
+#include "blockchain_structs/FilePosition.h"
 #include "blockchain_structs/DelegateState.h"
 
 #include "RejectedBlockSource/FileRejectedBlockSource/FileRejectedBlockSource.h"
@@ -42,20 +46,27 @@ using namespace common;
 
 namespace torrent_node_lib {
     
-const static std::string VERSION_DB = "v4.5";
+const static std::string VERSION_DB = "v4.6";
+const static std::string VERSION_DB_WITHOUT_ADDRESS_FLAGS = "v4.5";
     
 bool isInitialized = false;
 
 SyncImpl::SyncImpl(const std::string& folderBlocks, const std::string &technicalAddress, const LevelDbOptions& leveldbOpt, const CachesOptions& cachesOpt, const GetterBlockOptions &getterBlocksOpt, const std::string &signKeyName, const TestNodesOptions &testNodesOpt, bool validateStates)
     : leveldb(leveldbOpt.writeBufSizeMb, leveldbOpt.isBloomFilter, leveldbOpt.isChecks, leveldbOpt.folderName, leveldbOpt.lruCacheMb)
     , folderBlocks(folderBlocks)
+    , snapshotFileName(leveldbOpt.folderName + ".snapshot")
+    , fileNames(getFileNamesDictionary())
     , technicalAddress(technicalAddress)
-    , caches(cachesOpt.maxCountElementsBlockCache, cachesOpt.maxCountElementsTxsCache, cachesOpt.macLocalCacheElements)
+    , caches(cachesOpt.blockCacheMb * 1024 * 1024, cachesOpt.txsCacheMb * 1024 * 1024, cachesOpt.txsStatusCacheMb * 1024 * 1024, cachesOpt.balancesCacheMb * 1024 * 1024, cachesOpt.macLocalCacheElements)
     , isValidate(getterBlocksOpt.isValidate)
     , validateStates(validateStates)
     , testNodes(getterBlocksOpt.p2p, testNodesOpt.myIp, testNodesOpt.testNodesServer, testNodesOpt.defaultPortTorrent)
     , p2pAll(getterBlocksOpt.p2pAll)
 {
+    setBlockFilesOpt(BlockFilesOptions());
+    
+    fileNames.initialize(leveldb.findAllFileNames());
+    
     if (getterBlocksOpt.isValidate) {
         CHECK(!getterBlocksOpt.getBlocksFromFile, "validate and get_blocks_from_file options not compatible");
     }
@@ -69,8 +80,10 @@ SyncImpl::SyncImpl(const std::string& folderBlocks, const std::string &technical
     } else {
         CHECK(getterBlocksOpt.p2p != nullptr, "p2p nullptr");
         CHECK(getterBlocksOpt.p2p2 != nullptr, "p2p nullptr");
+        getterBlocksOpt.p2p->setSegmentOptions(getterBlocksOpt.segmentOptions);
+        getterBlocksOpt.p2p2->setSegmentOptions(getterBlocksOpt.segmentOptions);
         isSaveBlockToFiles = modules[MODULE_BLOCK_RAW];
-        getBlockAlgorithm = std::make_unique<NetworkBlockSource>(timeline, folderBlocks, getterBlocksOpt.maxAdvancedLoadBlocks, getterBlocksOpt.countBlocksInBatch, getterBlocksOpt.isCompress, *getterBlocksOpt.p2p, true, getterBlocksOpt.isValidate, getterBlocksOpt.isValidateSign, getterBlocksOpt.isPreLoad);
+        getBlockAlgorithm = std::make_unique<NetworkBlockSource>(timeline, folderBlocks, getterBlocksOpt.initAdvancedLoadBlocks, getterBlocksOpt.advancedLoadMb * 1024 * 1024, getterBlocksOpt.countBlocksInBatch, getterBlocksOpt.isCompress, *getterBlocksOpt.p2p, true, getterBlocksOpt.isValidate, getterBlocksOpt.isValidateSign, getterBlocksOpt.isPreLoad);
         
         fileRejectedBlockSource = std::make_unique<FileRejectedBlockSource>(blockchain, folderBlocks);
         fileBlockAlgorithm = std::make_unique<FileBlockSource>(*fileRejectedBlockSource, leveldb, folderBlocks, isValidate);
@@ -94,12 +107,21 @@ void SyncImpl::setLeveldbOptScript(const LevelDbOptions &leveldbOpt) {
     this->leveldbOptScript = leveldbOpt;
 }
 
+void SyncImpl::setBlockFilesOpt(const BlockFilesOptions &blockFilesOpt) {
+    blocksAppender = std::make_unique<FileAppender>(blockFilesOpt.preallocateMb * 1024 * 1024, blockFilesOpt.syncPolicy);
+}
+
+void SyncImpl::setSnapshotPeriodBlocks(size_t snapshotPeriodBlocks) {
+    this->snapshotPeriodBlocks = snapshotPeriodBlocks;
+}
+
 void SyncImpl::setLeveldbOptNodeTest(const LevelDbOptions &leveldbOpt) {
     this->leveldbOptNodeTest = leveldbOpt;
 }
 
 SyncImpl::~SyncImpl() {
     try {
+        waitSnapshot();
         if (mainWorker != nullptr) {
             mainWorker->join();
         }
@@ -120,7 +142,7 @@ SyncImpl::~SyncImpl() {
     }
 }
 
-void SyncImpl::saveTransactions(BlockInfo& bi, const std::string &binaryDump, bool saveBlockToFile) {
+void SyncImpl::saveTransactions(BlockInfo& bi, const std::string &binaryDump, bool saveBlockToFile, const std::optional<size_t> &writtenPos) {
     if (!saveBlockToFile) {
         return;
     }
@@ -128,7 +150,13 @@ void SyncImpl::saveTransactions(BlockInfo& bi, const std::string &binaryDump, bo
     const std::string &fileName = bi.header.filePos.fileNameRelative;
     CHECK(!fileName.empty(), "File name not set");
     
-    const size_t currPos = saveBlockToFileBinary(getFullPath(fileName, folderBlocks), binaryDump);
+    size_t currPos;
+    if (writtenPos.has_value()) {
+        currPos = writtenPos.value();
+        blocksAppender->publishBlock(getFullPath(fileName, folderBlocks), currPos, binaryDump.size());
+    } else {
+        currPos = blocksAppender->appendBlock(getFullPath(fileName, folderBlocks), binaryDump);
+    }
     bi.header.filePos.pos = currPos;
     for (TransactionInfo &tx : bi.txs) {
         tx.filePos.fileNameRelative = fileName;
@@ -144,15 +172,65 @@ void SyncImpl::saveTransactionsSignBlock(SignBlockInfo &bi, const std::string &b
     const std::string &fileName = bi.header.filePos.fileNameRelative;
     CHECK(!fileName.empty(), "File name not set");
     
-    const size_t currPos = saveBlockToFileBinary(getFullPath(fileName, folderBlocks), binaryDump);
+    const size_t currPos = blocksAppender->appendBlock(getFullPath(fileName, folderBlocks), binaryDump);
     bi.header.filePos.pos = currPos;
 }
 
-void SyncImpl::saveBlockToLeveldb(const BlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement) {
+void SyncImpl::confirmBlock(BlockSource *gba, const FileInfo &fileInfo) {
+    notConfirmedBlocks.emplace_back(gba, fileInfo);
+    commitBlockFiles();
+}
+
+void SyncImpl::commitBlockFiles() {
+    if (blocksAppender->commit()) {
+        confirmSyncedBlocks();
+    }
+}
+
+void SyncImpl::syncBlockFiles() {
+    blocksAppender->sync();
+    confirmSyncedBlocks();
+}
+
+void SyncImpl::confirmSyncedBlocks() {
+    for (const auto &[gba, fileInfo]: notConfirmedBlocks) {
+        gba->confirmBlock(fileInfo);
+    }
+    notConfirmedBlocks.clear();
+}
+
+std::optional<size_t> SyncImpl::addFileId(FilePosition &filePos, Batch &batch) {
+    if (filePos.fileNameRelative.empty()) {
+        return std::nullopt;
+    }
+    const auto [id, isNotSaved] = fileNames.getOrAddId(filePos.fileNameRelative);
+    filePos.fileId = id;
+    if (!isNotSaved) {
+        return std::nullopt;
+    }
+    batch.addFileName(id, filePos.fileNameRelative);
+    return id;
+}
+
+void SyncImpl::saveBlockToLeveldb(BlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement) {
     Batch batch;
+    const std::optional<size_t> newFileId = addFileId(bi.header.filePos, batch);
+    for (TransactionInfo &tx: bi.txs) {
+        if (tx.filePos.fileNameRelative == bi.header.filePos.fileNameRelative) {
+            tx.filePos.fileId = bi.header.filePos.fileId;
+        }
+    }
+    
     if (modules[MODULE_BLOCK]) {
         batch.addBlockHeader(bi.header.hash, bi.header);
     }
+    if (modules[MODULE_BLOCK_RAW] && bi.txs.size() > BlockTxsOffsets::STEP) {
+        BlockTxsOffsets txsOffsets;
+        for (size_t i = 0; i < bi.txs.size(); i += BlockTxsOffsets::STEP) {
+            txsOffsets.offsets.emplace_back(bi.txs[i].filePos.pos - bi.header.filePos.pos);
+        }
+        batch.addBlockTxsOffsets(bi.header.hash, txsOffsets);
+    }
     
     const BlocksMetadata metadata = leveldb.findBlockMetadata();
     BlocksMetadata newMetadata;
@@ -171,10 +249,14 @@ void SyncImpl::saveBlockToLeveldb(const BlockInfo &bi, size_t timeLineKey, const
     batch.saveBlockTimeline(timeLineKey, timelineElement);
     
     addBatch(batch, leveldb);
+    if (newFileId.has_value()) {
+        fileNames.confirmSaved(newFileId.value());
+    }
 }
 
-void SyncImpl::saveSignBlockToLeveldb(const SignBlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement) {
+void SyncImpl::saveSignBlockToLeveldb(SignBlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement) {
     Batch batch;
+    const std::optional<size_t> newFileId = addFileId(bi.header.filePos, batch);
     if (modules[MODULE_BLOCK]) {
         batch.addSignBlockHeader(bi.header.hash, bi.header);
     }
@@ -182,9 +264,14 @@ void SyncImpl::saveSignBlockToLeveldb(const SignBlockInfo &bi, size_t timeLineKe
     batch.saveBlockTimeline(timeLineKey, timelineElement);
     
     addBatch(batch, leveldb);
+    if (newFileId.has_value()) {
+        fileNames.confirmSaved(newFileId.value());
+    }
 }
 
 void SyncImpl::initialize() {
+    waitSnapshot();
+    
     const std::string modulesStr = leveldb.findModules();
     if (!modulesStr.empty()) {
         const Modules oldModules(modulesStr);
@@ -194,7 +281,13 @@ void SyncImpl::initialize() {
     }
     
     const std::string versionDb = leveldb.findVersionDb();
-    if (!versionDb.empty()) {
+    if (versionDb == VERSION_DB_WITHOUT_ADDRESS_FLAGS) {
+        if (modules[MODULE_ADDR_TXS]) {
+            LOGINFO << "Start online migration of address history flags";
+            leveldb.startAddressFlagsMigration();
+        }
+        leveldb.saveVersionDb(VERSION_DB);
+    } else if (!versionDb.empty()) {
         CHECK(versionDb == VERSION_DB, "Version database not matches");
     } else {
         leveldb.saveVersionDb(VERSION_DB);
@@ -210,6 +303,12 @@ void SyncImpl::initialize() {
     
     blockchain.clear();
     
+    if (initializeFromSnapshot(metadata)) {
+        return;
+    }
+    blockchain.clear();
+    timeline.clear();
+    
     const std::set<std::string> blocksRaw = leveldb.getAllBlocks();
     for (const std::string &blockRaw: blocksRaw) {
         const BlockHeader bh = BlockHeader::deserialize(blockRaw);
@@ -224,13 +323,113 @@ void SyncImpl::initialize() {
     const std::vector<std::pair<size_t, std::string>> timeLinesSerialized = leveldb.findAllBlocksTimeline();
     timeline.deserialize(timeLinesSerialized);
     LOGINFO << "Timeline size " << timeline.size();
+    
+    if (blockchain.countBlocks() != 0) {
+        saveSnapshot();
+    }
+}
+
+bool SyncImpl::initializeFromSnapshot(const BlocksMetadata &metadata) {
+    if (snapshotPeriodBlocks == 0 || metadata.blockHash.empty()) {
+        return false;
+    }
+    const std::optional<BlocksSnapshot> snapshot = loadBlocksSnapshot(snapshotFileName);
+    if (!snapshot.has_value()) {
+        LOGINFO << "Snapshot not found";
+        return false;
+    }
+    
+    try {
+        Timer tt;
+        CHECK(!snapshot->timeline.empty(), "Empty snapshot timeline");
+        //c Последний элемент timeline снимка должен совпадать с базой, иначе снимок от другой базы
+        const std::vector<std::pair<size_t, std::string>> timelineFromDb = leveldb.findBlocksTimelineFrom(snapshot->timeline.back().first);
+        CHECK(!timelineFromDb.empty() && timelineFromDb.front() == snapshot->timeline.back(), "Snapshot not matches database");
+        
+        for (const std::string &blockRaw: snapshot->blocks) {
+            blockchain.addWithoutCalc(BlockHeader::deserialize(blockRaw));
+        }
+        timeline.deserialize(snapshot->timeline);
+        
+        const std::vector<BlocksTimeline::Hash> newBlocks = timeline.deserialize(std::vector<std::pair<size_t, std::string>>(std::next(timelineFromDb.begin()), timelineFromDb.end()));
+        for (const BlocksTimeline::Hash &hash: newBlocks) {
+            const std::optional<BlockHeader> bh = leveldb.findBlockHeader(hash);
+            CHECK(bh.has_value(), "Block " + toHex(hash) + " not found in database");
+            blockchain.addWithoutCalc(bh.value());
+        }
+        
+        const std::optional<size_t> countBlocks = blockchain.calcBlockchain(metadata.blockHash);
+        CHECK(countBlocks.has_value(), "Blockchain from snapshot not calculated");
+        CHECK(countBlocks.value() == snapshot->blocks.size() + newBlocks.size(), "Incorrect blockchain from snapshot");
+        
+        tt.stop();
+        LOGINFO << "Last block " << countBlocks.value() << " " << toHex(metadata.blockHash) << ". Loaded from snapshot " << snapshot->blocks.size() << " blocks, from database " << newBlocks.size() << " blocks. Time ms " << tt.countMs();
+        LOGINFO << "Timeline size " << timeline.size();
+        return true;
+    } catch (const exception &e) {
+        LOGWARN << "Snapshot not loaded: " << e;
+        return false;
+    } catch (const std::exception &e) {
+        LOGWARN << "Snapshot not loaded: " << e.what();
+        return false;
+    }
+}
+
+void SyncImpl::saveSnapshotImpl() const {
+    Timer tt;
+    const std::vector<std::pair<size_t, std::string>> timelineSerialized = timeline.serialize();
+    BlocksTimeline timelineCopy;
+    const std::vector<BlocksTimeline::Hash> simpleBlocks = timelineCopy.deserialize(timelineSerialized);
+    
+    //c В цепочку блок попадает раньше, чем в timeline, поэтому блоки, которых в timeline еще нет, отрезаем
+    std::vector<BlockHeader> blocks = blockchain.getAllBlocks();
+    CHECK(blocks.size() >= simpleBlocks.size(), "Blockchain changed while saving snapshot");
+    blocks.erase(std::next(blocks.begin(), simpleBlocks.size()), blocks.end());
+    CHECK(blocks.empty() || blocks.back().hash == simpleBlocks.back(), "Blockchain changed while saving snapshot");
+    
+    BlocksSnapshot snapshot;
+    snapshot.blocks.reserve(blocks.size());
+    for (const BlockHeader &bh: blocks) {
+        snapshot.blocks.emplace_back(bh.serialize());
+    }
+    snapshot.timeline = timelineSerialized;
+    saveBlocksSnapshot(snapshotFileName, snapshot);
+    tt.stop();
+    
+    LOGINFO << "Snapshot saved. Count blocks " << snapshot.blocks.size() << ". Time ms " << tt.countMs();
+}
+
+void SyncImpl::saveSnapshot() {
+    if (snapshotPeriodBlocks == 0) {
+        return;
+    }
+    if (snapshotFuture.valid() && snapshotFuture.wait_for(0ms) != std::future_status::ready) {
+        LOGINFO << "Previous snapshot not saved yet";
+        return;
+    }
+    //c Снимок собирается в отдельном потоке, чтобы не задерживать применение блоков
+    snapshotFuture = std::async(std::launch::async, [this]{
+        try {
+            saveSnapshotImpl();
+        } catch (const exception &e) {
+            LOGWARN << "Snapshot not saved: " << e;
+        } catch (const std::exception &e) {
+            LOGWARN << "Snapshot not saved: " << e.what();
+        }
+    });
+}
+
+void SyncImpl::waitSnapshot() {
+    if (snapshotFuture.valid()) {
+        snapshotFuture.wait();
+    }
 }
 
 std::vector<Worker*> SyncImpl::makeWorkers() {
     std::vector<Worker*> workers;
     cacheWorker = std::make_unique<WorkerCache>(caches);
     workers.emplace_back(cacheWorker.get());
-    mainWorker = std::make_unique<WorkerMain>(folderBlocks, leveldb, caches, blockchain, users, usersMut, countThreads, validateStates);
+    mainWorker = std::make_unique<WorkerMain>(folderBlocks, leveldb, fileNames, caches, blockchain, users, usersMut, countThreads, validateStates);
     workers.emplace_back(mainWorker.get());
     if (modules[MODULE_V8]) {
         CHECK(leveldbOptScript.isValid, "Leveldb script options not setted");
@@ -354,6 +553,18 @@ std::optional<ConflictBlocksInfo> SyncImpl::findCommonAncestor() {
     }
 }
 
+struct PipelineBlock {
+    std::shared_ptr<std::variant<std::monostate, BlockInfo, SignBlockInfo>> bi;
+    std::shared_ptr<std::string> dump;
+    std::exception_ptr exception;
+    bool isLast = false;
+    //c Позиция в файле, если блок уже записан вместе с предыдущим
+    std::optional<size_t> writtenPos;
+};
+
+//c Сколько блоков может быть скачано и распарсено наперед, пока предыдущие применяются
+const static size_t PIPELINE_QUEUE_SIZE = 3;
+
 std::optional<ConflictBlocksInfo> SyncImpl::process(const std::vector<Worker*> &workers) {
     bool isNoDefaultSource = false;
     BlockSource* gba;
@@ -377,85 +588,243 @@ std::optional<ConflictBlocksInfo> SyncImpl::process(const std::vector<Worker*> &
     
     selectGba();
     
+    //c Блоки, прочитанные из файла, но не обработанные из-за ошибки. Сетевой источник сам начинает с blockchain.countBlocks()
+    std::deque<PipelineBlock> leftBlocks;
+    
     while (true) {
         const time_point beginWhileTime = ::now();
         try {
             knownLastBlock = gba->doProcess(blockchain.countBlocks());
-            while (true) {
-                Timer tt;
-                
-                std::shared_ptr<std::variant<std::monostate, BlockInfo, SignBlockInfo>> nextBi = std::make_shared<std::variant<std::monostate, BlockInfo, SignBlockInfo>>();
-                               
-                std::shared_ptr<std::string> nextBlockDump = std::make_shared<std::string>();
-                const bool isContinue = gba->process(*nextBi, *nextBlockDump);
-                if (!isContinue) {
+            if (!isNoDefaultSource) {
+                leftBlocks.clear();
+            }
+            
+            //c Скачивание и парсинг следующих блоков идут в отдельном потоке, пока текущий блок сохраняется и применяется
+            BlockedQueue<PipelineBlock, PIPELINE_QUEUE_SIZE> pipeline;
+            //c Не больше реального числа блоков в очереди, поэтому pop при ненулевом значении не ждет
+            std::atomic<size_t> countInPipeline(0);
+            std::atomic<bool> isStopPipeline(false);
+            Thread producer([&pipeline, &countInPipeline, &isStopPipeline, gba]() {
+                while (true) {
+                    PipelineBlock block;
+                    try {
+                        block.bi = std::make_shared<std::variant<std::monostate, BlockInfo, SignBlockInfo>>();
+                        block.dump = std::make_shared<std::string>();
+                        block.isLast = !gba->process(*block.bi, *block.dump);
+                    } catch (...) {
+                        block.exception = std::current_exception();
+                        block.isLast = true;
+                    }
+                    const bool isLast = block.isLast;
+                    pipeline.push(std::move(block));
+                    countInPipeline++;
+                    if (isLast) {
+                        return;
+                    }
+                    if (isStopPipeline.load()) {
+                        PipelineBlock last;
+                        last.isLast = true;
+                        pipeline.push(std::move(last));
+                        countInPipeline++;
+                        return;
+                    }
+                }
+            });
+            bool isProducerFinished = false;
+            
+            //c Блоки, вынутые из очереди вместе с предыдущим. Блоки с writtenPos уже записаны в файл, но еще не открыты читателям
+            std::deque<PipelineBlock> takenBlocks;
+            
+            const auto stopPipeline = [&]() {
+                if (!takenBlocks.empty()) {
+                    takenBlocks.clear();
+                    blocksAppender->truncateNotPublished();
+                }
+                if (isProducerFinished) {
+                    return;
+                }
+                isStopPipeline = true;
+                while (true) {
+                    PipelineBlock block;
+                    if (!pipeline.pop(block) || block.isLast) {
+                        break;
+                    }
                     if (isNoDefaultSource) {
-                        LOGINFO << "Get blocks from default";
+                        leftBlocks.emplace_back(std::move(block));
                     }
-                    gba = getBlockAlgorithm.get();
-                    isNoDefaultSource = false;
-                    break;
                 }
-                
-                if (std::holds_alternative<BlockInfo>(*nextBi)) {
-                    BlockInfo &blockInfo = std::get<BlockInfo>(*nextBi);
-                    
-                    Timer tt2;
-                    
-                    saveTransactions(blockInfo, *nextBlockDump, isSaveBlockToFiles && !isNoDefaultSource);
-                    
-                    const std::optional<size_t> currentBlockNum = blockchain.addBlock(blockInfo.header);
-                    if (!currentBlockNum.has_value()) {
-                        LOGINFO << "Ya tuta " << toHex(blockInfo.header.hash) << " " << toHex(blockInfo.header.prevHash);
-                        const std::optional<ConflictBlocksInfo> conflictBlock = findCommonAncestor();
-                        if (!conflictBlock.has_value()) {
-                            throw exception("False alarm");
-                        } else {
-                            return conflictBlock;
-                        }
+                producer.join();
+                isProducerFinished = true;
+            };
+            
+            const auto popBlock = [&]() {
+                PipelineBlock block;
+                if (!pipeline.pop(block)) {
+                    checkStopSignal();
+                    throwErr("Pipeline stopped");
+                }
+                countInPipeline--;
+                if (block.isLast) {
+                    producer.join();
+                    isProducerFinished = true;
+                }
+                return block;
+            };
+            
+            //c Уже готовые блоки, продолжающие цепочку от последнего блока, пишутся в файл одним writev вместе с ним.
+            //c Берутся только блоки, которые точно добавятся в blockchain, иначе при повторном скачивании они записались бы в файл дважды
+            const auto writeReadyBlocks = [&](PipelineBlock &block) {
+                if (!isSaveBlockToFiles || isNoDefaultSource || block.isLast || !std::holds_alternative<BlockInfo>(*block.bi) || countInPipeline.load() == 0) {
+                    return;
+                }
+                const BlockHeader &firstHeader = std::get<BlockInfo>(*block.bi).header;
+                if (firstHeader.prevHash != blockchain.getLastBlock().hash) {
+                    return;
+                }
+                std::vector<PipelineBlock*> batch = {&block};
+                std::vector<unsigned char> lastHash = firstHeader.hash;
+                while (countInPipeline.load() != 0) {
+                    takenBlocks.emplace_back(popBlock());
+                    PipelineBlock &next = takenBlocks.back();
+                    if (next.isLast || !std::holds_alternative<BlockInfo>(*next.bi)) {
+                        break;
                     }
-                    CHECK(currentBlockNum.value() != 0, "Incorrect block number");
-                    blockInfo.header.blockNumber = currentBlockNum.value();
-                    
-                    for (TransactionInfo &tx: blockInfo.txs) {
-                        tx.blockNumber = blockInfo.header.blockNumber.value();
+                    const BlockHeader &header = std::get<BlockInfo>(*next.bi).header;
+                    if (header.prevHash != lastHash || header.filePos.fileNameRelative != firstHeader.filePos.fileNameRelative) {
+                        break;
                     }
+                    batch.emplace_back(&next);
+                    lastHash = header.hash;
+                }
+                if (batch.size() == 1) {
+                    return;
+                }
+                std::vector<const std::string*> dumps;
+                dumps.reserve(batch.size());
+                for (const PipelineBlock *element: batch) {
+                    dumps.emplace_back(element->dump.get());
+                }
+                const std::vector<size_t> positions = blocksAppender->appendBlocks(getFullPath(firstHeader.filePos.fileNameRelative, folderBlocks), dumps);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    batch[i]->writtenPos = positions[i];
+                }
+            };
+            
+            const auto nextBlock = [&]() {
+                PipelineBlock block;
+                if (!leftBlocks.empty()) {
+                    block = std::move(leftBlocks.front());
+                    leftBlocks.pop_front();
+                    return block;
+                }
+                if (!takenBlocks.empty()) {
+                    block = std::move(takenBlocks.front());
+                    takenBlocks.pop_front();
+                } else {
+                    block = popBlock();
+                    writeReadyBlocks(block);
+                }
+                if (block.isLast && block.exception) {
+                    std::rethrow_exception(block.exception);
+                }
+                return block;
+            };
+            
+            try {
+                while (true) {
+                    Timer tt;
                     
-                    auto [timelineKey, timelineElement] = timeline.addSimpleBlock(blockInfo.header);
-                    
-                    tt.stop();
-                    tt2.stop();
-                    
-                    LOGINFO << "Block " << currentBlockNum.value() << " getted. Count txs " << blockInfo.txs.size() << ". Time ms " << tt.countMs() << " " << tt2.countMs() << " current block " << toHex(blockInfo.header.hash) << ". Parent hash " << toHex(blockInfo.header.prevHash);
-                    
-                    std::shared_ptr<BlockInfo> blockInfoPtr(nextBi, &blockInfo);
-                    
-                    for (Worker* worker: workers) {
-                        worker->process(blockInfoPtr, nextBlockDump);
+                    const PipelineBlock block = nextBlock();
+                    if (block.isLast) {
+                        //c Сброс на диск по политике appender'а: при TimeWindow его сделает таймер, подтверждение придет со следующим commit
+                        commitBlockFiles();
+                        if (isNoDefaultSource) {
+                            LOGINFO << "Get blocks from default";
+                        }
+                        gba = getBlockAlgorithm.get();
+                        isNoDefaultSource = false;
+                        break;
                     }
+                    std::shared_ptr<std::variant<std::monostate, BlockInfo, SignBlockInfo>> nextBi = block.bi;
+                    std::shared_ptr<std::string> nextBlockDump = block.dump;
                     
-                    saveBlockToLeveldb(blockInfo, timelineKey, timelineElement);
-                    gba->confirmBlock(FileInfo(blockInfo.header.filePos.fileNameRelative, blockInfo.header.endBlockPos()));
-                } else if (std::holds_alternative<SignBlockInfo>(*nextBi)) {
-                    SignBlockInfo &blockInfo = std::get<SignBlockInfo>(*nextBi);
-                    Timer tt2;
-                    
-                    saveTransactionsSignBlock(blockInfo, *nextBlockDump, isSaveBlockToFiles && !isNoDefaultSource);
-                    
-                    auto [timelineKey, timelineElement] = timeline.addSignBlock(blockInfo.header);
-                    
-                    tt.stop();
-                    tt2.stop();
-                
-                    LOGINFO << "Sign block " << toHex(blockInfo.header.hash) << " getted. Count txs " << blockInfo.txs.size() << ". Time ms " << tt.countMs() << " " << tt2.countMs() << ". Parent hash " << toHex(blockInfo.header.prevHash);
+                    if (std::holds_alternative<BlockInfo>(*nextBi)) {
+                        BlockInfo &blockInfo = std::get<BlockInfo>(*nextBi);
+                        
+                        Timer tt2;
+                        
+                        saveTransactions(blockInfo, *nextBlockDump, isSaveBlockToFiles && !isNoDefaultSource, block.writtenPos);
+                        
+                        const std::optional<size_t> currentBlockNum = blockchain.addBlock(blockInfo.header);
+                        if (!currentBlockNum.has_value()) {
+                            LOGINFO << "Ya tuta " << toHex(blockInfo.header.hash) << " " << toHex(blockInfo.header.prevHash);
+                            stopPipeline();
+                            syncBlockFiles();
+                            const std::optional<ConflictBlocksInfo> conflictBlock = findCommonAncestor();
+                            if (!conflictBlock.has_value()) {
+                                throw exception("False alarm");
+                            } else {
+                                return conflictBlock;
+                            }
+                        }
+                        CHECK(currentBlockNum.value() != 0, "Incorrect block number");
+                        blockInfo.header.blockNumber = currentBlockNum.value();
+                        
+                        for (TransactionInfo &tx: blockInfo.txs) {
+                            tx.blockNumber = blockInfo.header.blockNumber.value();
+                        }
+                        
+                        auto [timelineKey, timelineElement] = timeline.addSimpleBlock(blockInfo.header);
+                        
+                        tt.stop();
+                        tt2.stop();
+                        
+                        LOGINFO << "Block " << currentBlockNum.value() << " getted. Count txs " << blockInfo.txs.size() << ". Time ms " << tt.countMs() << " " << tt2.countMs() << " current block " << toHex(blockInfo.header.hash) << ". Parent hash " << toHex(blockInfo.header.prevHash);
+                        
+                        //c До воркеров: здесь блоку выдается номер файла, и запись о новом номере должна попасть в базу раньше ссылок на него
+                        saveBlockToLeveldb(blockInfo, timelineKey, timelineElement);
+                        
+                        std::shared_ptr<BlockInfo> blockInfoPtr(nextBi, &blockInfo);
+                        
+                        for (Worker* worker: workers) {
+                            worker->process(blockInfoPtr, nextBlockDump);
+                        }
+                        
+                        confirmBlock(gba, FileInfo(blockInfo.header.filePos.fileNameRelative, blockInfo.header.endBlockPos()));
+                        
+                        if (snapshotPeriodBlocks != 0 && currentBlockNum.value() % snapshotPeriodBlocks == 0) {
+                            saveSnapshot();
+                        }
+                    } else if (std::holds_alternative<SignBlockInfo>(*nextBi)) {
+                        SignBlockInfo &blockInfo = std::get<SignBlockInfo>(*nextBi);
+                        //c Источник фильтрует уже добавленные блоки подписей в своем потоке и не видит те, что еще лежат в очереди
+                        if (timeline.findSignature(blockInfo.header.hash).has_value()) {
+                            LOGINFO << "Sign block " << toHex(blockInfo.header.hash) << " already added";
+                            continue;
+                        }
+                        Timer tt2;
+                        
+                        saveTransactionsSignBlock(blockInfo, *nextBlockDump, isSaveBlockToFiles && !isNoDefaultSource);
+                        
+                        auto [timelineKey, timelineElement] = timeline.addSignBlock(blockInfo.header);
+                        
+                        tt.stop();
+                        tt2.stop();
                     
-                    saveSignBlockToLeveldb(blockInfo, timelineKey, timelineElement);
-                    gba->confirmBlock(FileInfo(blockInfo.header.filePos.fileNameRelative, blockInfo.header.endBlockPos()));
-                } else {
-                    throwErr("Unknown block type");
+                        LOGINFO << "Sign block " << toHex(blockInfo.header.hash) << " getted. Count txs " << blockInfo.txs.size() << ". Time ms " << tt.countMs() << " " << tt2.countMs() << ". Parent hash " << toHex(blockInfo.header.prevHash);
+                        
+                        saveSignBlockToLeveldb(blockInfo, timelineKey, timelineElement);
+                        confirmBlock(gba, FileInfo(blockInfo.header.filePos.fileNameRelative, blockInfo.header.endBlockPos()));
+                    } else {
+                        throwErr("Unknown block type");
+                    }
+    
+                    checkStopSignal();
                 }
-
-                checkStopSignal();
+            } catch (...) {
+                stopPipeline();
+                syncBlockFiles();
+                throw;
             }
         } catch (const exception &e) {
             LOGERR << e;
@@ -512,6 +881,11 @@ std::vector<TransactionInfo> SyncImpl::getTxsForAddress(const Address &address,
     return mainWorker->getTxsForAddress(address, from, count, limitTxs, filters);
 }
 
+std::vector<TransactionInfo> SyncImpl::getTxsForAddressFromCursor(const Address &address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const {
+    CHECK(mainWorker != nullptr, "Main worker not initialized");
+    return mainWorker->getTxsForAddressFromCursor(address, cursor, count, limitTxs);
+}
+
 std::optional<TransactionInfo> SyncImpl::getTransaction(const std::string &txHash) const {
     CHECK(mainWorker != nullptr, "Main worker not initialized");
     return mainWorker->getTransaction(txHash);
@@ -522,6 +896,16 @@ BalanceInfo SyncImpl::getBalance(const Address &address) const {
     return mainWorker->getBalance(address);
 }
 
+std::vector<std::optional<TransactionInfo>> SyncImpl::getTransactions(const std::vector<std::string> &txHashes) const {
+    CHECK(mainWorker != nullptr, "Main worker not initialized");
+    return mainWorker->getTransactions(txHashes);
+}
+
+std::vector<BalanceInfo> SyncImpl::getBalances(const std::vector<Address> &addresses) const {
+    CHECK(mainWorker != nullptr, "Main worker not initialized");
+    return mainWorker->getBalances(addresses);
+}
+
 std::string SyncImpl::getBlockDump(const std::vector<unsigned char> &hash, const FilePosition &filePos, size_t fromByte, size_t toByte, bool isHex, bool isSign) const {
     CHECK(modules[MODULE_BLOCK] && modules[MODULE_BLOCK_RAW], "modules " + MODULE_BLOCK_STR + " " + MODULE_BLOCK_RAW_STR + " not set");
        
@@ -531,8 +915,7 @@ std::string SyncImpl::getBlockDump(const std::vector<unsigned char> &hash, const
     std::string fullBlockDump;
     if (!cache.has_value()) {
         CHECK(!filePos.fileNameRelative.empty(), "Empty file name in block header");
-        IfStream file;
-        openFile(file, getFullPath(filePos.fileNameRelative, folderBlocks));
+        std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(filePos.fileNameRelative, folderBlocks), filePos.pos + 1);
         const auto &[size_block, dumpBlock] = torrent_node_lib::getBlockDump(file, filePos.pos, fromByte, toByte);
         res = dumpBlock;
         realSizeBlock = size_block;
@@ -579,8 +962,7 @@ std::string SyncImpl::getBlockDump(const std::vector<unsigned char> &hash, const
 
 SignBlockInfo SyncImpl::readSignBlockInfo(const MinimumSignBlockHeader &bh) const {
     CHECK(!bh.filePos.fileNameRelative.empty(), "Empty file name in block header");
-    IfStream file;
-    openFile(file, getFullPath(bh.filePos.fileNameRelative, folderBlocks));
+    std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(bh.filePos.fileNameRelative, folderBlocks), bh.filePos.pos + 1);
     std::string tmp;
     const size_t nextPos = readNextBlockDump(file, bh.filePos.pos, tmp);
     std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> b =
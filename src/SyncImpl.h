@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <memory>
+#include <future>
 
 #include "Cache/Cache.h"
 #include "LevelDb.h"
@@ -21,6 +22,7 @@
 #include "blockchain_structs/SignBlock.h"
 #include "blockchain_structs/RejectedTxsBlock.h"
 #include "blockchain_structs/DelegateState.h"
+#include "blockchain_structs/BlocksMetadata.h"
 
 namespace torrent_node_lib {
 
@@ -34,6 +36,8 @@ class WorkerMain;
 class BlockSource;
 class PrivateKey;
 class RejectedTxsWorker;
+class FileNamesDictionary;
+struct FilePosition;
 
 struct V8Details;
 struct V8Code;
@@ -52,6 +56,7 @@ struct Token;
 class RejectedBlockSource;
 
 struct ConflictBlocksInfo;
+struct BlocksMetadata;
 
 class SyncImpl {  
 public:
@@ -66,6 +71,13 @@ public:
     
     void setLeveldbOptNodeTest(const LevelDbOptions &leveldbOpt);
     
+    void setBlockFilesOpt(const BlockFilesOptions &blockFilesOpt);
+    
+    /**
+     *c Снимок blockchain сохраняется раз в snapshotPeriodBlocks блоков. 0 - снимки не сохраняются и не читаются
+     */
+    void setSnapshotPeriodBlocks(size_t snapshotPeriodBlocks);
+    
     ~SyncImpl();
     
 private:
@@ -84,10 +96,16 @@ public:
     
     std::vector<TransactionInfo> getTxsForAddress(const Address &address, size_t &from, size_t count, size_t limitTxs, const TransactionsFilters &filters) const;
     
+    std::vector<TransactionInfo> getTxsForAddressFromCursor(const Address &address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const;
+    
     std::optional<TransactionInfo> getTransaction(const std::string &txHash) const;
     
     BalanceInfo getBalance(const Address &address) const;
     
+    std::vector<std::optional<TransactionInfo>> getTransactions(const std::vector<std::string> &txHashes) const;
+    
+    std::vector<BalanceInfo> getBalances(const std::vector<Address> &addresses) const;
+    
     std::string getBlockDump(const std::vector<unsigned char> &hash, const FilePosition &filePos, size_t fromByte, size_t toByte, bool isHex, bool isSign) const;
     
     BlockInfo getFullBlock(const BlockHeader &bh, size_t beginTx, size_t countTx) const;
@@ -140,18 +158,48 @@ public:
 
 private:
    
-    void saveTransactions(BlockInfo &bi, const std::string &binaryDump, bool saveBlockToFile);
+    /**
+     *c writtenPos - позиция блока, если он уже записан в файл вместе с предыдущими
+     */
+    void saveTransactions(BlockInfo &bi, const std::string &binaryDump, bool saveBlockToFile, const std::optional<size_t> &writtenPos);
     
     void saveTransactionsSignBlock(SignBlockInfo &bi, const std::string &binaryDump, bool saveBlockToFile);
+    
+    /**
+     *c Подтверждение откладывается, пока дописанные в файлы блоки не окажутся на диске
+     */
+    void confirmBlock(BlockSource *gba, const FileInfo &fileInfo);
+    
+    void commitBlockFiles();
+    
+    void syncBlockFiles();
+    
+    void confirmSyncedBlocks();
         
-    void saveBlockToLeveldb(const BlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement);
+    /**
+     *c Выдает filePos номер файла. Если запись о номере еще не в базе, кладет ее в batch и возвращает номер для confirmSaved
+     */
+    std::optional<size_t> addFileId(FilePosition &filePos, Batch &batch);
+    
+    void saveBlockToLeveldb(BlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement);
     
-    void saveSignBlockToLeveldb(const SignBlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement);
+    void saveSignBlockToLeveldb(SignBlockInfo &bi, size_t timeLineKey, const std::vector<char> &timelineElement);
 
     SignBlockInfo readSignBlockInfo(const MinimumSignBlockHeader &header) const;
     
     std::optional<ConflictBlocksInfo> findCommonAncestor();
     
+    bool initializeFromSnapshot(const BlocksMetadata &metadata);
+    
+    void saveSnapshotImpl() const;
+    
+    /**
+     *c Запускает сохранение снимка в фоне. Если предыдущее сохранение еще идет, ничего не делает
+     */
+    void saveSnapshot();
+    
+    void waitSnapshot();
+    
 private:
     
     LevelDb leveldb;
@@ -162,6 +210,14 @@ private:
     
     const std::string folderBlocks;
     
+    const std::string snapshotFileName;
+    
+    std::future<void> snapshotFuture;
+    
+    size_t snapshotPeriodBlocks = 10000;
+    
+    FileNamesDictionary &fileNames;
+    
     const std::string technicalAddress;
     
     mutable AllCaches caches;
@@ -182,6 +238,10 @@ private:
     
     bool isSaveBlockToFiles;
     
+    std::unique_ptr<FileAppender> blocksAppender;
+    
+    std::vector<std::pair<BlockSource*, FileInfo>> notConfirmedBlocks;
+    
     const bool isValidate;
 
     const bool validateStates;
@@ -43,32 +43,33 @@ void WorkerCache::work() {
             Timer tt;
             
             Timer tFirst;
-            const std::string attribute = std::to_string(bi.header.blockNumber.value());
-            
-            if (caches.maxCountElementsBlockCache != 0) {
-                caches.blockDumpCache.addValue(HashedString(bi.header.hash.data(), bi.header.hash.size()), attribute, blockDump);
-                caches.blockDumpCache.remove(std::to_string(bi.header.blockNumber.value() - caches.maxCountElementsBlockCache));
-            }
+            caches.blockDumpCache.addValue(HashedString(bi.header.hash.data(), bi.header.hash.size()), blockDump);
             
             tFirst.stop();
             
             Timer tt2;
-            if (caches.maxCountElementsTxsCache != 0) {
+            if (caches.txsCache.isEnabled()) {
                 for (const TransactionInfo &tx: bi.txs) {
                     if (tx.isIntStatusNodeTest()) {
                         continue;
                     }
                     
-                    caches.txsCache.addValue(tx.hash, attribute, tx);
+                    caches.txsCache.addValue(tx.hash, tx);
                 }
-                tt2.stop();
-                caches.txsCache.remove(std::to_string(bi.header.blockNumber.value() - caches.maxCountElementsTxsCache));
             }
+            tt2.stop();
             
             tt.stop();
             
             LOGINFO << "Block " << bi.header.blockNumber.value() << " saved to cache. Time: " << tFirst.countMs() << " " << tt.countMs() << " " << tt2.countMs();
             
+            const auto blocksStat = caches.blockDumpCache.getStatistic();
+            const auto txsStat = caches.txsCache.getStatistic();
+            const auto balancesStat = caches.balancesCache.getStatistic();
+            LOGDEBUG << "Caches stat. Blocks: " << blocksStat.countElements << " " << blocksStat.sizeBytes << " " << blocksStat.hits << " " << blocksStat.misses << " " << blocksStat.evictions
+                << ". Txs: " << txsStat.countElements << " " << txsStat.sizeBytes << " " << txsStat.hits << " " << txsStat.misses << " " << txsStat.evictions
+                << ". Balances: " << balancesStat.countElements << " " << balancesStat.sizeBytes << " " << balancesStat.hits << " " << balancesStat.misses << " " << balancesStat.evictions;
+            
             checkStopSignal();
         } catch (const exception &e) {
             LOGERR << e;
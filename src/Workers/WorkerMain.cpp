@@ -24,10 +24,14 @@
 #include "blockchain_structs/RejectedTxsBlock.h"
 #include "MainBlockInfo.h"
 #include "blockchain_structs/DelegateState.h"
+#include "blockchain_structs/BlocksMetadata.h"
 
 #include <rapidjson/document.h>
 
 #include <random>
+#include <map>
+#include <algorithm>
+#include <numeric>
 
 using namespace common;
 
@@ -35,6 +39,12 @@ namespace torrent_node_lib {
    
 static const Address ZERO_ADDRESS("0x00000000000000000000000000000000000000000000000000");
 
+//c Столько старых записей переводится на номера файлов после каждого блока
+const static size_t COUNT_RECORDS_MIGRATE_IN_BLOCK = 10000;
+
+//c Для флагов читаются сами транзакции из файлов блоков, поэтому порция меньше
+const static size_t COUNT_ADDRESS_FLAGS_MIGRATE_IN_BLOCK = 1000;
+
 template<class RandomIt, class URBG>
 inline void partial_shuffle(RandomIt first, RandomIt middle, RandomIt last, URBG&& g) {
     typedef typename std::iterator_traits<RandomIt>::difference_type diff_t;
@@ -50,9 +60,10 @@ inline void partial_shuffle(RandomIt first, RandomIt middle, RandomIt last, URBG
     }
 }
 
-WorkerMain::WorkerMain(const std::string &folderBlocks, LevelDb &leveldb, AllCaches &caches, BlockChain &blockchain, const std::set<Address> &users, std::mutex &usersMut, int countThreads, bool validateState)
+WorkerMain::WorkerMain(const std::string &folderBlocks, LevelDb &leveldb, FileNamesDictionary &fileNames, AllCaches &caches, BlockChain &blockchain, const std::set<Address> &users, std::mutex &usersMut, int countThreads, bool validateState)
     : folderBlocks(folderBlocks)
     , leveldb(leveldb)
+    , fileNames(fileNames)
     , caches(caches)
     , blockchain(blockchain)
     , countThreads(countThreads)
@@ -78,7 +89,7 @@ void WorkerMain::join() {
     workerThread.join();
 }
 
-std::optional<TransactionStatus> WorkerMain::calcTransactionStatusDelegate(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch) {
+std::optional<TransactionStatus> WorkerMain::calcTransactionStatusDelegate(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch, Counter<false> &counter) {
     CHECK(tx.delegate.has_value(), "Is not delegate transaction");
     
     TransactionStatus txStatus(tx.hash, blockNumber);
@@ -90,7 +101,7 @@ std::optional<TransactionStatus> WorkerMain::calcTransactionStatusDelegate(const
         
         if (txStatus.isSuccess) {
             const DelegateState dState(tx.delegate.value().value, tx.hash);
-            const auto resultKey = batch.addDelegateKey(delegateKey, dState, countVal.get());
+            const auto resultKey = batch.addDelegateKey(delegateKey, dState, counter.get());
             delegateCache[delegateKey].push(resultKey);
         }
     } else {
@@ -139,23 +150,25 @@ static ForgingSums makeForgingSums(const BlockInfo &bi) {
     return result;
 }
 
-void WorkerMain::saveTransactionStatus(const TransactionStatus &txStatus, Batch &txsBatch, const std::string &attributeTxStatusCache) {
+void WorkerMain::saveTransactionStatus(const TransactionStatus &txStatus, Batch &txsBatch) {
     txsBatch.addTransactionStatus(txStatus.transaction, txStatus);
-    caches.txsStatusCache.addValue(txStatus.transaction, attributeTxStatusCache, txStatus);
+    caches.txsStatusCache.addValue(txStatus.transaction, txStatus);
 }
 
 void WorkerMain::saveTransaction(const TransactionInfo &tx, Batch &txsBatch) {
     txsBatch.addTransaction(tx.hash, tx);
 }
 
-void WorkerMain::saveAddressTransaction(const TransactionInfo &tx, const Address &address, Batch &batch) {
-    AddressInfo addrInfo(tx.filePos.pos, tx.filePos.fileNameRelative, tx.blockNumber, tx.blockIndex);
-    batch.addAddress(address.toBdString(), addrInfo, countVal.get());
+void WorkerMain::saveAddressTransaction(const TransactionInfo &tx, const Address &address, Batch &batch, Counter<false> &counter) {
+    AddressInfo addrInfo(tx.filePos, tx.blockNumber, tx.blockIndex);
+    addrInfo.setFlags(tx, address, false);
+    batch.addAddress(address.toBdString(), addrInfo, counter.get());
 }
 
-void WorkerMain::saveAddressTokenTransaction(const TransactionInfo &tx, const Address &address, Batch &batch) {
-    AddressInfo addrInfo(tx.filePos.pos, tx.filePos.fileNameRelative, tx.blockNumber, tx.blockIndex);
-    batch.addAddressToken(address.toBdString(), addrInfo, countVal.get());
+void WorkerMain::saveAddressTokenTransaction(const TransactionInfo &tx, const Address &address, Batch &batch, Counter<false> &counter) {
+    AddressInfo addrInfo(tx.filePos, tx.blockNumber, tx.blockIndex);
+    addrInfo.setFlags(tx, address, true);
+    batch.addAddressToken(address.toBdString(), addrInfo, counter.get());
 }
 
 void WorkerMain::saveAddressStatus(const TransactionStatus &status, const Address &address, Batch &batch) {
@@ -313,10 +326,10 @@ void WorkerMain::changeTokenValue(const TransactionInfo &tx, Batch &txsBatch) {
     }
 }
 
-std::optional<TransactionStatus> WorkerMain::getInstantDelegateStatus(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch) {
+std::optional<TransactionStatus> WorkerMain::getInstantDelegateStatus(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch, Counter<false> &counter) {
     if (tx.delegate.has_value()) {
         CHECK(tx.intStatus.has_value(), "delegate status not seted");
-        return calcTransactionStatusDelegate(tx, blockNumber, delegateCache, batch);
+        return calcTransactionStatusDelegate(tx, blockNumber, delegateCache, batch, counter);
     } else {
         return std::nullopt;
     }
@@ -382,6 +395,256 @@ void WorkerMain::validateStateBlock(const BlockInfo &bi) const {
     }
 }
 
+//c Меньшие блоки применяются последовательно: разбиение и слияние батчей дороже выигрыша
+const static size_t MIN_TXS_FOR_PARALLEL_APPLY = 1000;
+
+/**
+ *c Адреса, состояние которых меняет транзакция. Транзакции с общим адресом должны применяться в одном потоке в исходном порядке.
+ *c Делегирование хранится по паре from-to, токен по адресу to, поэтому для них оба адреса учитываются всегда
+ */
+static void collectTouchedAddresses(const TransactionInfo &tx, std::vector<const Address*> &addresses) {
+    const bool isPairState = tx.delegate.has_value() || tx.tokenInfo.has_value();
+    if (isPairState || !tx.isIntStatusNodeTest()) {
+        if (isPairState || !tx.fromAddress.isInitialWallet()) {
+            addresses.emplace_back(&tx.fromAddress);
+        }
+        if (isPairState || !tx.toAddress.isInitialWallet()) {
+            addresses.emplace_back(&tx.toAddress);
+        }
+    }
+    
+    if (!tx.tokenInfo.has_value()) {
+        return;
+    }
+    if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info)) {
+        const TransactionInfo::TokenInfo::Create &createToken = std::get<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info);
+        addresses.emplace_back(&createToken.owner);
+        for (const auto &[addr, value]: createToken.beginDistribution) {
+            addresses.emplace_back(&addr);
+        }
+    } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info)) {
+        addresses.emplace_back(&std::get<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info).newOwner);
+    } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info)) {
+        addresses.emplace_back(&std::get<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info).toAddress);
+    } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info)) {
+        addresses.emplace_back(&std::get<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info).toAddress);
+    }
+}
+
+static size_t findGroupRoot(std::vector<size_t> &parents, size_t index) {
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+/**
+ *c Возвращает номер части для каждой транзакции. Транзакции объединяются в группы по общим адресам,
+ *c группы раскладываются по частям начиная с самых больших в наименее загруженную часть
+ */
+static std::vector<size_t> splitTransactionsToParts(const std::vector<TransactionInfo> &txs, size_t countParts) {
+    std::vector<size_t> parents(txs.size());
+    std::iota(parents.begin(), parents.end(), 0);
+    
+    std::unordered_map<std::string, size_t> addressesTx;
+    std::vector<const Address*> addresses;
+    for (size_t i = 0; i < txs.size(); i++) {
+        addresses.clear();
+        collectTouchedAddresses(txs[i], addresses);
+        for (const Address *address: addresses) {
+            const auto [found, isInserted] = addressesTx.try_emplace(address->toBdString(), i);
+            if (!isInserted) {
+                parents[findGroupRoot(parents, i)] = findGroupRoot(parents, found->second);
+            }
+        }
+    }
+    
+    std::unordered_map<size_t, size_t> groupSizes;
+    for (size_t i = 0; i < txs.size(); i++) {
+        groupSizes[findGroupRoot(parents, i)]++;
+    }
+    std::vector<std::pair<size_t, size_t>> groups(groupSizes.begin(), groupSizes.end());
+    std::sort(groups.begin(), groups.end(), [](const auto &first, const auto &second) {
+        return std::make_pair(second.second, first.first) < std::make_pair(first.second, second.first);
+    });
+    
+    std::vector<size_t> partSizes(countParts, 0);
+    std::unordered_map<size_t, size_t> groupParts;
+    for (const auto &[root, size]: groups) {
+        const size_t part = std::min_element(partSizes.begin(), partSizes.end()) - partSizes.begin();
+        partSizes[part] += size;
+        groupParts[root] = part;
+    }
+    
+    std::vector<size_t> result(txs.size());
+    for (size_t i = 0; i < txs.size(); i++) {
+        result[i] = groupParts[findGroupRoot(parents, i)];
+    }
+    return result;
+}
+
+void WorkerMain::applyTransaction(const TransactionInfo &tx, const BlockInfo &bi, Batch &batch, DelegateTransactionsCache &delegateCache, std::unordered_map<std::string, BalanceInfo> &balances, Counter<false> &counter) {
+    const auto toLeveldb = [this, &bi, &counter](const Address &address, const TransactionInfo &tx, Batch &batch, std::unordered_map<std::string, BalanceInfo> &balances, const std::optional<TransactionStatus> &statusDelegate) {
+        if (address.isInitialWallet()) {
+            return;
+        }
+        
+        if (tx.isIntStatusNodeTest()) {
+            return;
+        }
+            
+        if (modules[MODULE_ADDR_TXS]) {
+            saveAddressTransaction(tx, address, batch, counter); // TODO Действия по заполнению кэша должны производиться только в основном потоке
+            
+            if (statusDelegate.has_value()) {
+                saveAddressStatus(statusDelegate.value(), address, batch);
+            }
+        }
+        
+        if (modules[MODULE_BALANCE]) {
+            saveAddressBalance(tx, address, balances, bi.header.isForgingBlock());
+            
+            if (tx.delegate.has_value() && statusDelegate.has_value()) {
+                saveAddressBalanceDelegate(tx, statusDelegate.value(), address, balances);
+            }
+        }
+    };
+    
+    const std::optional<TransactionStatus> txStatusDelegate = getInstantDelegateStatus(tx, bi.header.blockNumber.value(), delegateCache, batch, counter);
+    
+    toLeveldb(tx.fromAddress, tx, batch, balances, txStatusDelegate);
+    if (tx.fromAddress != tx.toAddress) {
+        toLeveldb(tx.toAddress, tx, batch, balances, txStatusDelegate);
+    }
+    
+    if (modules[MODULE_TXS]) {
+        saveTransaction(tx, batch);
+        
+        if (txStatusDelegate.has_value()) {
+            saveTransactionStatus(txStatusDelegate.value(), batch);
+        }
+        
+        if (tx.tokenInfo.has_value()) {
+            if (!tx.isIntStatusNotSuccess()) {
+                if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info)) {
+                    const TransactionInfo::TokenInfo::Create &createToken = std::get<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info);
+                                                            
+                    Token token;
+                    token.type = createToken.type;
+                    token.allValue = createToken.value;
+                    token.beginValue = createToken.value;
+                    token.decimals = createToken.decimals;
+                    token.emission = createToken.emission;
+                    token.name = createToken.name;
+                    token.owner = createToken.owner;
+                    token.symbol = createToken.symbol;
+                    token.txHash = tx.hash;
+                    
+                    batch.addToken(tx.toAddress.toBdString(), token);
+                    
+                    saveAddressTokenTransaction(tx, createToken.owner, batch, counter);
+                    for (const auto& [addr, value]: createToken.beginDistribution) {
+                        saveAddressTokenTransaction(tx, addr, batch, counter);
+                    }
+                } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info)) {
+                    const TransactionInfo::TokenInfo::ChangeOwner &changeOwner = std::get<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info);
+                    changeTokenOwner(tx, batch);
+                    saveAddressTokenTransaction(tx, tx.fromAddress, batch, counter);
+                    saveAddressTokenTransaction(tx, changeOwner.newOwner, batch, counter);
+                } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeEmission>(tx.tokenInfo->info)) {
+                    changeTokenEmission(tx, batch);
+                    saveAddressTokenTransaction(tx, tx.fromAddress, batch, counter);
+                } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info)) {
+                    const TransactionInfo::TokenInfo::AddTokens &addTokens = std::get<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info);
+                    changeTokenValue(tx, batch);
+                    saveAddressTokenTransaction(tx, addTokens.toAddress, batch, counter);
+                } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info)) {
+                    const TransactionInfo::TokenInfo::MoveTokens &moveTokens = std::get<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info);
+                    saveAddressTokenTransaction(tx, tx.fromAddress, batch, counter);
+                    if (tx.fromAddress != moveTokens.toAddress) {
+                        saveAddressTokenTransaction(tx, moveTokens.toAddress, batch, counter);
+                    }
+                } else if (std::holds_alternative<TransactionInfo::TokenInfo::BurnTokens>(tx.tokenInfo->info)) {
+                    changeTokenValue(tx, batch);
+                    saveAddressTokenTransaction(tx, tx.fromAddress, batch, counter);
+                } else {
+                    throwErr("Unknown token type");
+                }
+            }
+        }
+    }
+    
+    if (modules[MODULE_BALANCE]) {
+        if (tx.tokenInfo.has_value()) {
+            if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info)) {
+                saveAddressBalanceCreateToken(tx, balances);
+            } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info)) {
+                saveAddressBalanceAddToken(tx, balances);
+            } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info)) {
+                saveAddressBalanceMoveToken(tx, balances);
+            } else if (std::holds_alternative<TransactionInfo::TokenInfo::BurnTokens>(tx.tokenInfo->info)) {
+                saveAddressBalanceBurnToken(tx, balances);
+            }
+        }
+    }
+}
+
+void WorkerMain::applyTransactions(const BlockInfo &bi, Batch &batch, std::unordered_map<std::string, BalanceInfo> &balances) {
+    std::vector<size_t> txParts;
+    if (countThreads > 1 && bi.txs.size() >= MIN_TXS_FOR_PARALLEL_APPLY) {
+        txParts = splitTransactionsToParts(bi.txs, countThreads);
+    }
+    
+    if (txParts.empty() || std::all_of(txParts.begin(), txParts.end(), [&txParts](size_t part) { return part == txParts.front(); })) {
+        DelegateTransactionsCache delegateCache;
+        for (const TransactionInfo &tx: bi.txs) {
+            applyTransaction(tx, bi, batch, delegateCache, balances, countVal);
+        }
+        return;
+    }
+    
+    const size_t countParts = countThreads;
+    std::vector<std::vector<size_t>> partsTxs(countParts);
+    for (size_t i = 0; i < txParts.size(); i++) {
+        partsTxs[txParts[i]].emplace_back(i);
+    }
+    
+    //c Части пишут в свои батчи со своими временными счетчиками. Операции каждой транзакции потом переносятся в batch в порядке блока,
+    //c временные счетчики заменяются на countVal в том же порядке, что и при последовательном применении
+    std::vector<Batch> batches(countParts);
+    std::vector<std::unordered_map<std::string, BalanceInfo>> partsBalances(countParts);
+    std::vector<Counter<false>> partsCounters(countParts);
+    std::vector<size_t> txsCountOps(bi.txs.size(), 0);
+    std::vector<size_t> parts(countParts);
+    std::iota(parts.begin(), parts.end(), 0);
+    parallelFor(countParts, parts.begin(), parts.end(), [this, &bi, &partsTxs, &batches, &partsBalances, &partsCounters, &txsCountOps, countParts](size_t part) {
+        partsCounters[part].store(BATCH_PART_COUNTER_LIMIT / countParts * (part + 1));
+        DelegateTransactionsCache delegateCache;
+        for (const size_t txIndex: partsTxs[part]) {
+            const size_t beginOps = batches[part].getCountOps();
+            applyTransaction(bi.txs[txIndex], bi, batches[part], delegateCache, partsBalances[part], partsCounters[part]);
+            txsCountOps[txIndex] = batches[part].getCountOps() - beginOps;
+        }
+    });
+    
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(bi.txs.size());
+    for (size_t i = 0; i < bi.txs.size(); i++) {
+        order.emplace_back(txParts[i], txsCountOps[i]);
+    }
+    mergeBatches(batch, batches, order, [this]() {
+        return countVal.get();
+    });
+    
+    for (auto &partBalances: partsBalances) {
+        for (auto &[address, balance]: partBalances) {
+            const bool isInserted = balances.emplace(address, std::move(balance)).second;
+            CHECK(isInserted, "Address balance changed in several parts");
+        }
+    }
+}
+
 void WorkerMain::worker() {    
     while (true) {
         try {
@@ -394,8 +657,6 @@ void WorkerMain::worker() {
             BlockInfo &bi = *biSP;
             Timer tt;
                         
-            const std::string attributeTxStatusCache = std::to_string(bi.header.blockNumber.value());
-            
             const MainBlockInfo oldMetadata = leveldb.findMainBlock();
             const std::vector<unsigned char> prevHash = oldMetadata.blockHash;
             
@@ -409,115 +670,12 @@ void WorkerMain::worker() {
             const bool updateCommonBalance = commonBalance.blockNumber < bi.header.blockNumber.value();
             
             Batch batch;
-            DelegateTransactionsCache delegateCache;
             std::unordered_map<std::string, BalanceInfo> balances;
             if (bi.header.isForgingBlock() || bi.header.isSimpleBlock()) {
-                for (const TransactionInfo &tx: bi.txs) {                   
-                    const auto toLeveldb = [this, &bi](const Address &address, const TransactionInfo &tx, Batch &batch, std::unordered_map<std::string, BalanceInfo> &balances, const std::optional<TransactionStatus> &statusDelegate) {
-                        if (address.isInitialWallet()) {
-                            return;
-                        }
-                        
-                        if (tx.isIntStatusNodeTest()) {
-                            return;
-                        }
-                            
-                        if (modules[MODULE_ADDR_TXS]) {
-                            saveAddressTransaction(tx, address, batch); // TODO Действия по заполнению кэша должны производиться только в основном потоке
-                            
-                            if (statusDelegate.has_value()) {
-                                saveAddressStatus(statusDelegate.value(), address, batch);
-                            }
-                        }
-                        
-                        if (modules[MODULE_BALANCE]) {
-                            saveAddressBalance(tx, address, balances, bi.header.isForgingBlock());
-                            
-                            if (tx.delegate.has_value() && statusDelegate.has_value()) {
-                                saveAddressBalanceDelegate(tx, statusDelegate.value(), address, balances);
-                            }
-                        }
-                    };
-                    
-                    if (modules[MODULE_BALANCE] || modules[MODULE_TXS] || modules[MODULE_ADDR_TXS]) {
-                        const std::optional<TransactionStatus> txStatusDelegate = getInstantDelegateStatus(tx, bi.header.blockNumber.value(), delegateCache, batch);
-                        
-                        toLeveldb(tx.fromAddress, tx, batch, balances, txStatusDelegate);
-                        if (tx.fromAddress != tx.toAddress) {
-                            toLeveldb(tx.toAddress, tx, batch, balances, txStatusDelegate);
-                        }
-                        
-                        if (modules[MODULE_TXS]) {
-                            saveTransaction(tx, batch);
-                            
-                            if (txStatusDelegate.has_value()) {
-                                saveTransactionStatus(txStatusDelegate.value(), batch, attributeTxStatusCache);
-                            }
-                            
-                            if (tx.tokenInfo.has_value()) {
-                                if (!tx.isIntStatusNotSuccess()) {
-                                    if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info)) {
-                                        const TransactionInfo::TokenInfo::Create &createToken = std::get<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info);
-                                                                                
-                                        Token token;
-                                        token.type = createToken.type;
-                                        token.allValue = createToken.value;
-                                        token.beginValue = createToken.value;
-                                        token.decimals = createToken.decimals;
-                                        token.emission = createToken.emission;
-                                        token.name = createToken.name;
-                                        token.owner = createToken.owner;
-                                        token.symbol = createToken.symbol;
-                                        token.txHash = tx.hash;
-                                        
-                                        batch.addToken(tx.toAddress.toBdString(), token);
-                                        
-                                        saveAddressTokenTransaction(tx, createToken.owner, batch);
-                                        for (const auto& [addr, value]: createToken.beginDistribution) {
-                                            saveAddressTokenTransaction(tx, addr, batch);
-                                        }
-                                    } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info)) {
-                                        const TransactionInfo::TokenInfo::ChangeOwner &changeOwner = std::get<TransactionInfo::TokenInfo::ChangeOwner>(tx.tokenInfo->info);
-                                        changeTokenOwner(tx, batch);
-                                        saveAddressTokenTransaction(tx, tx.fromAddress, batch);
-                                        saveAddressTokenTransaction(tx, changeOwner.newOwner, batch);
-                                    } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeEmission>(tx.tokenInfo->info)) {
-                                        changeTokenEmission(tx, batch);
-                                        saveAddressTokenTransaction(tx, tx.fromAddress, batch);
-                                    } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info)) {
-                                        const TransactionInfo::TokenInfo::AddTokens &addTokens = std::get<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info);
-                                        changeTokenValue(tx, batch);
-                                        saveAddressTokenTransaction(tx, addTokens.toAddress, batch);
-                                    } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info)) {
-                                        const TransactionInfo::TokenInfo::MoveTokens &moveTokens = std::get<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info);
-                                        saveAddressTokenTransaction(tx, tx.fromAddress, batch);
-                                        if (tx.fromAddress != moveTokens.toAddress) {
-                                            saveAddressTokenTransaction(tx, moveTokens.toAddress, batch);
-                                        }
-                                    } else if (std::holds_alternative<TransactionInfo::TokenInfo::BurnTokens>(tx.tokenInfo->info)) {
-                                        changeTokenValue(tx, batch);
-                                        saveAddressTokenTransaction(tx, tx.fromAddress, batch);
-                                    } else {
-                                        throwErr("Unknown token type");
-                                    }
-                                }
-                            }
-                        }
-                        
-                        if (modules[MODULE_BALANCE]) {
-                            if (tx.tokenInfo.has_value()) {
-                                if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(tx.tokenInfo->info)) {
-                                    saveAddressBalanceCreateToken(tx, balances);
-                                } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(tx.tokenInfo->info)) {
-                                    saveAddressBalanceAddToken(tx, balances);
-                                } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(tx.tokenInfo->info)) {
-                                    saveAddressBalanceMoveToken(tx, balances);
-                                } else if (std::holds_alternative<TransactionInfo::TokenInfo::BurnTokens>(tx.tokenInfo->info)) {
-                                    saveAddressBalanceBurnToken(tx, balances);
-                                }
-                            }
-                        }
-                    }
+                if (modules[MODULE_BALANCE] || modules[MODULE_TXS] || modules[MODULE_ADDR_TXS]) {
+                    applyTransactions(bi, batch, balances);
+                }
+                for (const TransactionInfo &tx: bi.txs) {
                     if (modules[MODULE_BLOCK]) {
                         if (updateCommonBalance) {
                             if (tx.fromAddress.isInitialWallet() || bi.header.isForgingBlock()) {
@@ -538,17 +696,21 @@ void WorkerMain::worker() {
                 batch.addAllForgedSums(fs);
             }
             
+            std::vector<std::pair<std::string, BalanceInfo>> savedBalances;
+            std::mutex savedBalancesMut;
             if (modules[MODULE_BALANCE]) {
-                parallelFor(countThreads, balances.begin(), balances.end(), [this, &batch, &bi](auto balanceIter){
+                parallelFor(countThreads, balances.begin(), balances.end(), [this, &batch, &bi, &savedBalances, &savedBalancesMut](auto balanceIter){
                     BalanceInfo &currBalance = balanceIter.second;
                     const std::string &address = balanceIter.first;
-                    const BalanceInfo oldBalance = leveldb.findBalance(address);
+                    const BalanceInfo oldBalance = readBalance(address);
                     if (oldBalance.blockNumber < bi.header.blockNumber.value()) {
-                        const BalanceInfo newBalance = oldBalance + currBalance;
+                        BalanceInfo newBalance = oldBalance + currBalance;
                         if (newBalance.received() < newBalance.spent()) { 
                             LOGWARN << "Incorrect balance " + toHex(address.begin(), address.end());
                         }
                         batch.addBalance(address, newBalance);
+                        std::lock_guard<std::mutex> lock(savedBalancesMut);
+                        savedBalances.emplace_back(address, std::move(newBalance));
                     }
                 });
             }
@@ -561,12 +723,22 @@ void WorkerMain::worker() {
             
             addBatch(batch, leveldb);
             
+            //c Кэш обновляется только после записи блока, чтобы в нем не оказалось балансов незаписанного блока
+            for (const auto &[address, balance]: savedBalances) {
+                caches.balancesCache.addValue(address, balance);
+            }
+            
             tt.stop();
             
             LOGINFO << "Block " << bi.header.blockNumber.value() << " saved. Count txs " << bi.txs.size() << ". Time ms " << tt.countMs();
             
-            caches.txsStatusCache.remove(std::to_string(bi.header.blockNumber.value() - caches.maxCountElementsTxsCache));
-                       
+            if (!isFilePositionsMigrated) {
+                isFilePositionsMigrated = !leveldb.migrateFilePositionsPart(COUNT_RECORDS_MIGRATE_IN_BLOCK, fileNames);
+            }
+            if (!isAddressFlagsMigrated) {
+                isAddressFlagsMigrated = !migrateAddressFlagsPart(COUNT_ADDRESS_FLAGS_MIGRATE_IN_BLOCK);
+            }
+            
             std::unique_lock<std::mutex> lock(lastTxsMut);
             lastTxs.insert(lastTxs.begin(), bi.txs.begin(), bi.txs.begin() + std::min(size_t(100), bi.txs.size()));
             lastTxs.erase(lastTxs.begin() +  std::min(size_t(100), lastTxs.size()), lastTxs.end()); // Оставляем 100 последних элементов
@@ -601,13 +773,16 @@ std::optional<size_t> WorkerMain::getInitBlockNumber() const {
 }
 
 std::vector<TransactionInfo> WorkerMain::readTxs(const std::vector<AddressInfo> &foundResults) const {
+    return readTxs(foundResults, folderBlocks);
+}
+
+std::vector<TransactionInfo> WorkerMain::readTxs(const std::vector<AddressInfo> &foundResults, const std::string &folderBlocks) {
     std::vector<TransactionInfo> txs;
     std::string currFileName;
-    IfStream file;
+    std::shared_ptr<const MappedFile> file;
     for (const AddressInfo &addressInfo: foundResults) {      
         if (addressInfo.filePos.fileNameRelative != currFileName) {
-            closeFile(file);
-            openFile(file, getFullPath(addressInfo.filePos.fileNameRelative, folderBlocks));
+            file = openMappedFile(getFullPath(addressInfo.filePos.fileNameRelative, folderBlocks), addressInfo.filePos.pos + 1);
             currFileName = addressInfo.filePos.fileNameRelative;
         }
         TransactionInfo tx;
@@ -673,32 +848,58 @@ static void filterTxs(std::vector<TransactionInfo> &txs, const TransactionsFilte
     }), txs.end());
 }
 
+static bool isFilterMatched(uint8_t flags, const TransactionsFilters &filters) {
+    if (filters.isInput == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_INPUT) == 0) {
+        return false;
+    }
+    if (filters.isOutput == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_OUTPUT) == 0) {
+        return false;
+    }
+    if (filters.isSuccess == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_SUCCESS) == 0) {
+        return false;
+    }
+    
+    if (filters.isTokens == TransactionsFilters::FilterType::True) {
+        return true;
+    }
+    
+    if (filters.isDelegate == TransactionsFilters::FilterType::None && filters.isForging == TransactionsFilters::FilterType::None && filters.isTest == TransactionsFilters::FilterType::None) {
+        return true;
+    }
+    
+    if (filters.isDelegate == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_DELEGATE) != 0) {
+        return true;
+    }
+    if (filters.isForging == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_FORGING) != 0) {
+        return true;
+    }
+    if (filters.isTest == TransactionsFilters::FilterType::True && (flags & AddressInfo::FLAG_NODE_TEST) != 0) {
+        return true;
+    }
+    
+    return false;
+}
+
 std::vector<TransactionInfo> WorkerMain::getTxsForAddressWithoutStatuses(const Address& address, size_t &from, size_t count, size_t limitTxs, const TransactionsFilters &filters) const {
-    const size_t countLimited = limitTxs;
+    const size_t countLimited = std::min(count, limitTxs);
     std::vector<TransactionInfo> result;
-    while (true) {
-        std::vector<AddressInfo> foundResults;
-        if (filters.isTokens == TransactionsFilters::FilterType::True) {
-            foundResults = leveldb.findAddressTokens(address.toBdString(), from, countLimited - result.size());
-        } else {
-            foundResults = leveldb.findAddress(address.toBdString(), from, countLimited - result.size());
-        }
+    if (countLimited == 0) {
+        return result;
+    }
+    const bool isTokens = filters.isTokens == TransactionsFilters::FilterType::True;
+    while (result.size() < countLimited) {
+        //c Записи без флагов (база до миграции) пропускаются сканированием и проверяются после чтения транзакции
+        const std::vector<AddressInfo> foundResults = leveldb.findAddressFiltered(address.toBdString(), isTokens, from, countLimited - result.size(), [&filters](const AddressInfo &info) {
+            return !info.flags.has_value() || isFilterMatched(info.flags.value(), filters);
+        });
         if (foundResults.empty()) {
             break;
         }
-        CHECK(foundResults.size() <= limitTxs, "Too many transactions in history. Please, request a history with chunks"); // TODO remove
         std::vector<TransactionInfo> txs = readTxs(foundResults);
 
         filterTxs(txs, filters, address);
         result.insert(result.end(), txs.begin(), txs.end());
-        
-        from += foundResults.size();
-        
-        if (result.size() >= count) {
-            break;
-        }
     }
-    result.resize(std::min(result.size(), count));
     
     std::sort(result.begin(), result.end(), [](const TransactionInfo &first, const TransactionInfo &second) {
         return first.blockNumber > second.blockNumber;
@@ -723,10 +924,7 @@ std::vector<TransactionStatus> WorkerMain::getTransactionsStatusFillCache(const
     return getStatusesForAddress(address);
 }
 
-std::vector<TransactionInfo> WorkerMain::getTxsForAddress(const Address &address, size_t from, size_t count, size_t limitTxs) const {
-    CHECK(modules[MODULE_ADDR_TXS], "module " + MODULE_ADDR_TXS_STR + " not set");
-    
-    std::vector<TransactionInfo> txs = getTransactionsFillCache(address, from, count, limitTxs);
+void WorkerMain::fillStatusesForAddress(const Address &address, std::vector<TransactionInfo> &txs) const {
     const std::vector<TransactionStatus> statusesVect = getTransactionsStatusFillCache(address);
     
     std::unordered_map<std::string, TransactionStatus> statuses;
@@ -741,6 +939,13 @@ std::vector<TransactionInfo> WorkerMain::getTxsForAddress(const Address &address
             }
         }
     }
+}
+
+std::vector<TransactionInfo> WorkerMain::getTxsForAddress(const Address &address, size_t from, size_t count, size_t limitTxs) const {
+    CHECK(modules[MODULE_ADDR_TXS], "module " + MODULE_ADDR_TXS_STR + " not set");
+    
+    std::vector<TransactionInfo> txs = getTransactionsFillCache(address, from, count, limitTxs);
+    fillStatusesForAddress(address, txs);
     
     return txs;
 }
@@ -749,28 +954,88 @@ std::vector<TransactionInfo> WorkerMain::getTxsForAddress(const Address &address
     CHECK(modules[MODULE_ADDR_TXS], "module " + MODULE_ADDR_TXS_STR + " not set");
     
     std::vector<TransactionInfo> txs = getTxsForAddressWithoutStatuses(address, from, count, limitTxs, filters);
-    const std::vector<TransactionStatus> statusesVect = getTransactionsStatusFillCache(address);
+    fillStatusesForAddress(address, txs);
     
-    std::unordered_map<std::string, TransactionStatus> statuses;
-    for (const TransactionStatus &status: statusesVect) {
-        statuses.emplace(status.transaction, status);
+    return txs;
+}
+
+std::vector<TransactionInfo> WorkerMain::getTxsForAddressFromCursor(const Address &address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const {
+    CHECK(modules[MODULE_ADDR_TXS], "module " + MODULE_ADDR_TXS_STR + " not set");
+    
+    const size_t countLimited = std::min((count == 0 ? limitTxs : count), limitTxs);
+    const std::vector<std::pair<size_t, AddressInfo>> foundResults = leveldb.findAddressFromCursor(address.toBdString(), cursor, countLimited);
+    
+    if (foundResults.size() < countLimited) {
+        cursor = std::nullopt;
+    } else {
+        cursor = foundResults.back().first;
     }
-    for (TransactionInfo &tx: txs) {
-        if (tx.isStatusNeed()) {
-            const auto found = statuses.find(tx.hash);
-            if (found != statuses.end()) {
-                tx.status = found->second;
-            }
+    
+    std::vector<AddressInfo> addressInfos;
+    addressInfos.reserve(foundResults.size());
+    std::transform(foundResults.begin(), foundResults.end(), std::back_inserter(addressInfos), [](const auto &pair) {
+        return pair.second;
+    });
+    
+    std::vector<TransactionInfo> txs = readTxs(addressInfos);
+    
+    std::sort(txs.begin(), txs.end(), [](const TransactionInfo &first, const TransactionInfo &second) {
+        return first.blockNumber > second.blockNumber;
+    });
+    
+    fillStatusesForAddress(address, txs);
+    
+    return txs;
+}
+
+bool WorkerMain::migrateAddressFlagsPart(size_t count) {
+    const std::optional<std::pair<bool, std::string>> state = leveldb.findAddressFlagsMigration();
+    if (!state.has_value()) {
+        return false;
+    }
+    const auto &[isTokens, lastKey] = state.value();
+    
+    const std::vector<std::pair<std::string, AddressInfo>> part = leveldb.findAllAddressesPart(isTokens, lastKey, count);
+    if (part.empty()) {
+        Batch batch;
+        if (!isTokens) {
+            batch.addAddressFlagsMigration(true, "");
+        } else {
+            batch.addAddressFlagsMigrationFinished();
+        }
+        addBatch(batch, leveldb);
+        if (isTokens) {
+            LOGINFO << "Address history flags migration finished";
         }
+        return !isTokens;
     }
     
-    return txs;
+    std::vector<std::pair<std::string, AddressInfo>> records;
+    std::copy_if(part.begin(), part.end(), std::back_inserter(records), [](const auto &pair) {
+        return !pair.second.flags.has_value();
+    });
+    std::vector<AddressInfo> infos;
+    infos.reserve(records.size());
+    std::transform(records.begin(), records.end(), std::back_inserter(infos), [](const auto &pair) {
+        return pair.second;
+    });
+    const std::vector<TransactionInfo> txs = readTxs(infos, folderBlocks);
+    
+    Batch batch;
+    for (size_t i = 0; i < records.size(); i++) {
+        const std::string addressStr = getAddressFromAddressKey(records[i].first, isTokens);
+        const Address address(addressStr.begin(), addressStr.end());
+        records[i].second.setFlags(txs[i], address, isTokens);
+        batch.replaceAddressRecord(records[i].first, records[i].second);
+    }
+    batch.addAddressFlagsMigration(isTokens, part.back().first);
+    addBatch(batch, leveldb);
+    return true;
 }
 
 void WorkerMain::readTransactionInFile(TransactionInfo& tx) const {
-    IfStream file;
     const std::string hash = tx.hash;
-    openFile(file, getFullPath(tx.filePos.fileNameRelative, folderBlocks));
+    std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(tx.filePos.fileNameRelative, folderBlocks), tx.filePos.pos + 1);
     const bool res = readOneSimpleTransactionInfo(file, tx.filePos.pos, tx, false);
     CHECK(res, "Incorrect read transaction info");
     CHECK(hash == tx.hash, "Incorrect transaction");
@@ -821,9 +1086,82 @@ std::optional<TransactionInfo> WorkerMain::getTransaction(const std::string &txH
     return result;
 }
 
+std::vector<std::optional<TransactionInfo>> WorkerMain::getTransactions(const std::vector<std::string> &txHashes) const {
+    CHECK(modules[MODULE_TXS], "module " + MODULE_ADDR_TXS_STR + " not set");
+    
+    std::vector<std::optional<TransactionInfo>> result(txHashes.size());
+    
+    std::vector<size_t> notCached;
+    std::vector<std::string> notCachedHashes;
+    for (size_t i = 0; i < txHashes.size(); i++) {
+        result[i] = caches.txsCache.getValue(txHashes[i]);
+        if (!result[i].has_value()) {
+            notCached.emplace_back(i);
+            notCachedHashes.emplace_back(txHashes[i]);
+        }
+    }
+    
+    const std::vector<std::optional<TransactionInfo>> found = leveldb.findTxs(notCachedHashes, countThreads);
+    //c Группируем чтения по файлам блоков, внутри файла читаем по возрастанию смещения
+    std::map<std::string, std::vector<size_t>> filesReads;
+    for (size_t i = 0; i < found.size(); i++) {
+        if (!found[i].has_value()) {
+            continue;
+        }
+        TransactionInfo &tx = result[notCached[i]].emplace(found[i].value());
+        tx.hash = notCachedHashes[i];
+        filesReads[tx.filePos.fileNameRelative].emplace_back(notCached[i]);
+    }
+    
+    parallelFor(countThreads, filesReads.begin(), filesReads.end(), [this, &result](auto &fileReads) {
+        std::vector<size_t> &indexes = fileReads.second;
+        std::sort(indexes.begin(), indexes.end(), [&result](size_t first, size_t second) {
+            return result[first]->filePos.pos < result[second]->filePos.pos;
+        });
+        std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(fileReads.first, folderBlocks), result[indexes.back()]->filePos.pos + 1);
+        for (const size_t index: indexes) {
+            TransactionInfo &tx = result[index].value();
+            const std::string hash = tx.hash;
+            const bool res = readOneSimpleTransactionInfo(file, tx.filePos.pos, tx, false);
+            CHECK(res, "Incorrect read transaction info");
+            CHECK(hash == tx.hash, "Incorrect transaction");
+        }
+    });
+    
+    std::vector<size_t> notCachedStatuses;
+    std::vector<std::string> notCachedStatusesHashes;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (!result[i].has_value() || !result[i]->isStatusNeed()) {
+            continue;
+        }
+        const std::optional<TransactionStatus> cacheStatus = caches.txsStatusCache.getValue(result[i]->hash);
+        if (cacheStatus.has_value()) {
+            result[i]->status = cacheStatus.value();
+        } else {
+            notCachedStatuses.emplace_back(i);
+            notCachedStatusesHashes.emplace_back(result[i]->hash);
+        }
+    }
+    const std::vector<std::optional<TransactionStatus>> foundStatuses = leveldb.findTxsStatuses(notCachedStatusesHashes, countThreads);
+    for (size_t i = 0; i < foundStatuses.size(); i++) {
+        if (foundStatuses[i].has_value()) {
+            result[notCachedStatuses[i]]->status = foundStatuses[i].value();
+        }
+    }
+    
+    return result;
+}
+
+BalanceInfo WorkerMain::readBalance(const std::string &address) const {
+    const std::optional<BalanceInfo> cache = caches.balancesCache.getValue(address);
+    if (cache.has_value()) {
+        return cache.value();
+    }
+    return leveldb.findBalance(address);
+}
+
 BalanceInfo WorkerMain::readBalance(const Address& address) const {
-    const std::string &addressStr = address.toBdString();
-    return leveldb.findBalance(addressStr);
+    return readBalance(address.toBdString());
 }
 
 BalanceInfo WorkerMain::getBalance(const Address &address) const {
@@ -843,6 +1181,44 @@ BalanceInfo WorkerMain::getBalance(const Address &address) const {
     return balance;
 }
 
+std::vector<BalanceInfo> WorkerMain::getBalances(const std::vector<Address> &addresses) const {
+    CHECK(modules[MODULE_BALANCE], "Module " + MODULE_BALANCE_STR + " not setted");
+    
+    std::vector<std::string> addressesStr;
+    addressesStr.reserve(addresses.size());
+    std::transform(addresses.begin(), addresses.end(), std::back_inserter(addressesStr), std::mem_fn(&Address::toBdString));
+    
+    std::vector<BalanceInfo> balances(addresses.size());
+    std::vector<std::string> notFoundAddresses;
+    std::vector<size_t> notFoundIndexes;
+    for (size_t i = 0; i < addressesStr.size(); i++) {
+        std::optional<BalanceInfo> cache = caches.balancesCache.getValue(addressesStr[i]);
+        if (cache.has_value()) {
+            balances[i] = std::move(cache.value());
+        } else {
+            notFoundAddresses.emplace_back(addressesStr[i]);
+            notFoundIndexes.emplace_back(i);
+        }
+    }
+    if (!notFoundAddresses.empty()) {
+        std::vector<BalanceInfo> found = leveldb.findBalances(notFoundAddresses, countThreads);
+        for (size_t i = 0; i < found.size(); i++) {
+            balances[notFoundIndexes[i]] = std::move(found[i]);
+        }
+    }
+    for (size_t i = 0; i < balances.size(); i++) {
+        BalanceInfo &balance = balances[i];
+        if (addresses[i] == ZERO_ADDRESS) {
+            balance.balance.fill(0, 0);
+        }
+        
+        std::vector<char> toHashString;
+        balance.serialize(toHashString);
+        balance.hash = std::hash<std::vector<char>>()(toHashString);
+    }
+    return balances;
+}
+
 BlockInfo WorkerMain::getFullBlock(const BlockHeader &bh, size_t beginTx, size_t countTx) const {
     CHECK(modules[MODULE_BLOCK_RAW], "module " + MODULE_BLOCK_RAW_STR + " not set");
     
@@ -852,10 +1228,17 @@ BlockInfo WorkerMain::getFullBlock(const BlockHeader &bh, size_t beginTx, size_t
     }
     
     const std::optional<std::shared_ptr<std::string>> cache = caches.blockDumpCache.getValue(HashedString(bh.hash.data(), bh.hash.size()));
-    if (!cache.has_value()) {
+    std::optional<BlockTxsOffsets> txsOffsets;
+    if (!cache.has_value() && countTx != 0) {
+        txsOffsets = leveldb.findBlockTxsOffsets(bh.hash);
+    }
+    if (txsOffsets.has_value()) {
+        CHECK(!bh.filePos.fileNameRelative.empty(), "Empty file name in block header");
+        std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(bh.filePos.fileNameRelative, folderBlocks), bh.filePos.pos + 1);
+        bi.txs = readSimpleBlockTxsPart(file, bh, txsOffsets.value(), beginTx, countTx);
+    } else if (!cache.has_value()) {
         CHECK(!bh.filePos.fileNameRelative.empty(), "Empty file name in block header");
-        IfStream file;
-        openFile(file, getFullPath(bh.filePos.fileNameRelative, folderBlocks));
+        std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(bh.filePos.fileNameRelative, folderBlocks), bh.filePos.pos + 1);
         std::string tmp;
         const size_t nextPos = readNextBlockDump(file, bh.filePos.pos, tmp);
         std::variant<std::monostate, BlockInfo, SignBlockInfo, RejectedTxsMinimumBlockHeader> b =
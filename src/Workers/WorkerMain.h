@@ -20,6 +20,7 @@ namespace torrent_node_lib {
 
 struct AllCaches;
 class LevelDb;
+class FileNamesDictionary;
 class Batch;
 class BlockChain;
 struct TransactionInfo;
@@ -35,7 +36,7 @@ struct AddressInfo;
 class WorkerMain final: public Worker {  
 public:
     
-    WorkerMain(const std::string &folderBlocks, LevelDb &leveldb, AllCaches &caches, BlockChain &blockchain, const std::set<Address> &users, std::mutex &usersMut, int countThreads, bool validateState);
+    WorkerMain(const std::string &folderBlocks, LevelDb &leveldb, FileNamesDictionary &fileNames, AllCaches &caches, BlockChain &blockchain, const std::set<Address> &users, std::mutex &usersMut, int countThreads, bool validateState);
        
     ~WorkerMain() override;
     
@@ -59,9 +60,18 @@ public:
     
     std::vector<TransactionInfo> getTxsForAddress(const Address &address, size_t &from, size_t count, size_t limitTxs, const TransactionsFilters &filters) const;
     
+    std::vector<TransactionInfo> getTxsForAddressFromCursor(const Address &address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const;
+    
     std::optional<TransactionInfo> getTransaction(const std::string &txHash) const;
     
     BalanceInfo getBalance(const Address &address) const;
+    
+    /**
+     *c Пакетные версии getTransaction и getBalance. Порядок результата совпадает с порядком входа
+     */
+    std::vector<std::optional<TransactionInfo>> getTransactions(const std::vector<std::string> &txHashes) const;
+    
+    std::vector<BalanceInfo> getBalances(const std::vector<Address> &addresses) const;
         
     BlockInfo getFullBlock(const BlockHeader &bh, size_t beginTx, size_t countTx) const;
     
@@ -79,6 +89,14 @@ public:
     
     std::vector<Address> getRandomAddresses(size_t countAddresses) const;
     
+private:
+    
+    /**
+     *c Заполняет флаги не больше чем у count записей истории адресов, сохраненных до их появления.
+     *c Пока миграция не закончена, фильтры истории проверяют записи без флагов по самим транзакциям. Возвращает false, когда миграция закончена
+     */
+    bool migrateAddressFlagsPart(size_t count);
+    
 private:
     
     void worker();
@@ -97,19 +115,25 @@ private:
     
     std::vector<TransactionInfo> readTxs(const std::vector<AddressInfo> &foundResults) const;
     
+    static std::vector<TransactionInfo> readTxs(const std::vector<AddressInfo> &foundResults, const std::string &folderBlocks);
+    
+    void fillStatusesForAddress(const Address &address, std::vector<TransactionInfo> &txs) const;
+    
     std::optional<TransactionInfo> findTransaction(const std::string &txHash) const;
     
     void fillStatusTransaction(TransactionInfo &info) const;
     
     BalanceInfo readBalance(const Address& address) const;
     
-    void saveTransactionStatus(const TransactionStatus &txStatus, Batch &txsBatch, const std::string &attributeTxStatusCache);
+    BalanceInfo readBalance(const std::string &address) const;
+    
+    void saveTransactionStatus(const TransactionStatus &txStatus, Batch &txsBatch);
     
     void saveTransaction(const TransactionInfo &tx, Batch &txsBatch);
     
-    void saveAddressTransaction(const TransactionInfo &tx, const Address &address, Batch &batch);
+    void saveAddressTransaction(const TransactionInfo &tx, const Address &address, Batch &batch, Counter<false> &counter);
     
-    void saveAddressTokenTransaction(const TransactionInfo &tx, const Address &address, Batch &batch);
+    void saveAddressTokenTransaction(const TransactionInfo &tx, const Address &address, Batch &batch, Counter<false> &counter);
     
     void saveAddressStatus(const TransactionStatus &status, const Address &address, Batch &batch);
     
@@ -133,9 +157,16 @@ private:
     
     void changeTokenValue(const TransactionInfo &tx, Batch &txsBatch);
     
-    std::optional<TransactionStatus> getInstantDelegateStatus(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch);
+    std::optional<TransactionStatus> getInstantDelegateStatus(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch, Counter<false> &counter);
+    
+    std::optional<TransactionStatus> calcTransactionStatusDelegate(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch, Counter<false> &counter);
+    
+    void applyTransaction(const TransactionInfo &tx, const BlockInfo &bi, Batch &batch, DelegateTransactionsCache &delegateCache, std::unordered_map<std::string, BalanceInfo> &balances, Counter<false> &counter);
     
-    std::optional<TransactionStatus> calcTransactionStatusDelegate(const TransactionInfo &tx, size_t blockNumber, DelegateTransactionsCache &delegateCache, Batch &batch);
+    /**
+     *c Транзакции разбиваются на группы без общих адресов, группы применяются параллельно, результат сливается в batch в исходном порядке
+     */
+    void applyTransactions(const BlockInfo &bi, Batch &batch, std::unordered_map<std::string, BalanceInfo> &balances);
     
     void readTransactionInFile(TransactionInfo &filePos) const;
     
@@ -149,6 +180,8 @@ private:
     
     LevelDb &leveldb;
     
+    FileNamesDictionary &fileNames;
+    
     AllCaches &caches;
     
     BlockChain &blockchain;
@@ -159,6 +192,10 @@ private:
     
     common::BlockedQueue<std::shared_ptr<BlockInfo>, 1> queue;
     
+    bool isFilePositionsMigrated = false;
+    
+    bool isAddressFlagsMigrated = false;
+    
     std::vector<TransactionInfo> lastTxs;
     mutable std::mutex lastTxsMut;
     
@@ -280,8 +280,7 @@ NodeTestResult readNodeTestTransaction(const BestNodeElement &nodeTestElement, s
     if (nodeTestElement.empty) {
         return NodeTestResult();
     }
-    IfStream file;
-    openFile(file, getFullPath(nodeTestElement.txPos.fileNameRelative, folderBlocks));
+    std::shared_ptr<const MappedFile> file = openMappedFile(getFullPath(nodeTestElement.txPos.fileNameRelative, folderBlocks), nodeTestElement.txPos.pos + 1);
     TransactionInfo tx;
     const bool res = readOneSimpleTransactionInfo(file, nodeTestElement.txPos.pos, tx, false);
     CHECK(res, "Incorrect read transaction info");
@@ -62,8 +62,6 @@ void WorkerScript::work() {
             
             Batch batchStates;
             if (bi.header.isSimpleBlock()) {
-                const std::string attributeTxStatusCache = std::to_string(bi.header.blockNumber.value());
-                
                 const auto v8StateToTxStatus = [](const std::string &txHash, const V8State &state) {
                     CHECK(state.errorType != V8State::ErrorType::USER_ERROR, "User error " + state.errorMessage);
                     TransactionStatus::V8Status status;
@@ -213,7 +211,7 @@ void WorkerScript::work() {
                     }
                     
                     if (modules[MODULE_TXS]) {
-                        caches.txsStatusCache.addValue(txStatus.transaction, attributeTxStatusCache, txStatus);
+                        caches.txsStatusCache.addValue(txStatus.transaction, txStatus);
                         leveldb.saveTransactionStatus(txStatus.transaction, txStatus); // Здесь сохраняем не в batch, так как другой тред может начать перезаписывать кэши                           
                     }
                 }
@@ -3,8 +3,37 @@
 #include <check.h>
 #include <utils/serialize.h>
 
+#include "blockchain_structs/TransactionInfo.h"
+#include "blockchain_structs/Address.h"
+
 namespace torrent_node_lib {
 
+void AddressInfo::setFlags(const TransactionInfo &tx, const Address &address, bool isToken) {
+    uint8_t result = 0;
+    if (tx.toAddress.isSet_() && tx.toAddress == address) {
+        result |= FLAG_INPUT;
+    }
+    if (tx.fromAddress.isSet_() && tx.fromAddress == address) {
+        result |= FLAG_OUTPUT;
+    }
+    if (tx.delegate.has_value()) {
+        result |= FLAG_DELEGATE;
+    }
+    if (tx.isIntStatusForging()) {
+        result |= FLAG_FORGING;
+    }
+    if (tx.isIntStatusNodeTest()) {
+        result |= FLAG_NODE_TEST;
+    }
+    if (isToken) {
+        result |= FLAG_TOKEN;
+    }
+    if (!tx.isIntStatusNotSuccess()) {
+        result |= FLAG_SUCCESS;
+    }
+    flags = result;
+}
+
 void AddressInfo::serialize(std::vector<char>& buffer) const {
     CHECK(blockNumber != 0, "AddressInfo not initialized");
 
@@ -14,6 +43,9 @@ void AddressInfo::serialize(std::vector<char>& buffer) const {
     if (undelegateValue.has_value()) {
         serializeInt<uint64_t>(undelegateValue.value(), buffer);
     }
+    if (flags.has_value()) {
+        buffer.emplace_back(flags.value());
+    }
 }
 
 AddressInfo AddressInfo::deserialize(const std::string& raw) {
@@ -23,9 +55,16 @@ AddressInfo AddressInfo::deserialize(const std::string& raw) {
     result.filePos = FilePosition::deserialize(raw, from);
     result.blockNumber = deserializeInt<size_t>(raw, from);
     result.blockIndex = deserializeInt<size_t>(raw, from);
-    if (from < raw.size()) {
+    //c Хвост записи: undelegateValue (8 байт) и/или байт флагов. Различаются по длине
+    const size_t tail = raw.size() - from;
+    if (tail == sizeof(uint64_t) || tail == sizeof(uint64_t) + 1) {
         result.undelegateValue = deserializeInt<uint64_t>(raw, from);
     }
+    if (from < raw.size()) {
+        CHECK(raw.size() - from == 1, "Incorrect address info");
+        result.flags = raw[from];
+        from++;
+    }
 
     return result;
 }
@@ -9,12 +9,28 @@
 
 namespace torrent_node_lib {
 
+struct TransactionInfo;
+class Address;
+
 struct AddressInfo {
 
+    /**
+     *c Флаги транзакции относительно адреса. Позволяют фильтровать историю без чтения транзакций из файлов блоков
+     */
+    enum Flag: uint8_t {
+        FLAG_INPUT = 1 << 0,
+        FLAG_OUTPUT = 1 << 1,
+        FLAG_DELEGATE = 1 << 2,
+        FLAG_FORGING = 1 << 3,
+        FLAG_NODE_TEST = 1 << 4,
+        FLAG_TOKEN = 1 << 5,
+        FLAG_SUCCESS = 1 << 6
+    };
+
     AddressInfo() = default;
 
-    AddressInfo(size_t pos, const std::string &fileName, size_t blockNumber, size_t index)
-        : filePos(fileName, pos)
+    AddressInfo(const torrent_node_lib::FilePosition &filePos, size_t blockNumber, size_t index)
+        : filePos(filePos)
         , blockNumber(blockNumber)
         , blockIndex(index)
     {}
@@ -26,6 +42,13 @@ struct AddressInfo {
 
     std::optional<int64_t> undelegateValue;
 
+    /**
+     *c Записи старых баз хранятся без флагов
+     */
+    std::optional<uint8_t> flags;
+
+    void setFlags(const TransactionInfo &tx, const Address &address, bool isToken);
+
     void serialize(std::vector<char> &buffer) const;
 
     static AddressInfo deserialize(const std::string &raw);
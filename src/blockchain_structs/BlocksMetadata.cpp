@@ -39,4 +39,34 @@ FileInfo FileInfo::deserialize(const std::string& raw) {
 
     return result;
 }
+
+std::string BlockTxsOffsets::serialize() const {
+    std::string res;
+    res += serializeVarUInt(offsets.size());
+    size_t prev = 0;
+    for (const size_t offset: offsets) {
+        CHECK(offset >= prev, "Incorrect tx offsets");
+        res += serializeVarUInt(offset - prev);
+        prev = offset;
+    }
+    return res;
+}
+
+BlockTxsOffsets BlockTxsOffsets::deserialize(const std::string &raw) {
+    BlockTxsOffsets result;
+
+    if (raw.empty()) {
+        return result;
+    }
+
+    size_t from = 0;
+    const size_t count = deserializeVarUInt(raw, from);
+    result.offsets.reserve(count);
+    size_t prev = 0;
+    for (size_t i = 0; i < count; i++) {
+        prev += deserializeVarUInt(raw, from);
+        result.offsets.emplace_back(prev);
+    }
+    return result;
+}
 }
@@ -40,6 +40,21 @@ struct FileInfo {
 
     static FileInfo deserialize(const std::string &raw);
 
+};
+
+/**
+ *c Смещения каждой STEP-й транзакции блока от начала записи блока в файле. Позволяют читать страницу транзакций без разбора всего блока
+ */
+struct BlockTxsOffsets {
+
+    constexpr static size_t STEP = 32;
+
+    std::vector<size_t> offsets;
+
+    std::string serialize() const;
+
+    static BlockTxsOffsets deserialize(const std::string &raw);
+
 };
 }
 
@@ -2,31 +2,116 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include "check.h"
 #include "utils/serialize.h"
 
 namespace torrent_node_lib {
 
-std::string FilePosition::serialize() const {
-    CHECK(!fileNameRelative.empty(), "FilePosition not initialized");
+//c Старый формат начинается со старшего байта длины имени, то есть с 0
+const static char FILE_ID_FORMAT = 1;
 
-    std::string res;
-    res.reserve(50);
-    res += torrent_node_lib::serializeString(fileNameRelative);
-    res += torrent_node_lib::serializeInt<size_t>(pos);
-    return res;
+void FileNamesDictionary::initialize(const std::vector<std::pair<size_t, std::string>> &savedNames) {
+    std::unique_lock<std::shared_mutex> lock(mut);
+    ids.clear();
+    names.clear();
+    for (const auto &[id, fileName]: savedNames) {
+        CHECK(!fileName.empty(), "Incorrect file name in dictionary");
+        if (names.size() <= id) {
+            names.resize(id + 1);
+        }
+        CHECK(names[id].empty(), "Duplicate file id " + std::to_string(id));
+        names[id] = fileName;
+        const bool isInserted = ids.emplace(fileName, id).second;
+        CHECK(isInserted, "Duplicate file name " + fileName);
+    }
+    CHECK(ids.size() == names.size(), "File names dictionary has gaps");
+    isSaved.assign(names.size(), true);
+    initialized = true;
+}
+
+bool FileNamesDictionary::isInitialized() const {
+    std::shared_lock<std::shared_mutex> lock(mut);
+    return initialized;
+}
+
+std::pair<size_t, bool> FileNamesDictionary::getOrAddId(const std::string &fileName) {
+    CHECK(!fileName.empty(), "Empty file name");
+    {
+        std::shared_lock<std::shared_mutex> lock(mut);
+        const auto found = ids.find(fileName);
+        if (found != ids.end()) {
+            return std::make_pair(found->second, !isSaved[found->second]);
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mut);
+    CHECK(initialized, "File names dictionary not initialized");
+    const auto found = ids.find(fileName);
+    if (found != ids.end()) {
+        return std::make_pair(found->second, !isSaved[found->second]);
+    }
+    const size_t id = names.size();
+    names.emplace_back(fileName);
+    isSaved.emplace_back(false);
+    ids.emplace(fileName, id);
+    return std::make_pair(id, true);
+}
+
+void FileNamesDictionary::confirmSaved(size_t id) {
+    std::unique_lock<std::shared_mutex> lock(mut);
+    CHECK(id < isSaved.size(), "File id " + std::to_string(id) + " not found in dictionary");
+    isSaved[id] = true;
+}
+
+std::string FileNamesDictionary::getName(size_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mut);
+    CHECK(id < names.size(), "File id " + std::to_string(id) + " not found in dictionary");
+    return names[id];
+}
+
+FileNamesDictionary& getFileNamesDictionary() {
+    static FileNamesDictionary dictionary;
+    return dictionary;
+}
+
+std::string FilePosition::serialize() const {
+    std::vector<char> buffer;
+    buffer.reserve(50);
+    serialize(buffer);
+    return std::string(buffer.begin(), buffer.end());
 }
 
 void FilePosition::serialize(std::vector<char> &buffer) const {
     CHECK(!fileNameRelative.empty(), "FilePosition not initialized");
-    torrent_node_lib::serializeString(fileNameRelative, buffer);
-    torrent_node_lib::serializeInt<size_t>(pos, buffer);
+    if (fileId.has_value()) {
+        buffer.emplace_back(FILE_ID_FORMAT);
+        torrent_node_lib::serializeVarUInt(fileId.value(), buffer);
+        torrent_node_lib::serializeVarUInt(pos, buffer);
+    } else {
+        torrent_node_lib::serializeString(fileNameRelative, buffer);
+        torrent_node_lib::serializeInt<size_t>(pos, buffer);
+    }
 }
 
 FilePosition FilePosition::deserialize(const std::string &raw, size_t from, size_t &nextFrom) {
     FilePosition result;
 
+    if (from < raw.size() && raw[from] == FILE_ID_FORMAT) {
+        from++;
+        const size_t id = torrent_node_lib::deserializeVarUInt(raw, from, nextFrom);
+        CHECK(nextFrom != from, "Incorrect raw ");
+        from = nextFrom;
+        result.fileNameRelative = getFileNamesDictionary().getName(id);
+        result.fileId = id;
+
+        result.pos = torrent_node_lib::deserializeVarUInt(raw, from, nextFrom);
+        CHECK(nextFrom != from, "Incorrect raw ");
+        from = nextFrom;
+
+        return result;
+    }
+
     result.fileNameRelative = torrent_node_lib::deserializeString(raw, from, nextFrom);
     CHECK(nextFrom != from, "Incorrect raw ");
     from = nextFrom;
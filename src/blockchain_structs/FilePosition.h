@@ -3,12 +3,17 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <optional>
 
 namespace torrent_node_lib {
 
 struct FilePosition {
     size_t pos;
     std::string fileNameRelative;
+    //c Номер fileNameRelative в FileNamesDictionary. Если задан, сериализуется вместо имени. При смене имени сбрасывать
+    std::optional<size_t> fileId;
 
     FilePosition() = default;
 
@@ -28,6 +33,44 @@ struct FilePosition {
 
 };
 
+/**
+ *c Словарь имен файлов блоков. Номера раздаются явно при записи блока или миграции и попадают в FilePosition::fileId
+ */
+class FileNamesDictionary {
+public:
+
+    void initialize(const std::vector<std::pair<size_t, std::string>> &savedNames);
+
+    bool isInitialized() const;
+
+    /**
+     *c Возвращает номер имени и true, если запись о нем еще не сохранена в базе. Такую запись вызывающий кладет в тот же batch,
+     *c что и первые ссылающиеся на номер значения, и после записи batch вызывает confirmSaved
+     */
+    std::pair<size_t, bool> getOrAddId(const std::string &fileName);
+
+    void confirmSaved(size_t id);
+
+    std::string getName(size_t id) const;
+
+private:
+
+    mutable std::shared_mutex mut;
+
+    std::unordered_map<std::string, size_t> ids;
+
+    std::vector<std::string> names;
+
+    std::vector<bool> isSaved;
+
+    bool initialized = false;
+};
+
+/**
+ *c Словарь, через который FilePosition::deserialize восстанавливает имена по номерам
+ */
+FileNamesDictionary& getFileNamesDictionary();
+
 } // namespace torrent_node_lib
 
 #endif //TORRENT_NODE_FILEPOSITION_H
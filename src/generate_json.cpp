@@ -4,6 +4,8 @@
 
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
 #include <blockchain_structs/RejectedTxsBlock.h>
 
 #include "BlockChainReadInterface.h"
@@ -121,64 +123,172 @@ std::string genTransactionNotFoundResponse(const RequestId& requestId, const std
     return jsonToString(jsonDoc, false);
 }
 
-static rapidjson::Value transactionInfoToJson(const TransactionInfo &info, const BlockHeader &bh, size_t currentBlock, rapidjson::Document::AllocatorType &allocator, BlockTypeInfo type, const JsonVersion &version) {
+using SignaturesVariant = std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>>;
+
+/**
+ *c Потоковая генерация json без построения DOM. Writer и PrettyWriter те же, что и в jsonToString, поэтому вывод совпадает побайтно
+ */
+template<typename Func>
+static std::string streamJson(bool isFormat, const Func &func) {
+    rapidjson::StringBuffer buffer;
+    if (isFormat) {
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        func(writer);
+    } else {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        func(writer);
+    }
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+template<class Writer>
+static void writeString(Writer &writer, const std::string &str) {
+    writer.String(str.data(), static_cast<rapidjson::SizeType>(str.size()));
+}
+
+template<class Writer, typename Int>
+static void writeIntOrString(Writer &writer, Int intValue, bool isString) {
+    if (isString) {
+        writeString(writer, std::to_string(intValue));
+    } else if constexpr (std::is_signed_v<Int>) {
+        writer.Int64(intValue);
+    } else {
+        writer.Uint64(intValue);
+    }
+}
+
+template<class Writer>
+static void writeIdToResponse(const RequestId &requestId, Writer &writer) {
+    if (requestId.isSet) {
+        writer.Key("id");
+        if (std::holds_alternative<std::string>(requestId.id)) {
+            writeString(writer, std::get<std::string>(requestId.id));
+        } else {
+            writer.Uint64(std::get<size_t>(requestId.id));
+        }
+    }
+}
+
+template<typename Func>
+static std::string streamResponse(const RequestId &requestId, bool isFormat, const Func &writeResult) {
+    return streamJson(isFormat, [&requestId, &writeResult](auto &writer) {
+        writer.StartObject();
+        writeIdToResponse(requestId, writer);
+        writer.Key("result");
+        writeResult(writer);
+        writer.EndObject();
+    });
+}
+
+template<class Writer>
+static void writeHashesArray(Writer &writer, const char *name, const std::vector<std::vector<unsigned char>> &hashes) {
+    writer.Key(name);
+    writer.StartArray();
+    for (const std::vector<unsigned char> &hash: hashes) {
+        writeString(writer, toHex(hash.begin(), hash.end()));
+    }
+    writer.EndArray();
+}
+
+template<class Writer>
+static void writeTransactionInfo(Writer &writer, const TransactionInfo &info, const BlockHeader &bh, BlockTypeInfo type, const JsonVersion &version) {
     if (type == BlockTypeInfo::Full) {
         const bool isStringValue = version == JsonVersion::V2;
         
-        rapidjson::Value infoJson(rapidjson::kObjectType);
-        infoJson.AddMember("from", strToJson(info.fromAddress.calcHexString(), allocator), allocator);
-        infoJson.AddMember("to", strToJson(info.toAddress.calcHexString(), allocator), allocator);
-        infoJson.AddMember("value", intOrString(info.value, isStringValue, allocator), allocator);
-        infoJson.AddMember("transaction", strToJson(toHex(info.hash.begin(), info.hash.end()), allocator), allocator);
-        infoJson.AddMember("data", strToJson(toHex(info.data.begin(), info.data.end()), allocator), allocator);
-        infoJson.AddMember("timestamp", intOrString(bh.timestamp, isStringValue, allocator), allocator);
-        infoJson.AddMember("type", strToJson(bh.getBlockType(), allocator), allocator);
-        infoJson.AddMember("blockNumber", intOrString(info.blockNumber, isStringValue, allocator), allocator);
-        infoJson.AddMember("blockIndex", intOrString(info.blockIndex, isStringValue, allocator), allocator);
-        infoJson.AddMember("signature", strToJson(toHex(info.sign.begin(), info.sign.end()), allocator), allocator);
-        infoJson.AddMember("publickey", strToJson(toHex(info.pubKey.begin(), info.pubKey.end()), allocator), allocator);
-        infoJson.AddMember("fee", intOrString(info.fees, isStringValue, allocator), allocator);
-        infoJson.AddMember("realFee", intOrString(info.realFee(), isStringValue, allocator), allocator);
-        infoJson.AddMember("nonce", intOrString(info.nonce, isStringValue, allocator), allocator);
-        if (info.intStatus.has_value()) {
-            infoJson.AddMember("intStatus", info.intStatus.value(), allocator);
-        }
-        const auto addDelegateInfo = [&isStringValue, &allocator](const TransactionInfo &info, auto &infoJson) {
-            if (info.delegate->isDelegate) {
-                infoJson.AddMember("delegate", intOrString(info.delegate->value, isStringValue, allocator), allocator);
+        std::string status;
+        const TransactionStatus::UnDelegate *undelegateStatus = nullptr;
+        const TransactionStatus::V8Status *v8Status = nullptr;
+        if (!info.isStatusNeed()) {
+            if (!info.intStatus.has_value() || !info.isIntStatusNotSuccess()) {
+                status = "ok";
             } else {
-                infoJson.AddMember("delegate", intOrString(0, isStringValue, allocator), allocator);
+                status = "error";
             }
-            infoJson.AddMember("isDelegate", info.delegate->isDelegate, allocator);            
-        };
-        const auto addUnDelegateInfo = [&isStringValue, &allocator](const TransactionInfo &info, auto &infoJson) {
-            const TransactionStatus::UnDelegate &undelegateStatus = std::get<TransactionStatus::UnDelegate>(info.status->status);
-            infoJson.RemoveMember("delegate");
-            infoJson.AddMember("delegate", intOrString(undelegateStatus.value, isStringValue, allocator), allocator);
-            infoJson.AddMember("delegateHash", strToJson(toHex(undelegateStatus.delegateHash.begin(), undelegateStatus.delegateHash.end()), allocator), allocator);
-        };
-        const auto addScriptInfo = [&allocator](const TransactionInfo &info, auto &infoJson) {
-            const TransactionStatus::V8Status &v8Status = std::get<TransactionStatus::V8Status>(info.status->status);
-            if (!info.status->isSuccess) {
-                if (v8Status.isServerError) {
-                    infoJson.AddMember("isServerError", v8Status.isServerError, allocator);
+        } else {
+            if (!info.status.has_value()) {
+                if (info.isModuleNotSet) {
+                    status = "module_not_set";
+                } else {
+                    status = "pending";
                 }
-                if (v8Status.isScriptError) {
-                    infoJson.AddMember("isScriptError", v8Status.isScriptError, allocator);
+            } else {
+                status = info.status->isSuccess ? "ok" : "error";
+                if (std::holds_alternative<TransactionStatus::UnDelegate>(info.status->status)) {
+                    undelegateStatus = &std::get<TransactionStatus::UnDelegate>(info.status->status);
+                } else if (std::holds_alternative<TransactionStatus::V8Status>(info.status->status)) {
+                    v8Status = &std::get<TransactionStatus::V8Status>(info.status->status);
                 }
             }
-            if (!v8Status.compiledContractAddress.isEmpty()) {
-                infoJson.AddMember("contractAddress", strToJson(v8Status.compiledContractAddress.calcHexString(), allocator), allocator);
-            }
+        }
+        //c Раньше поле delegate удалялось из DOM через RemoveMember, и на его место вставал последний элемент (status). Сохраняем этот порядок полей
+        const bool isStatusOnDelegatePlace = undelegateStatus != nullptr && info.delegate.has_value();
+        
+        const auto writeUnDelegateInfo = [&writer, &isStringValue, undelegateStatus]() {
+            writer.Key("delegate");
+            writeIntOrString(writer, undelegateStatus->value, isStringValue);
+            writer.Key("delegateHash");
+            writeString(writer, toHex(undelegateStatus->delegateHash.begin(), undelegateStatus->delegateHash.end()));
         };
+        
+        writer.StartObject();
+        writer.Key("from");
+        writeString(writer, info.fromAddress.calcHexString());
+        writer.Key("to");
+        writeString(writer, info.toAddress.calcHexString());
+        writer.Key("value");
+        writeIntOrString(writer, info.value, isStringValue);
+        writer.Key("transaction");
+        writeString(writer, toHex(info.hash.begin(), info.hash.end()));
+        writer.Key("data");
+        writeString(writer, toHex(info.data.begin(), info.data.end()));
+        writer.Key("timestamp");
+        writeIntOrString(writer, bh.timestamp, isStringValue);
+        writer.Key("type");
+        writeString(writer, bh.getBlockType());
+        writer.Key("blockNumber");
+        writeIntOrString(writer, info.blockNumber, isStringValue);
+        writer.Key("blockIndex");
+        writeIntOrString(writer, info.blockIndex, isStringValue);
+        writer.Key("signature");
+        writeString(writer, toHex(info.sign.begin(), info.sign.end()));
+        writer.Key("publickey");
+        writeString(writer, toHex(info.pubKey.begin(), info.pubKey.end()));
+        writer.Key("fee");
+        writeIntOrString(writer, info.fees, isStringValue);
+        writer.Key("realFee");
+        writeIntOrString(writer, info.realFee(), isStringValue);
+        writer.Key("nonce");
+        writeIntOrString(writer, info.nonce, isStringValue);
+        if (info.intStatus.has_value()) {
+            writer.Key("intStatus");
+            writer.Uint64(info.intStatus.value());
+        }
         if (info.delegate.has_value()) {
-            addDelegateInfo(info, infoJson);
-            rapidjson::Value delegateInfoJson(rapidjson::kObjectType);
-            addDelegateInfo(info, delegateInfoJson);
-            infoJson.AddMember("delegate_info", delegateInfoJson, allocator);
+            if (isStatusOnDelegatePlace) {
+                writer.Key("status");
+                writeString(writer, status);
+            } else {
+                writer.Key("delegate");
+                writeIntOrString(writer, info.delegate->isDelegate ? info.delegate->value : 0, isStringValue);
+            }
+            writer.Key("isDelegate");
+            writer.Bool(info.delegate->isDelegate);
+            
+            writer.Key("delegate_info");
+            writer.StartObject();
+            if (undelegateStatus != nullptr) {
+                writer.Key("isDelegate");
+                writer.Bool(info.delegate->isDelegate);
+                writeUnDelegateInfo();
+            } else {
+                writer.Key("delegate");
+                writeIntOrString(writer, info.delegate->isDelegate ? info.delegate->value : 0, isStringValue);
+                writer.Key("isDelegate");
+                writer.Bool(info.delegate->isDelegate);
+            }
+            writer.EndObject();
         }
         if (info.scriptInfo.has_value()) {
-            rapidjson::Value scriptInfoJson(rapidjson::kObjectType);
             std::string scriptType;
             const TransactionInfo::ScriptInfo::ScriptType type = info.scriptInfo->type;
             if (type == TransactionInfo::ScriptInfo::ScriptType::compile) {
@@ -192,120 +302,147 @@ static rapidjson::Value transactionInfoToJson(const TransactionInfo &info, const
             } else {
                 throwErr("Unknown scriptinfo type");
             }
-            scriptInfoJson.AddMember("type", strToJson(scriptType, allocator), allocator);
-            infoJson.AddMember("script_info", scriptInfoJson, allocator);
+            writer.Key("script_info");
+            writer.StartObject();
+            writer.Key("type");
+            writeString(writer, scriptType);
+            if (v8Status != nullptr) {
+                if (!info.status->isSuccess) {
+                    if (v8Status->isServerError) {
+                        writer.Key("isServerError");
+                        writer.Bool(v8Status->isServerError);
+                    }
+                    if (v8Status->isScriptError) {
+                        writer.Key("isScriptError");
+                        writer.Bool(v8Status->isScriptError);
+                    }
+                }
+                if (!v8Status->compiledContractAddress.isEmpty()) {
+                    writer.Key("contractAddress");
+                    writeString(writer, v8Status->compiledContractAddress.calcHexString());
+                }
+            }
+            writer.EndObject();
         }
         if (info.tokenInfo.has_value()) {
-            rapidjson::Value tokenInfoJson(rapidjson::kObjectType);
             if (std::holds_alternative<TransactionInfo::TokenInfo::Create>(info.tokenInfo.value().info)) {
                 const TransactionInfo::TokenInfo::Create &createToken = std::get<TransactionInfo::TokenInfo::Create>(info.tokenInfo.value().info);
                 
-                tokenInfoJson.AddMember("type", strToJson(createToken.type, allocator), allocator);
-                tokenInfoJson.AddMember("name", strToJson(createToken.name, allocator), allocator);
-                tokenInfoJson.AddMember("symbol", strToJson(createToken.symbol, allocator), allocator);
-                tokenInfoJson.AddMember("owner", strToJson(createToken.owner.calcHexString(), allocator), allocator);
-                tokenInfoJson.AddMember("decimals", createToken.decimals, allocator);
-                tokenInfoJson.AddMember("total", intOrString(info.value, isStringValue, allocator), allocator);
-                tokenInfoJson.AddMember("emission", createToken.emission, allocator);
-                
-                infoJson.AddMember("create_token", tokenInfoJson, allocator);
+                writer.Key("create_token");
+                writer.StartObject();
+                writer.Key("type");
+                writeString(writer, createToken.type);
+                writer.Key("name");
+                writeString(writer, createToken.name);
+                writer.Key("symbol");
+                writeString(writer, createToken.symbol);
+                writer.Key("owner");
+                writeString(writer, createToken.owner.calcHexString());
+                writer.Key("decimals");
+                writer.Int(createToken.decimals);
+                writer.Key("total");
+                writeIntOrString(writer, info.value, isStringValue);
+                writer.Key("emission");
+                writer.Bool(createToken.emission);
+                writer.EndObject();
             } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeOwner>(info.tokenInfo.value().info)) {
                 const TransactionInfo::TokenInfo::ChangeOwner &changeOwner = std::get<TransactionInfo::TokenInfo::ChangeOwner>(info.tokenInfo.value().info);
                 
-                tokenInfoJson.AddMember("newOwner", strToJson(changeOwner.newOwner.calcHexString(), allocator), allocator);
-                
-                infoJson.AddMember("change_token_owner", tokenInfoJson, allocator);
+                writer.Key("change_token_owner");
+                writer.StartObject();
+                writer.Key("newOwner");
+                writeString(writer, changeOwner.newOwner.calcHexString());
+                writer.EndObject();
             } else if (std::holds_alternative<TransactionInfo::TokenInfo::ChangeEmission>(info.tokenInfo.value().info)) {
                 const TransactionInfo::TokenInfo::ChangeEmission &changeEmission = std::get<TransactionInfo::TokenInfo::ChangeEmission>(info.tokenInfo.value().info);
                 
-                tokenInfoJson.AddMember("newEmission", changeEmission.newEmission, allocator);
-                
-                infoJson.AddMember("change_emission_owner", tokenInfoJson, allocator);
+                writer.Key("change_emission_owner");
+                writer.StartObject();
+                writer.Key("newEmission");
+                writer.Bool(changeEmission.newEmission);
+                writer.EndObject();
             } else if (std::holds_alternative<TransactionInfo::TokenInfo::AddTokens>(info.tokenInfo.value().info)) {
                 const TransactionInfo::TokenInfo::AddTokens &addTokens = std::get<TransactionInfo::TokenInfo::AddTokens>(info.tokenInfo.value().info);
                 
-                tokenInfoJson.AddMember("toAddress", strToJson(addTokens.toAddress.calcHexString(), allocator), allocator);
-                tokenInfoJson.AddMember("value", intOrString(addTokens.value, isStringValue, allocator), allocator);
-                
-                infoJson.AddMember("add_tokens", tokenInfoJson, allocator);
+                writer.Key("add_tokens");
+                writer.StartObject();
+                writer.Key("toAddress");
+                writeString(writer, addTokens.toAddress.calcHexString());
+                writer.Key("value");
+                writeIntOrString(writer, addTokens.value, isStringValue);
+                writer.EndObject();
             } else if (std::holds_alternative<TransactionInfo::TokenInfo::MoveTokens>(info.tokenInfo.value().info)) {
                 const TransactionInfo::TokenInfo::MoveTokens &addTokens = std::get<TransactionInfo::TokenInfo::MoveTokens>(info.tokenInfo.value().info);
                 
-                tokenInfoJson.AddMember("toAddress", strToJson(addTokens.toAddress.calcHexString(), allocator), allocator);
-                tokenInfoJson.AddMember("value", intOrString(addTokens.value, isStringValue, allocator), allocator);
-                
-                infoJson.AddMember("move_tokens", tokenInfoJson, allocator);
+                writer.Key("move_tokens");
+                writer.StartObject();
+                writer.Key("toAddress");
+                writeString(writer, addTokens.toAddress.calcHexString());
+                writer.Key("value");
+                writeIntOrString(writer, addTokens.value, isStringValue);
+                writer.EndObject();
             } else {
                 throwErr("Unknown tokeninfo type");
-            }           
-        }
-        if (!info.isStatusNeed()) {
-            if (!info.intStatus.has_value() || !info.isIntStatusNotSuccess()) {
-                infoJson.AddMember("status", strToJson("ok", allocator), allocator);
-            } else {
-                infoJson.AddMember("status", strToJson("error", allocator), allocator);
-            }
-        } else {
-            if (!info.status.has_value()) {
-                if (info.isModuleNotSet) {
-                    infoJson.AddMember("status", strToJson("module_not_set", allocator), allocator);
-                } else {
-                    infoJson.AddMember("status", strToJson("pending", allocator), allocator);
-                }
-            } else {
-                infoJson.AddMember("status", strToJson(info.status->isSuccess ? "ok" : "error", allocator), allocator);
-                if (std::holds_alternative<TransactionStatus::Delegate>(info.status->status)) {
-                    // empty
-                } else if (std::holds_alternative<TransactionStatus::UnDelegate>(info.status->status)) {
-                    addUnDelegateInfo(info, infoJson);
-                    addUnDelegateInfo(info, infoJson["delegate_info"]);
-                } else if (std::holds_alternative<TransactionStatus::V8Status>(info.status->status)) {
-                    addScriptInfo(info, infoJson["script_info"]);
-                }
             }
         }
-        return infoJson;
+        if (!isStatusOnDelegatePlace) {
+            writer.Key("status");
+            writeString(writer, status);
+        }
+        if (undelegateStatus != nullptr) {
+            writeUnDelegateInfo();
+        }
+        writer.EndObject();
     } else if (type == BlockTypeInfo::Hashes) {
-        return strToJson(toHex(info.hash.begin(), info.hash.end()), allocator);
+        writeString(writer, toHex(info.hash.begin(), info.hash.end()));
     } else {
         throwUserErr("Incorrect transaction info type");
     }
 }
 
-static rapidjson::Value signTransactionInfoToJson(const SignTransactionInfo &info, rapidjson::Document::AllocatorType &allocator, const JsonVersion &version) {
-    rapidjson::Value infoJson(rapidjson::kObjectType);
-    infoJson.AddMember("blockHash", strToJson(toHex(info.blockHash.begin(), info.blockHash.end()), allocator), allocator);
-    infoJson.AddMember("signature", strToJson(toHex(info.sign.begin(), info.sign.end()), allocator), allocator);
-    infoJson.AddMember("publickey", strToJson(toHex(info.pubkey.begin(), info.pubkey.end()), allocator), allocator);
-    infoJson.AddMember("address", strToJson(info.address.calcHexString(), allocator), allocator);
-    return infoJson;
+template<class Writer>
+static void writeSignTransactionInfo(Writer &writer, const SignTransactionInfo &info, const JsonVersion &version) {
+    writer.StartObject();
+    writer.Key("blockHash");
+    writeString(writer, toHex(info.blockHash.begin(), info.blockHash.end()));
+    writer.Key("signature");
+    writeString(writer, toHex(info.sign.begin(), info.sign.end()));
+    writer.Key("publickey");
+    writeString(writer, toHex(info.pubkey.begin(), info.pubkey.end()));
+    writer.Key("address");
+    writeString(writer, info.address.calcHexString());
+    writer.EndObject();
+}
+
+template<class Writer>
+static void writeTransactionsInfo(Writer &writer, const std::vector<TransactionInfo> &infos, const BlockChainReadInterface &blockchain, const JsonVersion &version) {
+    writer.StartArray();
+    for (const TransactionInfo &tx: infos) {
+        const BlockHeader &bh = blockchain.getBlock(tx.blockNumber);
+        writeTransactionInfo(writer, tx, bh, BlockTypeInfo::Full, version);
+    }
+    writer.EndArray();
 }
 
 std::string transactionToJson(const RequestId &requestId, const TransactionInfo &info, const BlockChainReadInterface &blockchain, size_t countBlocks, size_t knwonBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultValue(rapidjson::kObjectType);
     const BlockHeader &bh = blockchain.getBlock(info.blockNumber);
     CHECK(bh.blockNumber.has_value(), "Block not found: " + std::to_string(info.blockNumber));
-    resultValue.AddMember("transaction", transactionInfoToJson(info, bh, 0, allocator, BlockTypeInfo::Full, version), allocator);
-    resultValue.AddMember("countBlocks", countBlocks, allocator);
-    resultValue.AddMember("knownBlocks", knwonBlock, allocator);
-    doc.AddMember("result", resultValue, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writer.StartObject();
+        writer.Key("transaction");
+        writeTransactionInfo(writer, info, bh, BlockTypeInfo::Full, version);
+        writer.Key("countBlocks");
+        writer.Uint64(countBlocks);
+        writer.Key("knownBlocks");
+        writer.Uint64(knwonBlock);
+        writer.EndObject();
+    });
 }
 
 std::string transactionsToJson(const RequestId &requestId, const std::vector<TransactionInfo> &infos, const torrent_node_lib::BlockChainReadInterface &blockchain, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultValue(rapidjson::kArrayType);
-    for (const TransactionInfo &tx: infos) {
-        const BlockHeader &bh = blockchain.getBlock(tx.blockNumber);
-        resultValue.PushBack(transactionInfoToJson(tx, bh, 0, allocator, BlockTypeInfo::Full, version), allocator);
-    }
-    doc.AddMember("result", resultValue, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeTransactionsInfo(writer, infos, blockchain, version);
+    });
 }
 
 std::string tokenToJson(const RequestId &requestId, const Token &info, bool isFormat, const JsonVersion &version) {
@@ -326,280 +463,291 @@ std::string tokenToJson(const RequestId &requestId, const Token &info, bool isFo
 }
 
 std::string addressesInfoToJson(const RequestId &requestId, const std::string &address, const std::vector<TransactionInfo> &infos, const BlockChainReadInterface &blockchain, size_t currentBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultValue(rapidjson::kArrayType);
-    for (const TransactionInfo &tx: infos) {
-        const BlockHeader &bh = blockchain.getBlock(tx.blockNumber);
-        resultValue.PushBack(transactionInfoToJson(tx, bh, currentBlock, allocator, BlockTypeInfo::Full, version), allocator);
-    }
-    doc.AddMember("result", resultValue, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeTransactionsInfo(writer, infos, blockchain, version);
+    });
 }
 
 std::string addressesInfoToJsonFilter(const RequestId &requestId, const std::string &address, const std::vector<TransactionInfo> &infos, size_t nextFrom, const torrent_node_lib::BlockChainReadInterface &blockchain, size_t currentBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultValue(rapidjson::kObjectType);
-    rapidjson::Value txsValue(rapidjson::kArrayType);
-    for (const TransactionInfo &tx: infos) {
-        const BlockHeader &bh = blockchain.getBlock(tx.blockNumber);
-        txsValue.PushBack(transactionInfoToJson(tx, bh, currentBlock, allocator, BlockTypeInfo::Full, version), allocator);
-    }
-    resultValue.AddMember("txs", txsValue, allocator);
-    resultValue.AddMember("nextFrom", nextFrom, allocator);
-    doc.AddMember("result", resultValue, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writer.StartObject();
+        writer.Key("txs");
+        writeTransactionsInfo(writer, infos, blockchain, version);
+        writer.Key("nextFrom");
+        writer.Uint64(nextFrom);
+        writer.EndObject();
+    });
+}
+
+std::string addressesInfoToJsonCursor(const RequestId &requestId, const std::string &address, const std::vector<TransactionInfo> &infos, const std::optional<std::string> &nextCursor, const torrent_node_lib::BlockChainReadInterface &blockchain, size_t currentBlock, bool isFormat, const JsonVersion &version) {
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writer.StartObject();
+        writer.Key("txs");
+        writeTransactionsInfo(writer, infos, blockchain, version);
+        if (nextCursor.has_value()) {
+            writer.Key("nextCursor");
+            writeString(writer, nextCursor.value());
+        }
+        writer.EndObject();
+    });
 }
 
-static rapidjson::Value balanceInfoToJson(const std::string &address, const BalanceInfo &balance, size_t currentBlock, rapidjson::Document::AllocatorType &allocator, const JsonVersion &version) {
+template<class Writer>
+static void writeBalanceInfo(Writer &writer, const std::string &address, const BalanceInfo &balance, size_t currentBlock, const JsonVersion &version) {
     const bool isStringValue = version == JsonVersion::V2;
-    rapidjson::Value resultValue(rapidjson::kObjectType);
-    resultValue.AddMember("address", strToJson(address, allocator), allocator);
-    resultValue.AddMember("received", intOrString(balance.received(), isStringValue, allocator), allocator);
-    resultValue.AddMember("spent", intOrString(balance.spent(), isStringValue, allocator), allocator);
-    resultValue.AddMember("count_received", intOrString(balance.countReceived, isStringValue, allocator), allocator);
-    resultValue.AddMember("count_spent", intOrString(balance.countSpent, isStringValue, allocator), allocator);
-    resultValue.AddMember("count_txs", intOrString(balance.countTxs, isStringValue, allocator), allocator);
-    resultValue.AddMember("block_number", intOrString(balance.blockNumber, isStringValue, allocator), allocator);
-    resultValue.AddMember("currentBlock", intOrString(currentBlock, isStringValue, allocator), allocator);
+    writer.StartObject();
+    writer.Key("address");
+    writeString(writer, address);
+    writer.Key("received");
+    writeIntOrString(writer, balance.received(), isStringValue);
+    writer.Key("spent");
+    writeIntOrString(writer, balance.spent(), isStringValue);
+    writer.Key("count_received");
+    writeIntOrString(writer, balance.countReceived, isStringValue);
+    writer.Key("count_spent");
+    writeIntOrString(writer, balance.countSpent, isStringValue);
+    writer.Key("count_txs");
+    writeIntOrString(writer, balance.countTxs, isStringValue);
+    writer.Key("block_number");
+    writeIntOrString(writer, balance.blockNumber, isStringValue);
+    writer.Key("currentBlock");
+    writeIntOrString(writer, currentBlock, isStringValue);
     if (balance.hash.has_value()) {
-        resultValue.AddMember("hash", intOrString(balance.hash.value(), true, allocator), allocator);
+        writer.Key("hash");
+        writeIntOrString(writer, balance.hash.value(), true);
     }
     if (balance.delegated.has_value()) {
-        resultValue.AddMember("countDelegatedOps", intOrString(balance.delegated->countOp, isStringValue, allocator), allocator);
-        resultValue.AddMember("delegate", intOrString(balance.delegated->delegate.delegate(), isStringValue, allocator), allocator);
-        resultValue.AddMember("undelegate", intOrString(balance.delegated->delegate.undelegate(), isStringValue, allocator), allocator);
-        resultValue.AddMember("delegated", intOrString(balance.delegated->delegated.delegated(), isStringValue, allocator), allocator);
-        resultValue.AddMember("undelegated", intOrString(balance.delegated->delegated.undelegated(), isStringValue, allocator), allocator);
-        resultValue.AddMember("reserved", intOrString(balance.delegated->reserved, isStringValue, allocator), allocator);
+        writer.Key("countDelegatedOps");
+        writeIntOrString(writer, balance.delegated->countOp, isStringValue);
+        writer.Key("delegate");
+        writeIntOrString(writer, balance.delegated->delegate.delegate(), isStringValue);
+        writer.Key("undelegate");
+        writeIntOrString(writer, balance.delegated->delegate.undelegate(), isStringValue);
+        writer.Key("delegated");
+        writeIntOrString(writer, balance.delegated->delegated.delegated(), isStringValue);
+        writer.Key("undelegated");
+        writeIntOrString(writer, balance.delegated->delegated.undelegated(), isStringValue);
+        writer.Key("reserved");
+        writeIntOrString(writer, balance.delegated->reserved, isStringValue);
     }
     if (balance.forged.has_value()) {
-        resultValue.AddMember("countForgedOps", intOrString(balance.forged->countOp, isStringValue, allocator), allocator);
-        resultValue.AddMember("forged", intOrString(balance.forged->forged, isStringValue, allocator), allocator);
+        writer.Key("countForgedOps");
+        writeIntOrString(writer, balance.forged->countOp, isStringValue);
+        writer.Key("forged");
+        writeIntOrString(writer, balance.forged->forged, isStringValue);
     }
     if (balance.tokenBlockNumber.has_value()) {
-        resultValue.AddMember("token_block_number", intOrString(balance.tokenBlockNumber.value(), isStringValue, allocator), allocator);
+        writer.Key("token_block_number");
+        writeIntOrString(writer, balance.tokenBlockNumber.value(), isStringValue);
     }
-    return resultValue;
+    writer.EndObject();
 }
 
-static rapidjson::Value balanceInfoTokensToJson(const std::string &address, const BalanceInfo &balance, size_t currentBlock, rapidjson::Document::AllocatorType &allocator, const JsonVersion &version) {
+template<class Writer>
+static void writeBalanceInfoTokens(Writer &writer, const std::string &address, const BalanceInfo &balance, size_t currentBlock, const JsonVersion &version) {
     const bool isStringValue = version == JsonVersion::V2;
-    rapidjson::Value resultValue(rapidjson::kObjectType);
-    resultValue.AddMember("block_number", intOrString(balance.blockNumber, isStringValue, allocator), allocator);
-    resultValue.AddMember("currentBlock", intOrString(currentBlock, isStringValue, allocator), allocator);
+    writer.StartObject();
+    writer.Key("block_number");
+    writeIntOrString(writer, balance.blockNumber, isStringValue);
+    writer.Key("currentBlock");
+    writeIntOrString(writer, currentBlock, isStringValue);
     if (balance.hash.has_value()) {
-        resultValue.AddMember("hash", intOrString(balance.hash.value(), true, allocator), allocator);
+        writer.Key("hash");
+        writeIntOrString(writer, balance.hash.value(), true);
     }
     if (!balance.tokens.empty()) {
-        rapidjson::Value tokens(rapidjson::kArrayType);
+        writer.Key("tokens");
+        writer.StartArray();
         for (const auto &[token, b]: balance.tokens) {
-            rapidjson::Value tokenJson(rapidjson::kObjectType);
-            
             const Address tokenAddress(token.begin(), token.end());
-            tokenJson.AddMember("address", strToJson(tokenAddress.calcHexString(), allocator), allocator);
-            tokenJson.AddMember("received", intOrString(b.balance.received(), isStringValue, allocator), allocator);
-            tokenJson.AddMember("spent", intOrString(b.balance.spent(), isStringValue, allocator), allocator);
-            tokenJson.AddMember("value", intOrString(b.balance.balance(), isStringValue, allocator), allocator);
-            tokenJson.AddMember("count_received", intOrString(b.countReceived, isStringValue, allocator), allocator);
-            tokenJson.AddMember("count_spent", intOrString(b.countSpent, isStringValue, allocator), allocator);
-            tokenJson.AddMember("count_txs", intOrString(b.countOp, isStringValue, allocator), allocator);
             
-            tokens.PushBack(tokenJson, allocator);
+            writer.StartObject();
+            writer.Key("address");
+            writeString(writer, tokenAddress.calcHexString());
+            writer.Key("received");
+            writeIntOrString(writer, b.balance.received(), isStringValue);
+            writer.Key("spent");
+            writeIntOrString(writer, b.balance.spent(), isStringValue);
+            writer.Key("value");
+            writeIntOrString(writer, b.balance.balance(), isStringValue);
+            writer.Key("count_received");
+            writeIntOrString(writer, b.countReceived, isStringValue);
+            writer.Key("count_spent");
+            writeIntOrString(writer, b.countSpent, isStringValue);
+            writer.Key("count_txs");
+            writeIntOrString(writer, b.countOp, isStringValue);
+            writer.EndObject();
         }
-        resultValue.AddMember("tokens", tokens, allocator);
+        writer.EndArray();
         if (balance.tokenBlockNumber.has_value()) {
-            resultValue.AddMember("token_block_number", intOrString(balance.tokenBlockNumber.value(), isStringValue, allocator), allocator);
+            writer.Key("token_block_number");
+            writeIntOrString(writer, balance.tokenBlockNumber.value(), isStringValue);
         }
     }
-    return resultValue;
+    writer.EndObject();
 }
 
 std::string balanceInfoToJson(const RequestId &requestId, const std::string &address, const BalanceInfo &balance, size_t currentBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    doc.AddMember("result", balanceInfoToJson(address, balance, currentBlock, allocator, version), allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBalanceInfo(writer, address, balance, currentBlock, version);
+    });
 }
 
 std::string balanceTokenInfoToJson(const RequestId &requestId, const std::string &address, const BalanceInfo &balance, size_t currentBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    doc.AddMember("result", balanceInfoTokensToJson(address, balance, currentBlock, allocator, version), allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBalanceInfoTokens(writer, address, balance, currentBlock, version);
+    });
 }
 
 std::string balancesInfoToJson(const RequestId &requestId, const std::vector<std::pair<std::string, BalanceInfo>> &balances, size_t currentBlock, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value result(rapidjson::kArrayType);
-    for (size_t i = 0; i < balances.size(); i++) {
-        const std::string &address = balances[i].first;
-        const BalanceInfo &balance = balances[i].second;
-        
-        result.PushBack(balanceInfoToJson(address, balance, currentBlock, allocator, version), allocator);
-    }
-    doc.AddMember("result", result, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writer.StartArray();
+        for (const auto &[address, balance]: balances) {
+            writeBalanceInfo(writer, address, balance, currentBlock, version);
+        }
+        writer.EndArray();
+    });
 }
 
-static rapidjson::Value blockHeaderToJson(const BlockHeader &bh, const std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>> &signatures, rapidjson::Document::AllocatorType &allocator, BlockTypeInfo type, const JsonVersion &version) {
+/**
+ *c writeExtraFields дописывает поля в конец объекта блока перед его закрытием
+ */
+template<class Writer, typename Func>
+static void writeBlockHeader(Writer &writer, const BlockHeader &bh, const SignaturesVariant &signatures, BlockTypeInfo type, const JsonVersion &version, const Func &writeExtraFields) {
     const bool isStringValue = version == JsonVersion::V2;
     
     CHECK(bh.blockNumber.has_value(), "Block header not set");
-    rapidjson::Value resultValue(rapidjson::kObjectType);
+    writer.StartObject();
     if (type == BlockTypeInfo::Simple) {
-        resultValue.AddMember("type", strToJson(bh.getBlockType(), allocator), allocator);
+        writer.Key("type");
+        writeString(writer, bh.getBlockType());
     }
-    resultValue.AddMember("hash", strToJson(toHex(bh.hash), allocator), allocator);
-    resultValue.AddMember("prev_hash", strToJson(toHex(bh.prevHash), allocator), allocator);
+    writer.Key("hash");
+    writeString(writer, toHex(bh.hash));
+    writer.Key("prev_hash");
+    writeString(writer, toHex(bh.prevHash));
     if (type == BlockTypeInfo::Simple) {
-        resultValue.AddMember("tx_hash", strToJson(toHex(bh.txsHash), allocator), allocator);
+        writer.Key("tx_hash");
+        writeString(writer, toHex(bh.txsHash));
     }
-    resultValue.AddMember("number", intOrString(bh.blockNumber.value(), isStringValue, allocator), allocator);
+    writer.Key("number");
+    writeIntOrString(writer, bh.blockNumber.value(), isStringValue);
     if (type == BlockTypeInfo::Simple) {
-        resultValue.AddMember("timestamp", intOrString(bh.timestamp, isStringValue, allocator), allocator);
-        resultValue.AddMember("count_txs", intOrString(bh.countTxs, isStringValue, allocator), allocator);
-        resultValue.AddMember("sign", strToJson(toHex(bh.signature), allocator), allocator);
+        writer.Key("timestamp");
+        writeIntOrString(writer, bh.timestamp, isStringValue);
+        writer.Key("count_txs");
+        writeIntOrString(writer, bh.countTxs, isStringValue);
+        writer.Key("sign");
+        writeString(writer, toHex(bh.signature));
     }
     if (type != BlockTypeInfo::Small) {
-        resultValue.AddMember("size", bh.blockSize, allocator);
-        resultValue.AddMember("fileName", strToJson(bh.filePos.fileNameRelative, allocator), allocator);
+        writer.Key("size");
+        writer.Uint64(bh.blockSize);
+        writer.Key("fileName");
+        writeString(writer, bh.filePos.fileNameRelative);
     }
     
     if (type == BlockTypeInfo::Simple) {
-        rapidjson::Value signaturesValue(rapidjson::kArrayType);
+        writer.Key("signatures");
+        writer.StartArray();
         if (std::holds_alternative<std::vector<TransactionInfo>>(signatures)) {
             for (const TransactionInfo &tx: std::get<std::vector<TransactionInfo>>(signatures)) {
-                signaturesValue.PushBack(transactionInfoToJson(tx, bh, 0, allocator, BlockTypeInfo::Full, version), allocator);
+                writeTransactionInfo(writer, tx, bh, BlockTypeInfo::Full, version);
             }
         } else {
             for (const SignTransactionInfo &tx: std::get<std::vector<SignTransactionInfo>>(signatures)) {
-                signaturesValue.PushBack(signTransactionInfoToJson(tx, allocator, version), allocator);
+                writeSignTransactionInfo(writer, tx, version);
             }
         }
-        resultValue.AddMember("signatures", signaturesValue, allocator);
+        writer.EndArray();
     }
-    return resultValue;
+    writeExtraFields(writer);
+    writer.EndObject();
 }
 
-std::string blockHeaderToJson(const RequestId &requestId, const BlockHeader &bh, const std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>> &signatures, bool isFormat, BlockTypeInfo type, const JsonVersion &version) {
+template<class Writer>
+static void writeBlockHeader(Writer &writer, const BlockHeader &bh, const SignaturesVariant &signatures, BlockTypeInfo type, const JsonVersion &version) {
+    writeBlockHeader(writer, bh, signatures, type, version, [](auto &) {});
+}
+
+std::string blockHeaderToJson(const RequestId &requestId, const BlockHeader &bh, const SignaturesVariant &signatures, bool isFormat, BlockTypeInfo type, const JsonVersion &version) {
     if (bh.blockNumber == 0) {
         return genErrorResponse(requestId, -32603, "Incorrect block number: 0. Genesis block begin with number 1");
     }
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    doc.AddMember("result", blockHeaderToJson(bh, signatures, allocator, type, version), allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBlockHeader(writer, bh, signatures, type, version);
+    });
 }
 
 std::string blockHeaderToP2PJson(const RequestId &requestId, const torrent_node_lib::BlockHeader &bh, const std::vector<std::vector<unsigned char>> &prevSignaturesBlocks, const std::vector<std::vector<unsigned char>> &nextSignaturesBlocks, bool isFormat, BlockTypeInfo type, const JsonVersion &version) {
     if (bh.blockNumber == 0) {
         return genErrorResponse(requestId, -32603, "Incorrect block number: 0. Genesis block begin with number 1");
     }
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultVal = blockHeaderToJson(bh, {}, allocator, type, version);
-    
-    const auto makeSignatures = [&allocator](rapidjson::Value &resultVal, const std::string &name, const std::vector<std::vector<unsigned char>> &signaturesBlocks) {
-        rapidjson::Value signatures(rapidjson::kArrayType);
-        for (const std::vector<unsigned char> &signBlock: signaturesBlocks) {
-            signatures.PushBack(strToJson(toHex(signBlock.begin(), signBlock.end()), allocator), allocator);
-        }
-        resultVal.AddMember(strToJson(name, allocator), signatures, allocator);
-    };
-    
-    makeSignatures(resultVal, "next_extra_blocks", nextSignaturesBlocks);
-    makeSignatures(resultVal, "prev_extra_blocks", prevSignaturesBlocks);
-    
-    doc.AddMember("result", resultVal, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBlockHeader(writer, bh, {}, type, version, [&](auto &writer) {
+            writeHashesArray(writer, "next_extra_blocks", nextSignaturesBlocks);
+            writeHashesArray(writer, "prev_extra_blocks", prevSignaturesBlocks);
+        });
+    });
 }
 
-std::string blockHeadersToJson(const RequestId &requestId, const std::vector<BlockHeader> &bh, const std::vector<std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>>> &signatures, BlockTypeInfo type, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value vals(rapidjson::kArrayType);
+std::string blockHeadersToJson(const RequestId &requestId, const std::vector<BlockHeader> &bh, const std::vector<SignaturesVariant> &signatures, BlockTypeInfo type, bool isFormat, const JsonVersion &version) {
     CHECK(bh.size() + 1 == signatures.size(), "Incorrect signatures vect");
-    for (size_t i = 0; i < bh.size(); i++) {
-        const BlockHeader &b  = bh[i];
-        const std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>> signature = signatures[i + 1];
-        
+    for (const BlockHeader &b: bh) {
         if (b.blockNumber == 0) {
             return genErrorResponse(requestId, -32603, "Incorrect block number: 0. Genesis block begin with number 1");
         }
-        vals.PushBack(blockHeaderToJson(b, signature, allocator, type, version), allocator);
     }
-    doc.AddMember("result", vals, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writer.StartArray();
+        for (size_t i = 0; i < bh.size(); i++) {
+            writeBlockHeader(writer, bh[i], signatures[i + 1], type, version);
+        }
+        writer.EndArray();
+    });
 }
 
-static rapidjson::Value blockHeadersToP2PJsonImpl(const std::vector<torrent_node_lib::BlockHeader> &bh, const std::vector<std::vector<std::vector<unsigned char>>> &blockSignatures, rapidjson::Document::AllocatorType &allocator, const JsonVersion &version) {
-    rapidjson::Value vals(rapidjson::kArrayType);
+template<class Writer>
+static void writeBlockHeadersToP2P(Writer &writer, const std::vector<torrent_node_lib::BlockHeader> &bh, const std::vector<std::vector<std::vector<unsigned char>>> &blockSignatures, const JsonVersion &version) {
     CHECK(bh.empty() || bh.size() + 1 == blockSignatures.size(), "Incorrect signatures vect");
+    writer.StartArray();
     for (size_t i = 0; i < bh.size(); i++) {
-        const BlockHeader &b  = bh[i];
         const std::vector<std::vector<unsigned char>> &prevSignature = blockSignatures[i];
         const std::vector<std::vector<unsigned char>> &nextSignature = blockSignatures[i + 1];
-               
-        rapidjson::Value res = blockHeaderToJson(b, {}, allocator, BlockTypeInfo::ForP2P, version);
         
-        const auto makeSignatures = [&allocator](rapidjson::Value &resultVal, const std::string &name, const std::vector<std::vector<unsigned char>> &signaturesBlocks) {
-            rapidjson::Value signatures(rapidjson::kArrayType);
-            for (const std::vector<unsigned char> &signBlock: signaturesBlocks) {
-                signatures.PushBack(strToJson(toHex(signBlock.begin(), signBlock.end()), allocator), allocator);
+        writeBlockHeader(writer, bh[i], {}, BlockTypeInfo::ForP2P, version, [&](auto &writer) {
+            if (i == bh.size() - 1) {
+                writeHashesArray(writer, "next_extra_blocks", nextSignature);
             }
-            resultVal.AddMember(strToJson(name, allocator), signatures, allocator);
-        };
-        
-        if (i == bh.size() - 1) {
-            makeSignatures(res, "next_extra_blocks", nextSignature);
-        }
-        makeSignatures(res, "prev_extra_blocks", prevSignature);
-        
-        vals.PushBack(res, allocator);
+            writeHashesArray(writer, "prev_extra_blocks", prevSignature);
+        });
     }
-    return vals;
+    writer.EndArray();
 }
 
 std::string blockHeadersToP2PJson(const RequestId &requestId, const std::vector<torrent_node_lib::BlockHeader> &bh, const std::vector<std::vector<std::vector<unsigned char>>> &blockSignatures, bool isFormat, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    
-    rapidjson::Value vals = blockHeadersToP2PJsonImpl(bh, blockSignatures, allocator, version);
-
-    doc.AddMember("result", vals, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBlockHeadersToP2P(writer, bh, blockSignatures, version);
+    });
 }
 
-std::string blockInfoToJson(const RequestId &requestId, const BlockInfo &bi, const std::variant<std::vector<TransactionInfo>, std::vector<SignTransactionInfo>> &signatures, BlockTypeInfo type, bool isFormat, const JsonVersion &version) {
+std::string blockInfoToJson(const RequestId &requestId, const BlockInfo &bi, const SignaturesVariant &signatures, BlockTypeInfo type, bool isFormat, const JsonVersion &version) {
     const BlockHeader &bh = bi.header;
     
     if (bh.blockNumber == 0) {
         return genErrorResponse(requestId, -32603, "Incorrect block number: 0. Genesis block begin with number 1");
     }
     
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    addIdToResponse(requestId, doc, allocator);
-    rapidjson::Value resultValue = blockHeaderToJson(bh, signatures, allocator, BlockTypeInfo::Simple, version);
-    rapidjson::Value txs(rapidjson::kArrayType);
-    for (const TransactionInfo &tx: bi.txs) {
-        txs.PushBack(transactionInfoToJson(tx, bi.header, 0, allocator, type, version), allocator);
-    }
-    resultValue.AddMember("txs", txs, allocator);
-    doc.AddMember("result", resultValue, allocator);
-    return jsonToString(doc, isFormat);
+    return streamResponse(requestId, isFormat, [&](auto &writer) {
+        writeBlockHeader(writer, bh, signatures, BlockTypeInfo::Simple, version, [&](auto &writer) {
+            writer.Key("txs");
+            writer.StartArray();
+            for (const TransactionInfo &tx: bi.txs) {
+                writeTransactionInfo(writer, tx, bi.header, type, version);
+            }
+            writer.EndArray();
+        });
+    });
 }
 
 std::string genCountBlockJson(const RequestId &requestId, size_t countBlocks, bool isFormat, const JsonVersion &version) {
@@ -646,14 +794,12 @@ static std::string blockHashesToJson(const std::vector<std::vector<unsigned char
 }
 
 std::string preLoadBlocksJson(const RequestId &requestId, size_t countBlocks, const std::vector<torrent_node_lib::BlockHeader> &bh, const std::vector<std::vector<std::vector<unsigned char>>> &blockSignatures, const std::vector<std::string> &blocks, bool isCompress, const JsonVersion &version) {
-    rapidjson::Document doc(rapidjson::kObjectType);
-    auto &allocator = doc.GetAllocator();
-    
-    rapidjson::Value vals = blockHeadersToP2PJsonImpl(bh, blockSignatures, allocator, version);
-    
-    doc.AddMember("result", vals, allocator);
-    
-    const std::string blockHeaders = jsonToString(doc, false);
+    const std::string blockHeaders = streamJson(false, [&](auto &writer) {
+        writer.StartObject();
+        writer.Key("result");
+        writeBlockHeadersToP2P(writer, bh, blockSignatures, version);
+        writer.EndObject();
+    });
     
     const std::string blocksStr = genDumpBlocksBinary(blocks, isCompress);
     
@@ -62,6 +62,8 @@ std::string addressesInfoToJson(const RequestId &requestId, const std::string &a
 
 std::string addressesInfoToJsonFilter(const RequestId &requestId, const std::string &address, const std::vector<torrent_node_lib::TransactionInfo> &infos, size_t nextFrom, const torrent_node_lib::BlockChainReadInterface &blockchain, size_t currentBlock, bool isFormat, const JsonVersion &version);
 
+std::string addressesInfoToJsonCursor(const RequestId &requestId, const std::string &address, const std::vector<torrent_node_lib::TransactionInfo> &infos, const std::optional<std::string> &nextCursor, const torrent_node_lib::BlockChainReadInterface &blockchain, size_t currentBlock, bool isFormat, const JsonVersion &version);
+
 std::string balanceInfoToJson(const RequestId &requestId, const std::string &address, const torrent_node_lib::BalanceInfo &balance, size_t currentBlock, bool isFormat, const JsonVersion &version);
 
 std::string balanceTokenInfoToJson(const RequestId &requestId, const std::string &address, const torrent_node_lib::BalanceInfo &balance, size_t currentBlock, bool isFormat, const JsonVersion &version);
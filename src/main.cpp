@@ -30,6 +30,7 @@
 
 #include "P2P/P2P.h"
 #include "P2P/P2P_Ips.h"
+#include "P2P/P2P_Multi.h"
 #include "P2P/P2P_Graph.h"
 
 #include "generate_json_v8.h"
@@ -180,13 +181,28 @@ int main (int argc, char *const *argv) {
         const bool getBlocksFromFile = allSettings["get_blocks_from_file"];
         const size_t countConnections = static_cast<int>(allSettings["count_connections"]);
         const std::string thisServer = getHostName();
-        size_t maxCountElementsBlockCache = 0;
+        //c Кэши теперь ограничиваются в мегабайтах. Старые ограничения в элементах в мегабайты не переводятся, поэтому игнорируются
         if (allSettings.exists("max_count_elements_block_cache")) {
-            maxCountElementsBlockCache = static_cast<int>(allSettings["max_count_elements_block_cache"]);
+            LOGWARN << "Option max_count_elements_block_cache is deprecated and ignored, use block_cache_mb";
         }
-        size_t maxCountElementsTxsCache = 0;
         if (allSettings.exists("max_count_blocks_txs_cache")) {
-            maxCountElementsTxsCache = static_cast<int>(allSettings["max_count_blocks_txs_cache"]);
+            LOGWARN << "Option max_count_blocks_txs_cache is deprecated and ignored, use txs_cache_mb and txs_status_cache_mb";
+        }
+        size_t blockCacheMb = 64;
+        if (allSettings.exists("block_cache_mb")) {
+            blockCacheMb = static_cast<int>(allSettings["block_cache_mb"]);
+        }
+        size_t txsCacheMb = 64;
+        if (allSettings.exists("txs_cache_mb")) {
+            txsCacheMb = static_cast<int>(allSettings["txs_cache_mb"]);
+        }
+        size_t txsStatusCacheMb = 16;
+        if (allSettings.exists("txs_status_cache_mb")) {
+            txsStatusCacheMb = static_cast<int>(allSettings["txs_status_cache_mb"]);
+        }
+        size_t balancesCacheMb = 64;
+        if (allSettings.exists("balances_cache_mb")) {
+            balancesCacheMb = static_cast<int>(allSettings["balances_cache_mb"]);
         }
         size_t maxLocalCacheElements = 0;
         if (allSettings.exists("mac_local_cache_elements")) {
@@ -206,6 +222,19 @@ int main (int argc, char *const *argv) {
         if (allSettings.exists("validate")) {
             isValidate = allSettings["validate"];
         }
+        size_t countThreadsValidate = 4;
+        if (allSettings.exists("validate_threads")) {
+            const int value = allSettings["validate_threads"];
+            CHECK(value >= 1, "Incorrect validate_threads");
+            countThreadsValidate = value;
+        }
+        setCountThreadsValidate(countThreadsValidate);
+        size_t validateSignsCacheMb = 32;
+        if (allSettings.exists("validate_signs_cache_mb")) {
+            validateSignsCacheMb = static_cast<int>(allSettings["validate_signs_cache_mb"]);
+        }
+        setValidateSignsCacheSize(validateSignsCacheMb * 1024 * 1024);
+        
         bool isValidateSign = false;
         if (allSettings.exists("validateSign")) {
             isValidateSign = allSettings["validateSign"];
@@ -226,10 +255,15 @@ int main (int argc, char *const *argv) {
             testNodesServer = static_cast<const char*>(allSettings["test_nodes_result_server"]);
         }
         
-        size_t maxAdvancedLoadBlocks = 10;
+        size_t initAdvancedLoadBlocks = 10;
         if (allSettings.exists("advanced_load_blocks")) {
-            maxAdvancedLoadBlocks = static_cast<int>(allSettings["advanced_load_blocks"]);
+            initAdvancedLoadBlocks = static_cast<int>(allSettings["advanced_load_blocks"]);
         }
+        size_t advancedLoadMb = 64;
+        if (allSettings.exists("advanced_load_mb")) {
+            advancedLoadMb = static_cast<int>(allSettings["advanced_load_mb"]);
+        }
+        CHECK(advancedLoadMb != 0, "Incorrect advanced_load_mb");
         size_t countBlocksInBatch = 1;
         if (allSettings.exists("count_blocks_in_batch")) {
             countBlocksInBatch = static_cast<int>(allSettings["count_blocks_in_batch"]);
@@ -248,6 +282,34 @@ int main (int argc, char *const *argv) {
         if (allSettings.exists("is_preload")) {
             isPreLoad = allSettings["is_preload"];
         }
+        
+        FileSyncPolicy blockFilesSync;
+        if (allSettings.exists("block_files_sync")) {
+            const std::string syncType = static_cast<const char*>(allSettings["block_files_sync"]);
+            if (syncType == "block") {
+                blockFilesSync.type = FileSyncPolicy::Type::EveryBlock;
+            } else if (syncType == "count") {
+                blockFilesSync.type = FileSyncPolicy::Type::CountBlocks;
+            } else if (syncType == "time") {
+                blockFilesSync.type = FileSyncPolicy::Type::TimeWindow;
+            } else {
+                throwErr("Unknown block_files_sync " + syncType);
+            }
+        }
+        if (allSettings.exists("block_files_sync_blocks")) {
+            blockFilesSync.countBlocks = static_cast<int>(allSettings["block_files_sync_blocks"]);
+        }
+        if (allSettings.exists("block_files_sync_ms")) {
+            blockFilesSync.timeWindow = std::chrono::milliseconds(static_cast<int>(allSettings["block_files_sync_ms"]));
+        }
+        size_t blockFilesPreallocateMb = 64;
+        if (allSettings.exists("block_files_preallocate_mb")) {
+            blockFilesPreallocateMb = static_cast<int>(allSettings["block_files_preallocate_mb"]);
+        }
+        size_t snapshotPeriodBlocks = 10000;
+        if (allSettings.exists("snapshot_period_blocks")) {
+            snapshotPeriodBlocks = static_cast<int>(allSettings["snapshot_period_blocks"]);
+        }
                 
         std::set<std::string> modulesStr;
         for (const std::string &moduleStr: allSettings["modules"]) {
@@ -261,6 +323,31 @@ int main (int argc, char *const *argv) {
             setV8Server(v8Server, modules[MODULE_V8]);
         }
 
+        P2PSegmentOptions segmentOptions;
+        if (allSettings.exists("p2p_min_segment_size")) {
+            segmentOptions.minSegmentSize = static_cast<int>(allSettings["p2p_min_segment_size"]);
+        }
+        CHECK(segmentOptions.minSegmentSize > 1, "Incorrect p2p_min_segment_size");
+        if (allSettings.exists("p2p_max_segment_size")) {
+            segmentOptions.maxSegmentSize = static_cast<int>(allSettings["p2p_max_segment_size"]);
+        }
+        if (allSettings.exists("p2p_segments_per_connection")) {
+            segmentOptions.segmentsPerConnection = static_cast<int>(allSettings["p2p_segments_per_connection"]);
+        }
+        if (allSettings.exists("p2p_bdp_multiplier")) {
+            segmentOptions.bdpMultiplier = static_cast<double>(allSettings["p2p_bdp_multiplier"]);
+        }
+        if (allSettings.exists("p2p_hedge_min_delay_ms")) {
+            segmentOptions.hedgeMinDelay = milliseconds(static_cast<int>(allSettings["p2p_hedge_min_delay_ms"]));
+        }
+        if (allSettings.exists("p2p_hedge_time_factor")) {
+            segmentOptions.hedgeTimeFactor = static_cast<double>(allSettings["p2p_hedge_time_factor"]);
+        }
+        if (allSettings.exists("p2p_hedge_percentile")) {
+            segmentOptions.hedgePercentile = static_cast<double>(allSettings["p2p_hedge_percentile"]);
+        }
+        CHECK(0 < segmentOptions.hedgePercentile && segmentOptions.hedgePercentile <= 1, "Incorrect p2p_hedge_percentile");
+
         std::unique_ptr<P2P> p2p = nullptr;
         std::unique_ptr<P2P> p2p2 = nullptr;
         std::unique_ptr<P2P> p2pAll = nullptr;
@@ -272,14 +359,27 @@ int main (int argc, char *const *argv) {
 
         const std::string myIp = trim(getMyIp2("echo.metahash.io:7654")) + ":" + std::to_string(port);
 
+        std::string p2pTransport = "threads";
+        if (allSettings.exists("p2p_transport")) {
+            p2pTransport = static_cast<const char*>(allSettings["p2p_transport"]);
+        }
+        CHECK(p2pTransport == "threads" || p2pTransport == "multi", "Incorrect p2p_transport " + p2pTransport);
+        const auto makeP2P = [&p2pTransport, countConnections](const std::vector<std::string> &servers, const std::vector<std::string> &candidates) -> std::unique_ptr<P2P> {
+            if (p2pTransport == "multi") {
+                return std::make_unique<P2P_Multi>(servers, countConnections);
+            } else {
+                return std::make_unique<P2P_Ips>(servers, countConnections, candidates);
+            }
+        };
+
         if (allSettings["servers"].isArray()) {
             std::vector<std::string> serversStr;
             for (const std::string &serverStr: allSettings["servers"]) {
                 serversStr.push_back(serverStr);
             }
-            p2p = std::make_unique<P2P_Ips>(serversStr, countConnections);
-            p2p2 = std::make_unique<P2P_Ips>(serversStr, countConnections);
-            p2pAll = std::make_unique<P2P_Ips>(serversStr, countConnections);
+            p2p = makeP2P(serversStr, {});
+            p2p2 = makeP2P(serversStr, {});
+            p2pAll = makeP2P(serversStr, {});
         } else {
             const std::string &fileName = allSettings["servers"];
             if (beginWith(fileName, "http")) {
@@ -290,14 +390,15 @@ int main (int argc, char *const *argv) {
                 }
                 std::vector<std::string> serversStr;
                 std::transform(bestIps.begin(), bestIps.end(), std::back_inserter(serversStr), std::mem_fn(&NsResult::server));
-                p2p = std::make_unique<P2P_Ips>(serversStr, countConnections);
-                p2p2 = std::make_unique<P2P_Ips>(serversStr, countConnections);
                 
                 const std::vector<NsResult> bestIps2 = getBestIps(fileName, 100);
                 CHECK(!bestIps2.empty(), "Not found servers");
                 std::vector<std::string> serversStr2;
                 std::transform(bestIps2.begin(), bestIps2.end(), std::back_inserter(serversStr2), std::mem_fn(&NsResult::server));
-                p2pAll = std::make_unique<P2P_Ips>(serversStr2, countConnections);                
+                //c Лучшие сервера для скачивания блоков периодически переизбираются из всех найденных
+                p2p = makeP2P(serversStr, serversStr2);
+                p2p2 = makeP2P(serversStr, serversStr2);
+                p2pAll = makeP2P(serversStr2, {});
             } else {
                 const std::vector<std::pair<std::string, std::string>> serversGraph = readServers(fileName, otherPortTorrent);
                 p2p = std::make_unique<P2P_Graph>(serversGraph, myIp, countConnections);
@@ -310,12 +411,14 @@ int main (int argc, char *const *argv) {
             pathToFolder, 
             technicalAddress,
             LevelDbOptions(settingsDb.writeBufSizeMb, settingsDb.isBloomFilter, settingsDb.isChecks, getFullPath("simple", pathToBd), settingsDb.lruCacheMb),
-            CachesOptions(maxCountElementsBlockCache, maxCountElementsTxsCache, maxLocalCacheElements),
-            GetterBlockOptions(maxAdvancedLoadBlocks, countBlocksInBatch, p2p.get(), p2p2.get(), p2pAll.get(), getBlocksFromFile, isValidate, isValidateSign, isCompress, isPreLoad),
+            CachesOptions(blockCacheMb, txsCacheMb, txsStatusCacheMb, balancesCacheMb, maxLocalCacheElements),
+            GetterBlockOptions(initAdvancedLoadBlocks, advancedLoadMb, countBlocksInBatch, p2p.get(), p2p2.get(), p2pAll.get(), getBlocksFromFile, isValidate, isValidateSign, isCompress, isPreLoad, segmentOptions),
             signKey,
             TestNodesOptions(otherPortTorrent, myIp, testNodesServer),
             isValidateState
         );
+        sync.setBlockFilesOpt(BlockFilesOptions(blockFilesSync, blockFilesPreallocateMb));
+        sync.setSnapshotPeriodBlocks(snapshotPeriodBlocks);
         if (settingsStateDb.isSet) {
             sync.setLeveldbOptScript(LevelDbOptions(settingsStateDb.writeBufSizeMb, settingsStateDb.isBloomFilter, settingsStateDb.isChecks, getFullPath("states", pathToBd), settingsStateDb.lruCacheMb));
         }
@@ -8,6 +8,7 @@
 #include <memory>
 #include <algorithm>
 #include <iomanip>
+#include <numeric>
 
 #include <duration.h>
 
@@ -19,6 +20,7 @@
 #include <arpa/inet.h>
 
 #include "log.h"
+#include "parallel_for.h"
 
 static std::string parse_record(unsigned char *buffer, size_t r, ns_sect s, int idx, ns_msg *m) {
     ns_rr rr;
@@ -168,22 +170,24 @@ std::vector<NsResult> getBestIps(const std::string &address, size_t count) {
     
     const std::vector<std::string> result = nsLookup(server);
     
-    std::vector<NsResult> pr;
-    for (const std::string &r: result) {
-        const std::string serv = scheme + r + ((port != 0) ? (":" + std::to_string(port)) : "");
+    std::vector<NsResult> pr(result.size());
+    std::vector<size_t> indexes(result.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    common::parallelFor(16, indexes.begin(), indexes.end(), [&result, &pr, &scheme, port](size_t index) {
+        const std::string serv = scheme + result[index] + ((port != 0) ? (":" + std::to_string(port)) : "");
         try {
             common::Timer tt;
             const std::string response = request(serv + "/status", "", "", "");
             tt.stop();
             if (response.empty()) {
-                pr.emplace_back(serv, milliseconds(999s).count());
+                pr[index] = NsResult(serv, milliseconds(999s).count());
             } else {
-                pr.emplace_back(serv, tt.countMs());
+                pr[index] = NsResult(serv, tt.countMs());
             }
         } catch (const common::exception &e) {
-            pr.emplace_back(serv, milliseconds(999s).count());
+            pr[index] = NsResult(serv, milliseconds(999s).count());
         }
-    }
+    });
 
     std::sort(pr.begin(), pr.end(), [](const NsResult &first, const NsResult &second) {
         return first.timeout < second.timeout;
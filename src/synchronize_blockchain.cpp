@@ -23,6 +23,14 @@ void initBlockchainUtils() {
     isInitialized = true;
 }
 
+void setCountThreadsValidate(size_t countThreads) {
+    setCountThreadsValidateSigns(countThreads);
+}
+
+void setValidateSignsCacheSize(size_t maxSizeBytes) {
+    setVerifiedSignsCacheSize(maxSizeBytes);
+}
+
 Sync::Sync(const std::string& folderPath, const std::string &technicalAddress, const LevelDbOptions& leveldbOpt, const CachesOptions& cachesOpt, const GetterBlockOptions &getterBlocksOpt, const std::string &signKeyName, const TestNodesOptions &testNodesOpt, bool validateStates)
     : impl(std::make_unique<SyncImpl>(folderPath, technicalAddress, leveldbOpt, cachesOpt, getterBlocksOpt, signKeyName, testNodesOpt, validateStates))
 {}
@@ -35,10 +43,26 @@ void Sync::setLeveldbOptNodeTest(const LevelDbOptions &leveldbOptScript) {
     impl->setLeveldbOptNodeTest(leveldbOptScript);
 }
 
+void Sync::setBlockFilesOpt(const BlockFilesOptions &blockFilesOpt) {
+    impl->setBlockFilesOpt(blockFilesOpt);
+}
+
+void Sync::setSnapshotPeriodBlocks(size_t snapshotPeriodBlocks) {
+    impl->setSnapshotPeriodBlocks(snapshotPeriodBlocks);
+}
+
 BalanceInfo Sync::getBalance(const Address& address) const {
     return impl->getBalance(address);
 }
 
+std::vector<std::optional<TransactionInfo>> Sync::getTransactions(const std::vector<std::string> &txHashes) const {
+    return impl->getTransactions(txHashes);
+}
+
+std::vector<BalanceInfo> Sync::getBalances(const std::vector<Address> &addresses) const {
+    return impl->getBalances(addresses);
+}
+
 std::string Sync::getBlockDump(const std::vector<unsigned char> &hash, const FilePosition &filePos, size_t fromByte, size_t toByte, bool isHex, bool isSign) const {
     return impl->getBlockDump(hash, filePos, fromByte, toByte, isHex, isSign);
 }
@@ -71,6 +95,10 @@ std::vector<TransactionInfo> Sync::getTxsForAddress(const Address& address, size
     return impl->getTxsForAddress(address, from, count, limitTxs, filters);
 }
 
+std::vector<TransactionInfo> Sync::getTxsForAddressFromCursor(const Address& address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const {
+    return impl->getTxsForAddressFromCursor(address, cursor, count, limitTxs);
+}
+
 std::optional<ConflictBlocksInfo> Sync::synchronize(int countThreads) {
     return impl->synchronize(countThreads);
 }
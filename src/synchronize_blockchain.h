@@ -63,6 +63,10 @@ public:
     
     void setLeveldbOptNodeTest(const LevelDbOptions &leveldbOpt);
     
+    void setBlockFilesOpt(const BlockFilesOptions &blockFilesOpt);
+    
+    void setSnapshotPeriodBlocks(size_t snapshotPeriodBlocks);
+    
     const BlockChainReadInterface & getBlockchain() const;
     
     ~Sync();
@@ -79,11 +83,17 @@ public:
 
     std::vector<TransactionInfo> getTxsForAddress(const Address &address, size_t &from, size_t count, size_t limitTxs, const TransactionsFilters &filters) const;
     
+    std::vector<TransactionInfo> getTxsForAddressFromCursor(const Address &address, std::optional<size_t> &cursor, size_t count, size_t limitTxs) const;
+    
     std::optional<TransactionInfo> getTransaction(const std::string &txHash) const;
 
     Token getTokenInfo(const Address &address) const;
     
     BalanceInfo getBalance(const Address &address) const;
+    
+    std::vector<std::optional<TransactionInfo>> getTransactions(const std::vector<std::string> &txHashes) const;
+    
+    std::vector<BalanceInfo> getBalances(const std::vector<Address> &addresses) const;
 
     std::string getBlockDump(const std::vector<unsigned char> &hash, const FilePosition &filePos, size_t fromByte, size_t toByte, bool isHex, bool isSign) const;
 
@@ -143,6 +153,10 @@ private:
 
 void initBlockchainUtils();
 
+void setCountThreadsValidate(size_t countThreads);
+
+void setValidateSignsCacheSize(size_t maxSizeBytes);
+
 }
 
 #endif // SYNCHRONIZE_BLOCKCHAIN_H_
@@ -0,0 +1,259 @@
+#include "FileAppender.h"
+
+#include <experimental/filesystem>
+#include <algorithm>
+#include <climits>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "MappedFile.h"
+
+#include "check.h"
+#include "log.h"
+
+using namespace common;
+
+namespace fs = std::experimental::filesystem;
+
+namespace torrent_node_lib {
+
+FileAppender::FileAppender(size_t preallocateBytes, const FileSyncPolicy &policy)
+    : preallocateBytes(preallocateBytes)
+    , policy(policy)
+{
+    if (policy.type == FileSyncPolicy::Type::TimeWindow) {
+        syncThread = std::thread(&FileAppender::syncWorker, this);
+    }
+}
+
+FileAppender::~FileAppender() {
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stopped = true;
+    }
+    cond.notify_all();
+    if (syncThread.joinable()) {
+        syncThread.join();
+    }
+    try {
+        close();
+    } catch (...) {
+        LOGERR << "Error while close file " << fileName;
+    }
+}
+
+void FileAppender::syncWorker() {
+    std::unique_lock<std::mutex> lock(mut);
+    while (!stopped) {
+        if (countNotSyncedBlocks == 0) {
+            cond.wait(lock);
+            continue;
+        }
+        const std::chrono::steady_clock::time_point syncTime = firstNotSyncedTime + policy.timeWindow;
+        if (std::chrono::steady_clock::now() < syncTime) {
+            cond.wait_until(lock, syncTime);
+            continue;
+        }
+        try {
+            syncImpl();
+        } catch (const exception &e) {
+            LOGERR << e;
+            //c Следующая попытка через окно, а не в цикле
+            firstNotSyncedTime = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+void FileAppender::open(const std::string &fileName) {
+    struct stat st;
+    isNewFile = ::stat(fileName.c_str(), &st) != 0;
+    fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    CHECK(fd >= 0, "Not opened file " + fileName + ": " + strerror(errno));
+    CHECK(::fstat(fd, &st) == 0, "Not stat file " + fileName + ": " + strerror(errno));
+    this->fileName = fileName;
+    fileSize = st.st_size;
+    allocatedSize = fileSize;
+    countNotSyncedBlocks = 0;
+    publish(fileSize);
+}
+
+void FileAppender::publish(size_t size) {
+    publishedSize = size;
+    setMappedFileLimit(fileName, publishedSize);
+}
+
+void FileAppender::preallocate(size_t needSize) {
+    if (preallocateBytes == 0 || !isFallocateSupported || needSize <= allocatedSize) {
+        return;
+    }
+    const size_t newAllocatedSize = needSize + preallocateBytes;
+    //c FALLOC_FL_KEEP_SIZE не меняет размер файла, поэтому читатели и восстановление после падения не видят выделенный хвост
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, fileSize, newAllocatedSize - fileSize) != 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            LOGWARN << "fallocate not supported for " << fileName;
+            isFallocateSupported = false;
+            return;
+        }
+        throwErr("Not allocated file " + fileName + ": " + strerror(errno));
+    }
+    allocatedSize = newAllocatedSize;
+}
+
+size_t FileAppender::appendBlock(const std::string &fileName, const std::string &data) {
+    const size_t pos = appendBlocks(fileName, {&data}).front();
+    publishBlock(fileName, pos, data.size());
+    return pos;
+}
+
+std::vector<size_t> FileAppender::appendBlocks(const std::string &fileName, const std::vector<const std::string*> &blocks) {
+    std::lock_guard<std::mutex> lock(mut);
+    if (fd < 0 || this->fileName != fileName) {
+        closeImpl();
+        open(fileName);
+    }
+
+    const size_t oldSize = fileSize;
+    std::vector<uint64_t> blockSizes;
+    blockSizes.reserve(blocks.size());
+    std::vector<iovec> iov;
+    iov.reserve(blocks.size() * 2);
+    std::vector<size_t> positions;
+    positions.reserve(blocks.size());
+    size_t allSize = 0;
+    for (const std::string *block: blocks) {
+        positions.emplace_back(oldSize + allSize);
+        blockSizes.emplace_back(block->size());
+        iov.emplace_back(iovec{&blockSizes.back(), sizeof(uint64_t)});
+        iov.emplace_back(iovec{const_cast<char*>(block->data()), block->size()});
+        allSize += sizeof(uint64_t) + block->size();
+    }
+    preallocate(oldSize + allSize);
+
+    try {
+        writeAll(iov);
+        struct stat st;
+        CHECK(::fstat(fd, &st) == 0, "Not stat file " + fileName + ": " + strerror(errno));
+        CHECK(static_cast<size_t>(st.st_size) == oldSize + allSize, "Incorrect file size after write block " + fileName);
+    } catch (...) {
+        //c Недописанный блок отрезаем, а файл закрываем: при следующей записи размер заново прочитается с диска.
+        //c Отображения этого файла не заходят дальше oldSize, поэтому читатели не попадут за новый конец файла
+        if (::ftruncate(fd, oldSize) != 0) {
+            LOGERR << "Not truncated file " << fileName << ": " << strerror(errno);
+        }
+        ::close(fd);
+        fd = -1;
+        this->fileName.clear();
+        throw;
+    }
+
+    fileSize += allSize;
+    if (countNotSyncedBlocks == 0) {
+        firstNotSyncedTime = std::chrono::steady_clock::now();
+        cond.notify_all();
+    }
+    countNotSyncedBlocks += blocks.size();
+    return positions;
+}
+
+void FileAppender::publishBlock(const std::string &fileName, size_t pos, size_t blockSize) {
+    std::lock_guard<std::mutex> lock(mut);
+    CHECK(fd >= 0 && this->fileName == fileName, "File " + fileName + " not opened for append");
+    const size_t end = pos + sizeof(uint64_t) + blockSize;
+    CHECK(end <= fileSize, "Block not written to " + fileName);
+    if (end > publishedSize) {
+        publish(end);
+    }
+}
+
+void FileAppender::truncateNotPublished() {
+    std::lock_guard<std::mutex> lock(mut);
+    if (fd < 0 || fileSize == publishedSize) {
+        return;
+    }
+    CHECK(::ftruncate(fd, publishedSize) == 0, "Not truncated file " + fileName + ": " + strerror(errno));
+    fileSize = publishedSize;
+}
+
+void FileAppender::writeAll(std::vector<iovec> &iov) {
+    size_t first = 0;
+    while (first < iov.size()) {
+        const ssize_t res = ::writev(fd, iov.data() + first, std::min(iov.size() - first, size_t(IOV_MAX)));
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        CHECK(res > 0, "Incorrect write block operation " + fileName + ": " + strerror(errno));
+        //c Пропускаем записанные куски, недописанный сдвигаем
+        size_t written = res;
+        while (first < iov.size() && written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (written != 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+            iov[first].iov_len -= written;
+        }
+    }
+}
+
+bool FileAppender::commit() {
+    std::lock_guard<std::mutex> lock(mut);
+    if (countNotSyncedBlocks == 0) {
+        return true;
+    }
+
+    //c При TimeWindow сбрасывает syncThread
+    if (policy.type == FileSyncPolicy::Type::EveryBlock) {
+        syncImpl();
+    } else if (policy.type == FileSyncPolicy::Type::CountBlocks && countNotSyncedBlocks >= policy.countBlocks) {
+        syncImpl();
+    }
+    return countNotSyncedBlocks == 0;
+}
+
+void FileAppender::sync() {
+    std::lock_guard<std::mutex> lock(mut);
+    syncImpl();
+}
+
+void FileAppender::syncImpl() {
+    if (fd < 0 || countNotSyncedBlocks == 0) {
+        return;
+    }
+    CHECK(::fdatasync(fd) == 0, "Not synced file " + fileName + ": " + strerror(errno));
+    if (isNewFile) {
+        //c Запись о новом файле в каталоге тоже должна оказаться на диске
+        const std::string folder = fs::path(fileName).parent_path().string();
+        const int dirFd = ::open(folder.empty() ? "." : folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        CHECK(dirFd >= 0, "Not opened folder " + folder + ": " + strerror(errno));
+        const int res = ::fsync(dirFd);
+        ::close(dirFd);
+        CHECK(res == 0, "Not synced folder " + folder);
+        isNewFile = false;
+    }
+    countNotSyncedBlocks = 0;
+}
+
+void FileAppender::close() {
+    std::lock_guard<std::mutex> lock(mut);
+    closeImpl();
+}
+
+void FileAppender::closeImpl() {
+    if (fd < 0) {
+        return;
+    }
+    syncImpl();
+    //c Выделенный через fallocate хвост и не открытые читателям блоки больше не понадобятся
+    if ((allocatedSize > publishedSize || fileSize > publishedSize) && ::ftruncate(fd, publishedSize) != 0) {
+        LOGERR << "Not truncated file " << fileName << ": " << strerror(errno);
+    }
+    ::close(fd);
+    fd = -1;
+    removeMappedFileLimit(fileName);
+    fileName.clear();
+}
+
+} // namespace torrent_node_lib {
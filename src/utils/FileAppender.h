@@ -0,0 +1,122 @@
+#ifndef FILE_APPENDER_H_
+#define FILE_APPENDER_H_
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <sys/uio.h>
+
+namespace torrent_node_lib {
+
+struct FileSyncPolicy {
+    enum class Type {
+        EveryBlock, CountBlocks, TimeWindow
+    };
+
+    Type type = Type::TimeWindow;
+
+    size_t countBlocks = 16;
+
+    std::chrono::milliseconds timeWindow = std::chrono::milliseconds(1000);
+};
+
+/**
+ *c Дописывает блоки в текущий файл блоков, не закрывая его между блоками.
+ *c Место под файл выделяется кусками через fallocate без изменения размера, поэтому читатели видят только записанные блоки.
+ *c При TimeWindow сброс на диск делает отдельный поток по таймеру, даже если новых блоков больше нет
+ */
+class FileAppender {
+public:
+
+    FileAppender(size_t preallocateBytes, const FileSyncPolicy &policy);
+
+    FileAppender(const FileAppender&) = delete;
+    FileAppender& operator=(const FileAppender&) = delete;
+
+    ~FileAppender();
+
+public:
+
+    /**
+     *c Записывает размер и блок одним вызовом и сразу открывает блок читателям. Возвращает размер файла до записи
+     */
+    size_t appendBlock(const std::string &fileName, const std::string &data);
+
+    /**
+     *c Записывает несколько блоков одним writev. Возвращает позиции блоков.
+     *c Блоки не видны читателям, пока для них не вызван publishBlock
+     */
+    std::vector<size_t> appendBlocks(const std::string &fileName, const std::vector<const std::string*> &blocks);
+
+    void publishBlock(const std::string &fileName, size_t pos, size_t blockSize);
+
+    /**
+     *c Отрезает записанные, но не открытые читателям блоки, если их не будут применять
+     */
+    void truncateNotPublished();
+
+    /**
+     *c Сбрасывает записанное на диск, если этого требует политика.
+     *c Возвращает true, если все дописанные блоки уже на диске и их можно подтверждать
+     */
+    bool commit();
+
+    void sync();
+
+    void close();
+
+private:
+
+    void open(const std::string &fileName);
+
+    void preallocate(size_t needSize);
+
+    void writeAll(std::vector<iovec> &iov);
+
+    void publish(size_t size);
+
+    void syncImpl();
+
+    void closeImpl();
+
+    void syncWorker();
+
+private:
+
+    const size_t preallocateBytes;
+
+    const FileSyncPolicy policy;
+
+    std::string fileName;
+
+    int fd = -1;
+
+    bool isNewFile = false;
+
+    bool isFallocateSupported = true;
+
+    size_t fileSize = 0;
+
+    size_t allocatedSize = 0;
+
+    //c Конец последнего блока, открытого читателям
+    size_t publishedSize = 0;
+
+    size_t countNotSyncedBlocks = 0;
+
+    std::chrono::steady_clock::time_point firstNotSyncedTime;
+
+    //c Запись идет из потока синхронизации, сброс по таймеру из syncThread
+    std::mutex mut;
+    std::condition_variable cond;
+    bool stopped = false;
+    std::thread syncThread;
+};
+
+} // namespace torrent_node_lib {
+
+#endif // FILE_APPENDER_H_
@@ -137,6 +137,10 @@ void resizeFile(const std::string &file, size_t newSize) {
     fs::resize_file(file, newSize);
 }
 
+void renameFile(const std::string &from, const std::string &to) {
+    fs::rename(from, to);
+}
+
 void removeDirectory(const std::string &path) {
     fs::remove_all(path);
 }
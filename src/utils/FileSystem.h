@@ -47,6 +47,8 @@ bool isFileExist(const std::string &file);
 
 void resizeFile(const std::string &file, size_t newSize);
 
+void renameFile(const std::string &from, const std::string &to);
+
 void removeDirectory(const std::string &path);
 
 }
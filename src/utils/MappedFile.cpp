@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "check.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+//c Сколько последних использованных отображений держит реестр. Остальные живут, только пока на них есть ссылки
+const static size_t MAX_REGISTERED_FILES = 64;
+
+static std::mutex registryMut;
+//c Начало списка - последние использованные
+static std::list<std::string> lru;
+static std::unordered_map<std::string, std::pair<std::shared_ptr<const MappedFile>, std::list<std::string>::iterator>> files;
+static std::unordered_map<std::string, size_t> limits;
+
+MappedFile::MappedFile(const std::string &file, size_t maxSize)
+    : fileName(file)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    CHECK(fd != -1, "Not opened file " + file + ": " + strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throwErr("Not stat file " + file + ": " + strerror(err));
+    }
+    fileSize = std::min(static_cast<size_t>(st.st_size), maxSize);
+    if (fileSize != 0) {
+        void *addr = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        const int err = errno;
+        ::close(fd);
+        CHECK(addr != MAP_FAILED, "Not mapped file " + file + ": " + strerror(err));
+        begin = static_cast<const char*>(addr);
+    } else {
+        ::close(fd);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (begin != nullptr) {
+        munmap(const_cast<char*>(begin), fileSize);
+    }
+}
+
+std::shared_ptr<const MappedFile> openMappedFile(const std::string &file, size_t minSize) {
+    CHECK(!file.empty(), "Empty file name");
+    
+    std::lock_guard<std::mutex> lock(registryMut);
+    auto found = files.find(file);
+    if (found != files.end()) {
+        lru.splice(lru.begin(), lru, found->second.second);
+        if (found->second.first->size() >= minSize) {
+            return found->second.first;
+        }
+    }
+    const auto foundLimit = limits.find(file);
+    const size_t maxSize = foundLimit != limits.end() ? foundLimit->second : std::numeric_limits<size_t>::max();
+    auto mapped = std::make_shared<const MappedFile>(file, maxSize);
+    if (found != files.end()) {
+        found->second.first = mapped;
+        return mapped;
+    }
+    lru.emplace_front(file);
+    files.emplace(file, std::make_pair(mapped, lru.begin()));
+    if (files.size() > MAX_REGISTERED_FILES) {
+        files.erase(lru.back());
+        lru.pop_back();
+    }
+    return mapped;
+}
+
+void setMappedFileLimit(const std::string &file, size_t size) {
+    std::lock_guard<std::mutex> lock(registryMut);
+    limits[file] = size;
+}
+
+void removeMappedFileLimit(const std::string &file) {
+    std::lock_guard<std::mutex> lock(registryMut);
+    limits.erase(file);
+}
+
+} // namespace torrent_node_lib {
@@ -0,0 +1,63 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <memory>
+#include <string>
+
+namespace torrent_node_lib {
+
+/**
+ *c Read-only отображение файла блоков в память.
+ *c Файлы блоков только дописываются, поэтому отображение соответствует размеру файла на момент открытия, но не больше maxSize
+ */
+class MappedFile {
+public:
+
+    MappedFile(const std::string &file, size_t maxSize);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+public:
+
+    const char* data() const {
+        return begin;
+    }
+
+    size_t size() const {
+        return fileSize;
+    }
+
+    const std::string& getFileName() const {
+        return fileName;
+    }
+
+private:
+
+    std::string fileName;
+
+    const char *begin = nullptr;
+
+    size_t fileSize = 0;
+};
+
+/**
+ *c Возвращает отображение из общего реестра.
+ *c Если файл дописался и отображение меньше minSize, файл отображается заново.
+ *c Старое отображение живет, пока на него есть ссылки. Реестр держит только ограниченное число последних использованных файлов
+ */
+std::shared_ptr<const MappedFile> openMappedFile(const std::string &file, size_t minSize);
+
+/**
+ *c Файл, в который сейчас дописываются блоки, отображается только до конца последнего записанного целиком блока.
+ *c Недописанный хвост может быть отрезан, и страницы за новым концом файла не должны попасть в отображение
+ */
+void setMappedFileLimit(const std::string &file, size_t size);
+
+void removeMappedFileLimit(const std::string &file);
+
+} // namespace torrent_node_lib {
+
+#endif // MAPPED_FILE_H_
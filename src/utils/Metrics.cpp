@@ -0,0 +1,139 @@
+#include "Metrics.h"
+
+#include <sstream>
+
+#include "check.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+static size_t getBucketIndex(uint64_t value) {
+    if (value <= 1) {
+        return 0;
+    }
+    const size_t index = 64 - __builtin_clzll(value - 1);
+    return std::min(index, MetricHistogram::COUNT_BUCKETS);
+}
+
+void MetricHistogram::observe(uint64_t value) {
+    buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::getSnapshot() const {
+    Snapshot result;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum.load(std::memory_order_relaxed);
+    return result;
+}
+
+MetricsRegistry::Family& MetricsRegistry::getFamily(const std::string &name, const std::string &help, Type type) {
+    auto found = families.find(name);
+    if (found == families.end()) {
+        Family family;
+        family.type = type;
+        family.help = help;
+        found = families.emplace(name, std::move(family)).first;
+    }
+    CHECK(found->second.type == type, "Metric " + name + " already registered with other type");
+    return found->second;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels) {
+    std::lock_guard<std::mutex> lock(mut);
+    Family &family = getFamily(name, help, Type::Counter);
+    std::unique_ptr<MetricCounter> &counter = family.counters[labels];
+    if (counter == nullptr) {
+        counter = std::make_unique<MetricCounter>();
+    }
+    return *counter;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string &name, const std::string &help, const std::string &labels) {
+    std::lock_guard<std::mutex> lock(mut);
+    Family &family = getFamily(name, help, Type::Histogram);
+    std::unique_ptr<MetricHistogram> &histogram = family.histograms[labels];
+    if (histogram == nullptr) {
+        histogram = std::make_unique<MetricHistogram>();
+    }
+    return *histogram;
+}
+
+void MetricsRegistry::gauge(const std::string &name, const std::string &help, const GaugeFunc &func, const std::string &labels) {
+    std::lock_guard<std::mutex> lock(mut);
+    Family &family = getFamily(name, help, Type::Gauge);
+    family.gauges[labels] = func;
+}
+
+static std::string joinLabels(const std::string &labels, const std::string &additional) {
+    if (labels.empty() && additional.empty()) {
+        return "";
+    } else if (labels.empty()) {
+        return "{" + additional + "}";
+    } else if (additional.empty()) {
+        return "{" + labels + "}";
+    } else {
+        return "{" + labels + "," + additional + "}";
+    }
+}
+
+std::string MetricsRegistry::exposition() const {
+    std::ostringstream result;
+    std::lock_guard<std::mutex> lock(mut);
+    for (const auto &[name, family]: families) {
+        result << "# HELP " << name << " " << family.help << "\n";
+        if (family.type == Type::Counter) {
+            result << "# TYPE " << name << " counter\n";
+            for (const auto &[labels, counter]: family.counters) {
+                result << name << joinLabels(labels, "") << " " << counter->get() << "\n";
+            }
+        } else if (family.type == Type::Gauge) {
+            result << "# TYPE " << name << " gauge\n";
+            for (const auto &[labels, gauge]: family.gauges) {
+                result << name << joinLabels(labels, "") << " " << gauge() << "\n";
+            }
+        } else {
+            result << "# TYPE " << name << " histogram\n";
+            for (const auto &[labels, histogram]: family.histograms) {
+                const MetricHistogram::Snapshot snapshot = histogram->getSnapshot();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < MetricHistogram::COUNT_BUCKETS; i++) {
+                    cumulative += snapshot.buckets[i];
+                    result << name << "_bucket" << joinLabels(labels, metricLabel("le", std::to_string(uint64_t(1) << i))) << " " << cumulative << "\n";
+                }
+                result << name << "_bucket" << joinLabels(labels, metricLabel("le", "+Inf")) << " " << snapshot.count << "\n";
+                result << name << "_sum" << joinLabels(labels, "") << " " << snapshot.sum << "\n";
+                result << name << "_count" << joinLabels(labels, "") << " " << snapshot.count << "\n";
+            }
+        }
+    }
+    return result.str();
+}
+
+MetricsRegistry& getMetrics() {
+    static MetricsRegistry metrics;
+    return metrics;
+}
+
+std::string metricLabel(const std::string &name, const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c: value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return name + "=\"" + escaped + "\"";
+}
+
+} // namespace torrent_node_lib {
@@ -0,0 +1,110 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <functional>
+
+namespace torrent_node_lib {
+
+class MetricCounter {
+public:
+
+    void inc(uint64_t value = 1) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    std::atomic<uint64_t> counter{0};
+};
+
+/**
+ *c Гистограмма с логарифмическими корзинами. Корзина i считает значения <= 2^i, последняя - все остальные
+ */
+class MetricHistogram {
+public:
+
+    constexpr static size_t COUNT_BUCKETS = 33;
+
+    struct Snapshot {
+        std::array<uint64_t, COUNT_BUCKETS + 1> buckets{};
+        uint64_t sum = 0;
+        uint64_t count = 0;
+    };
+
+public:
+
+    void observe(uint64_t value);
+
+    Snapshot getSnapshot() const;
+
+private:
+
+    std::array<std::atomic<uint64_t>, COUNT_BUCKETS + 1> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> count{0};
+};
+
+/**
+ *c Реестр метрик. Регистрация идет под мьютексом, возвращенные ссылки живут до конца программы,
+ *c поэтому запись значений не берет блокировок
+ */
+class MetricsRegistry {
+public:
+
+    using GaugeFunc = std::function<double()>;
+
+public:
+
+    MetricCounter& counter(const std::string &name, const std::string &help, const std::string &labels = "");
+
+    MetricHistogram& histogram(const std::string &name, const std::string &help, const std::string &labels = "");
+
+    void gauge(const std::string &name, const std::string &help, const GaugeFunc &func, const std::string &labels = "");
+
+    /**
+     *c Текстовый формат Prometheus
+     */
+    std::string exposition() const;
+
+private:
+
+    enum class Type {
+        Counter, Histogram, Gauge
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+        std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+        std::map<std::string, GaugeFunc> gauges;
+    };
+
+private:
+
+    Family& getFamily(const std::string &name, const std::string &help, Type type);
+
+private:
+
+    mutable std::mutex mut;
+
+    std::map<std::string, Family> families;
+};
+
+MetricsRegistry& getMetrics();
+
+std::string metricLabel(const std::string &name, const std::string &value);
+
+} // namespace torrent_node_lib {
+
+#endif // METRICS_H_
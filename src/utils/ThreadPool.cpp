@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+#include <exception>
+#include <algorithm>
+
+#include "check.h"
+
+using namespace common;
+
+namespace torrent_node_lib {
+
+struct ThreadPool::Job {
+    const std::function<void(size_t)> &func;
+    const size_t count;
+    size_t nextIndex = 0;
+    size_t countFinished = 0;
+    std::exception_ptr exception;
+
+    Job(const std::function<void(size_t)> &func, size_t count)
+        : func(func)
+        , count(count)
+    {}
+};
+
+ThreadPool::ThreadPool(size_t countThreads) {
+    CHECK(countThreads != 0, "Incorrect count threads");
+    //c Вызывающий поток считается одним из потоков пула
+    for (size_t i = 1; i < countThreads; i++) {
+        threads.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stopped = true;
+    }
+    cond.notify_all();
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::takeIndex(Job &job) {
+    const size_t index = job.nextIndex++;
+    if (job.nextIndex >= job.count) {
+        //c Задача может быть не первой в очереди, если ее индексы разбирает вызвавший поток
+        const auto found = std::find_if(jobs.begin(), jobs.end(), [&job](const std::shared_ptr<Job> &element) {
+            return element.get() == &job;
+        });
+        if (found != jobs.end()) {
+            jobs.erase(found);
+        }
+    }
+    return index;
+}
+
+void ThreadPool::runIndex(Job &job, size_t index) {
+    std::exception_ptr exception;
+    try {
+        job.func(index);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mut);
+    if (exception != nullptr && job.exception == nullptr) {
+        job.exception = exception;
+    }
+    job.countFinished++;
+    if (job.countFinished == job.count) {
+        condFinished.notify_all();
+    }
+}
+
+void ThreadPool::worker() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mut);
+        cond.wait(lock, [this] {
+            return stopped || !jobs.empty();
+        });
+        if (stopped) {
+            return;
+        }
+        const std::shared_ptr<Job> job = jobs.front();
+        const size_t index = takeIndex(*job);
+        lock.unlock();
+
+        runIndex(*job, index);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &func) {
+    if (count == 0) {
+        return;
+    }
+    if (threads.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    const std::shared_ptr<Job> job = std::make_shared<Job>(func, count);
+    std::unique_lock<std::mutex> lock(mut);
+    jobs.emplace_back(job);
+    lock.unlock();
+    cond.notify_all();
+
+    while (true) {
+        lock.lock();
+        if (job->nextIndex >= job->count) {
+            break;
+        }
+        const size_t index = takeIndex(*job);
+        lock.unlock();
+
+        runIndex(*job, index);
+    }
+
+    condFinished.wait(lock, [&job] {
+        return job->countFinished == job->count;
+    });
+    if (job->exception != nullptr) {
+        std::rethrow_exception(job->exception);
+    }
+}
+
+} // namespace torrent_node_lib
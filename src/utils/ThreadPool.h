@@ -0,0 +1,66 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+namespace torrent_node_lib {
+
+/**
+ *c Пул потоков фиксированного размера, живущий все время работы ноды.
+ *c Вызывающий поток сам тоже выполняет задачи, поэтому вложенные вызовы из задач не блокируются и не плодят потоки
+ */
+class ThreadPool {
+public:
+
+    explicit ThreadPool(size_t countThreads);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+public:
+
+    /**
+     *c Выполняет func(i) для всех i из [0, count) и ждет завершения. Первое исключение из задач пробрасывается
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &func);
+
+    size_t countThreads() const {
+        return threads.size() + 1;
+    }
+
+private:
+
+    struct Job;
+
+private:
+
+    void worker();
+
+    //c Берет следующий индекс задачи и убирает ее из очереди, когда индексы кончились. Вызывать под mut
+    size_t takeIndex(Job &job);
+
+    void runIndex(Job &job, size_t index);
+
+private:
+
+    std::vector<std::thread> threads;
+
+    std::mutex mut;
+    std::condition_variable cond;
+    std::condition_variable condFinished;
+    std::deque<std::shared_ptr<Job>> jobs;
+    bool stopped = false;
+
+};
+
+} // namespace torrent_node_lib
+
+#endif // THREAD_POOL_H_
@@ -202,6 +202,43 @@ inline std::vector<unsigned char> deserializeVector(const std::string &raw, size
     return deserializeVectorBigEndian(raw, fromPos);
 }
 
+// Беззнаковое целое переменной длины: по 7 бит в байте, младшие разряды первыми, старший бит - признак продолжения
+inline void serializeVarUInt(uint64_t value, std::vector<char> &buffer) {
+    while (value >= 0x80) {
+        buffer.emplace_back(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.emplace_back(char(value));
+}
+
+[[nodiscard]] inline std::string serializeVarUInt(uint64_t value) {
+    std::vector<char> buffer;
+    serializeVarUInt(value, buffer);
+    return std::string(buffer.begin(), buffer.end());
+}
+
+inline uint64_t deserializeVarUInt(const std::string &raw, size_t fromPos, size_t &endPos) {
+    endPos = fromPos;
+    uint64_t value = 0;
+    for (size_t i = fromPos, shift = 0; i < raw.size() && shift < 64; i++, shift += 7) {
+        const unsigned char byte = raw[i];
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            endPos = i + 1;
+            return value;
+        }
+    }
+    return 0;
+}
+
+inline uint64_t deserializeVarUInt(const std::string &raw, size_t &fromPos) {
+    size_t endPos = fromPos;
+    const uint64_t val = deserializeVarUInt(raw, fromPos, endPos);
+    CHECK(endPos != fromPos, "Incorrect raw");
+    fromPos = endPos;
+    return val;
+}
+
 template<typename Variant>
 inline void serializeVariant(const Variant &variant, std::vector<char> &buffer) {
     serializeInt<uint64_t>(variant.index(), buffer);